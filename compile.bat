@@ -1 +1,7 @@
-clang -c -g src/main.cpp src/chip8/chip8.cpp  -std=c++20 --target=x86_64-pc-windows-msvc -I"C:/Program Files (x86)/Windows Kits/10/Include/10.0.19041.0/um" -I"C:/Program Files (x86)/Windows Kits/10/Include/10.0.19041.0/shared" 
\ No newline at end of file
+clang -c -g src/main.cpp src/chip8/chip8.cpp src/chip8/idle.cpp src/chip8/scheduler.cpp src/chip8/savestate.cpp src/chip8/movie.cpp src/chip8/fork.cpp src/jit/jit.cpp src/aot/aot.cpp src/ppu/framebuffer.cpp src/ppu/scaler.cpp src/ppu/display.cpp src/trace/trace.cpp src/metrics/metrics.cpp src/apu/apu.cpp  -std=c++20 --target=x86_64-pc-windows-msvc -I"C:/Program Files (x86)/Windows Kits/10/Include/10.0.19041.0/um" -I"C:/Program Files (x86)/Windows Kits/10/Include/10.0.19041.0/shared" 
+clang -c -g src/tools/trace_decode.cpp -std=c++20 --target=x86_64-pc-windows-msvc
+clang -c -g src/tools/recompile.cpp -std=c++20 --target=x86_64-pc-windows-msvc
+clang -c -g src/tools/batch.cpp src/util/thread_pool.cpp src/chip8/pack.cpp src/util/sha1.cpp -std=c++20 --target=x86_64-pc-windows-msvc -I"C:/Program Files (x86)/Windows Kits/10/Include/10.0.19041.0/um" -I"C:/Program Files (x86)/Windows Kits/10/Include/10.0.19041.0/shared"
+clang -c -g src/tools/bench.cpp src/chip8/lockstep.cpp src/chip8/vector_env.cpp src/util/thread_pool.cpp -std=c++20 --target=x86_64-pc-windows-msvc -I"C:/Program Files (x86)/Windows Kits/10/Include/10.0.19041.0/um" -I"C:/Program Files (x86)/Windows Kits/10/Include/10.0.19041.0/shared"
+clang -c -g src/tools/replay.cpp -std=c++20 --target=x86_64-pc-windows-msvc -I"C:/Program Files (x86)/Windows Kits/10/Include/10.0.19041.0/um" -I"C:/Program Files (x86)/Windows Kits/10/Include/10.0.19041.0/shared"
+clang -c -g src/tools/mkpack.cpp src/chip8/pack.cpp src/util/sha1.cpp -std=c++20 --target=x86_64-pc-windows-msvc -I"C:/Program Files (x86)/Windows Kits/10/Include/10.0.19041.0/um" -I"C:/Program Files (x86)/Windows Kits/10/Include/10.0.19041.0/shared"
\ No newline at end of file
@@ -1 +1,7 @@
-clang -o main.exe main.o chip8.o -g -std=c++20 --target=x86_64-pc-windows-msvc  -L"C:/Program Files (x86)/Windows Kits/10/Lib/10.0.19041.0/um/x64" -L"C:/Program Files (x86)/Windows Kits/10/Lib/10.0.19041.0/ucrt/x64"  -lkernel32 -luser32 -lgdi32 -lshell32
\ No newline at end of file
+clang -o main.exe main.o chip8.o idle.o scheduler.o savestate.o movie.o jit.o aot.o framebuffer.o scaler.o display.o trace.o metrics.o apu.o -g -std=c++20 --target=x86_64-pc-windows-msvc  -L"C:/Program Files (x86)/Windows Kits/10/Lib/10.0.19041.0/um/x64" -L"C:/Program Files (x86)/Windows Kits/10/Lib/10.0.19041.0/ucrt/x64"  -lkernel32 -luser32 -lgdi32 -lshell32
+clang -o trace_decode.exe trace_decode.o -g -std=c++20 --target=x86_64-pc-windows-msvc -L"C:/Program Files (x86)/Windows Kits/10/Lib/10.0.19041.0/um/x64" -L"C:/Program Files (x86)/Windows Kits/10/Lib/10.0.19041.0/ucrt/x64" -lkernel32
+clang -o recompile.exe recompile.o -g -std=c++20 --target=x86_64-pc-windows-msvc -L"C:/Program Files (x86)/Windows Kits/10/Lib/10.0.19041.0/um/x64" -L"C:/Program Files (x86)/Windows Kits/10/Lib/10.0.19041.0/ucrt/x64" -lkernel32
+clang -o batch.exe batch.o thread_pool.o pack.o sha1.o chip8.o idle.o scheduler.o savestate.o movie.o jit.o aot.o framebuffer.o trace.o metrics.o -g -std=c++20 --target=x86_64-pc-windows-msvc -L"C:/Program Files (x86)/Windows Kits/10/Lib/10.0.19041.0/um/x64" -L"C:/Program Files (x86)/Windows Kits/10/Lib/10.0.19041.0/ucrt/x64" -lkernel32 -luser32 -lgdi32 -lshell32
+clang -o bench.exe bench.o lockstep.o fork.o vector_env.o thread_pool.o chip8.o idle.o scheduler.o savestate.o movie.o jit.o aot.o framebuffer.o trace.o metrics.o -g -std=c++20 --target=x86_64-pc-windows-msvc -L"C:/Program Files (x86)/Windows Kits/10/Lib/10.0.19041.0/um/x64" -L"C:/Program Files (x86)/Windows Kits/10/Lib/10.0.19041.0/ucrt/x64" -lkernel32 -luser32 -lgdi32 -lshell32
+clang -o replay.exe replay.o chip8.o idle.o scheduler.o savestate.o movie.o jit.o aot.o framebuffer.o trace.o metrics.o -g -std=c++20 --target=x86_64-pc-windows-msvc -L"C:/Program Files (x86)/Windows Kits/10/Lib/10.0.19041.0/um/x64" -L"C:/Program Files (x86)/Windows Kits/10/Lib/10.0.19041.0/ucrt/x64" -lkernel32 -luser32 -lgdi32 -lshell32
+clang -o mkpack.exe mkpack.o pack.o sha1.o -g -std=c++20 --target=x86_64-pc-windows-msvc -L"C:/Program Files (x86)/Windows Kits/10/Lib/10.0.19041.0/um/x64" -L"C:/Program Files (x86)/Windows Kits/10/Lib/10.0.19041.0/ucrt/x64" -lkernel32
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "aot.hpp"
+#include "../chip8/chip8.hpp"
+#include "../metrics/metrics.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	std::vector<const aot_program_t*>& programs()
+	{
+		/* built on first use, the registrars run during static initialization in no particular order */
+		static std::vector<const aot_program_t*> list;
+		return list;
+	}
+}
+
+namespace aot
+{
+	void register_program(const aot_program_t& program)
+	{
+		programs().push_back(&program);
+	}
+
+	const aot_program_t* find(const std::uint8_t* rom, std::size_t length, MACHINE machine)
+	{
+		for (const aot_program_t* program : programs())
+		{
+			if (program->machine == machine && program->rom_length == length && std::memcmp(program->rom, rom, length) == 0)
+				return program;
+		}
+
+		return nullptr;
+	}
+
+	std::uint32_t fault(c_chip8& chip8, std::uint16_t address, std::uint32_t retired)
+	{
+		chip8.registers.pc = address;
+		std::printf("EMULATOR ERROR: call stack %s at %03X\n", chip8.registers.fault == FAULT_STACK_OVERFLOW ? "overflow" : "underflow", address);
+		chip8.halted = true;
+		return retired;
+	}
+}
+
+c_aot::c_aot(c_chip8& chip8, const aot_program_t& program)
+	: chip8(chip8), program(program)
+{
+	this->entries.assign(MEMORY_SIZE, nullptr);
+	this->runnable.assign(MEMORY_SIZE, nullptr);
+
+	for (std::uint32_t i = 0; i < program.count; i++)
+	{
+		const aot_entry_t& entry = program.entries[i];
+
+		if (entry.address + entry.length > MEMORY_SIZE)
+			continue;
+
+		this->entries[entry.address] = &entry;
+		this->longest = std::max<std::uint32_t>(this->longest, entry.length);
+	}
+
+	this->invalidate(0, MEMORY_SIZE);
+}
+
+bool c_aot::intact(const aot_entry_t& entry) const
+{
+	std::uint32_t offset = entry.address - PROGRAM_START;
+
+	if (entry.address < PROGRAM_START || offset + entry.length > this->program.rom_length)
+		return false;
+
+	return std::memcmp(&this->chip8.data[entry.address], this->program.rom + offset, entry.length) == 0;
+}
+
+void c_aot::invalidate(std::uint32_t address, std::uint32_t count)
+{
+	std::uint32_t first = address > this->longest ? address - this->longest : 0;
+	std::uint32_t last = std::min<std::uint32_t>(address + count, MEMORY_SIZE);
+
+	for (std::uint32_t i = first; i < last; i++)
+	{
+		const aot_entry_t* entry = this->entries[i];
+
+		if (entry == nullptr || i + entry->length <= address)
+			continue;
+
+		this->runnable[i] = this->intact(*entry) ? entry->block : nullptr;
+	}
+}
+
+std::uint64_t c_aot::execute(std::uint64_t budget)
+{
+	/* the blocks were decoded for one instruction set and keep no opcode counts */
+	if (this->chip8.get_machine() != this->program.machine || (this->chip8.metrics != nullptr && this->chip8.metrics->count_opcodes))
+		return this->chip8.execute(budget);
+
+	std::uint16_t& pc = this->chip8.registers.pc;
+	std::uint64_t executed = 0;
+
+	this->idle.reset();
+
+	while (executed < budget && !this->chip8.halted && !this->chip8.registers.key_wait)
+	{
+		if (pc > MEMORY_SIZE - 2)
+		{
+			this->chip8.halted = true;
+			break;
+		}
+
+		std::uint16_t start = pc;
+		aot_block_t block = this->runnable[pc];
+
+		if (block != nullptr)
+			executed += block(this->chip8);
+		else
+			executed += this->chip8.execute(1);
+
+		if (pc <= start && start - pc < IDLE_LOOP_BYTES)
+			executed += this->idle.check(this->chip8, start, executed, budget);
+	}
+
+	return executed;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "../chip8/decoder.hpp"
+#include "../chip8/idle.hpp"
+
+class c_chip8;
+
+/* a recompiled block runs its instructions on the machine and returns how many it retired, PC is left on whatever comes next */
+using aot_block_t = std::uint32_t(*)(c_chip8& chip8);
+
+/* one block of a recompiled rom, compiled from the bytes [address, address + length) */
+struct aot_entry_t
+{
+	std::uint16_t address;
+	std::uint16_t length;
+	aot_block_t block;
+};
+
+/* what the recompile tool emits for a rom, the rom is kept so self-modified code can be told apart */
+struct aot_program_t
+{
+	const char* name;
+	MACHINE machine;
+	const std::uint8_t* rom;
+	std::uint32_t rom_length;
+	const aot_entry_t* entries;
+	std::uint32_t count;
+};
+
+namespace aot
+{
+	/* a translation unit from the recompile tool calls this from a static initializer */
+	void register_program(const aot_program_t& program);
+
+	/* the program recompiled from exactly these rom bytes for this instruction set, or null */
+	const aot_program_t* find(const std::uint8_t* rom, std::size_t length, MACHINE machine);
+
+	/* a CALL or RET at address broke the stack, stops the machine on it the way the interpreter does */
+	std::uint32_t fault(c_chip8& chip8, std::uint16_t address, std::uint32_t retired);
+
+	struct registrar_t
+	{
+		registrar_t(const aot_program_t& program)
+		{
+			register_program(program);
+		}
+	};
+}
+
+/*
+*	runs a rom through the blocks the recompile tool generated for it ahead of
+*	time. a block is only entered while the memory it was compiled from still
+*	holds the rom, every store that lands in one rechecks it. anything
+*	without an intact block, code the rom wrote, a BNNN or RET into the middle
+*	of a block, is handed to the interpreter one instruction at a time.
+*/
+class c_aot
+{
+public:
+	c_aot(c_chip8& chip8, const aot_program_t& program);
+
+	std::uint64_t execute(std::uint64_t budget);
+	void invalidate(std::uint32_t address, std::uint32_t count);
+private:
+	bool intact(const aot_entry_t& entry) const;
+
+	c_chip8& chip8;
+	const aot_program_t& program;
+
+	/* indexed by guest address, runnable is null wherever entries has no block or its bytes changed */
+	std::vector<const aot_entry_t*> entries;
+	std::vector<aot_block_t> runnable;
+
+	/* the longest block, a store can only reach back this far into one */
+	std::uint32_t longest{};
+
+	c_idle_loop idle{};
+};
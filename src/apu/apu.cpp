@@ -0,0 +1,139 @@
+#include "apu.hpp"
+#include "../chip8/chip8.hpp"
+#include <SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	/* loud enough to hear, quiet enough not to startle */
+	constexpr std::int16_t AMPLITUDE = 4000;
+
+	/* the beep is half a pattern on and half off, so one pass through it is one period */
+	constexpr std::uint8_t BEEP_PATTERN[AUDIO_PATTERN_BYTES] =
+	{
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+	};
+
+	/* phase increment that walks the 128 pattern samples at rate samples per second */
+	std::uint32_t phase_step(double rate, int sample_rate)
+	{
+		return static_cast<std::uint32_t>(rate / sample_rate * static_cast<double>(1u << 25));
+	}
+}
+
+c_apu::c_apu(std::chrono::milliseconds latency)
+{
+	if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0)
+	{
+		std::printf("AUDIO ERROR: SDL audio failed to initialize: %s\n", SDL_GetError());
+		return;
+	}
+
+	/* the device buffer gets half the latency, rounded down to a power of two as some drivers want */
+	int buffer = 64;
+
+	while (buffer * 2 <= AUDIO_SAMPLE_RATE * latency.count() / 2000 && buffer < 4096)
+	{
+		buffer *= 2;
+	}
+
+	SDL_AudioSpec desired{};
+	SDL_AudioSpec obtained{};
+
+	desired.freq = AUDIO_SAMPLE_RATE;
+	desired.format = AUDIO_S16SYS;
+	desired.channels = 1;
+	desired.samples = static_cast<std::uint16_t>(buffer);
+	desired.callback = &c_apu::callback;
+	desired.userdata = this;
+
+	SDL_AudioDeviceID device = SDL_OpenAudioDevice(nullptr, 0, &desired, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+
+	if (device == 0)
+	{
+		std::printf("AUDIO ERROR: couldn't open an audio device: %s\n", SDL_GetError());
+		SDL_QuitSubSystem(SDL_INIT_AUDIO);
+		return;
+	}
+
+	this->samples_per_tick = obtained.freq / FRAMES_PER_SECOND;
+
+	/* whatever the device buffer doesn't use of the latency may sit in the ring as whole ticks */
+	long long buffered_ms = 1000ll * obtained.samples / obtained.freq;
+	this->backlog = latency.count() > buffered_ms ? static_cast<std::size_t>((latency.count() - buffered_ms) * FRAMES_PER_SECOND / 1000) : 0;
+
+	/* xo-chip plays the pattern at 4000 * 2 ^ ((pitch - 64) / 48) samples per second */
+	for (int pitch = 0; pitch < 256; pitch++)
+	{
+		this->pitch_steps[pitch] = phase_step(4000.0 * std::pow(2.0, (pitch - 64) / 48.0), obtained.freq);
+	}
+
+	this->beep_step = phase_step(AUDIO_BEEP_HZ * 128.0, obtained.freq);
+
+	/* the callback may start as soon as the device is unpaused, everything it reads is set by now */
+	this->device = device;
+	SDL_PauseAudioDevice(device, 0);
+}
+
+c_apu::~c_apu()
+{
+	if (this->device == 0)
+		return;
+
+	SDL_CloseAudioDevice(this->device);
+	SDL_QuitSubSystem(SDL_INIT_AUDIO);
+}
+
+void c_apu::callback(void* userdata, std::uint8_t* stream, int length)
+{
+	static_cast<c_apu*>(userdata)->render(reinterpret_cast<std::int16_t*>(stream), length / static_cast<int>(sizeof(std::int16_t)));
+}
+
+void c_apu::render(std::int16_t* samples, int count)
+{
+	int written = 0;
+
+	while (written < count)
+	{
+		if (this->samples_left == 0)
+		{
+			/* too far behind the emulator, skip the stale ticks instead of letting the delay grow */
+			while (this->ring.size() > this->backlog + 1)
+			{
+				this->ring.pop(this->current);
+			}
+
+			/* an empty ring means the emulator is late, the last tick carries on until it catches up */
+			this->ring.pop(this->current);
+			this->samples_left = this->samples_per_tick;
+		}
+
+		int run = std::min(count - written, this->samples_left);
+
+		if (this->current.mode == AUDIO_SILENT)
+		{
+			std::memset(samples + written, 0, run * sizeof(std::int16_t));
+		}
+		else
+		{
+			const std::uint8_t* pattern = this->current.mode == AUDIO_BEEP ? BEEP_PATTERN : this->current.pattern;
+			std::uint32_t step = this->current.mode == AUDIO_BEEP ? this->beep_step : this->pitch_steps[this->current.pitch];
+
+			for (int i = 0; i < run; i++)
+			{
+				std::uint32_t index = this->phase >> 25;
+				bool bit = (pattern[index >> 3] >> (7 - (index & 7))) & 1;
+
+				samples[written + i] = bit ? AMPLITUDE : -AMPLITUDE;
+				this->phase += step;
+			}
+		}
+
+		written += run;
+		this->samples_left -= run;
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include "../util/spsc_ring.hpp"
+
+/* 128 one bit samples, the size of the xo-chip pattern buffer */
+constexpr int AUDIO_PATTERN_BYTES = 16;
+
+constexpr int AUDIO_SAMPLE_RATE = 48000;
+constexpr int AUDIO_BEEP_HZ = 440;
+constexpr std::chrono::milliseconds DEFAULT_AUDIO_LATENCY{ 30 };
+
+enum AUDIO_MODE : std::uint8_t
+{
+	AUDIO_SILENT,
+	/* a plain square wave, what every machine without a loaded pattern makes */
+	AUDIO_BEEP,
+	/* the xo-chip pattern buffer at the rate its pitch register asks for */
+	AUDIO_PATTERN
+};
+
+/* what the sound hardware does for one 60 hz tick */
+struct audio_state_t
+{
+	std::uint8_t pattern[AUDIO_PATTERN_BYTES];
+	AUDIO_MODE mode;
+	std::uint8_t pitch;
+};
+
+/*
+*	sdl audio output. the emulation thread pushes one audio_state_t per tick
+*	into a lock-free ring and the sdl callback turns them into samples, one
+*	tick's worth per state. the callback never locks or allocates, and the
+*	emulation thread never waits on it: a full ring just drops the tick.
+*
+*	the latency asked for sizes the device buffer and how many ticks may queue
+*	up in the ring before the callback skips ahead to the newest.
+*/
+class c_apu
+{
+public:
+	c_apu(std::chrono::milliseconds latency = DEFAULT_AUDIO_LATENCY);
+	~c_apu();
+
+	c_apu(const c_apu&) = delete;
+	c_apu& operator=(const c_apu&) = delete;
+
+	bool is_open() const
+	{
+		return this->device != 0;
+	}
+
+	/* emulation thread only */
+	void push(const audio_state_t& state)
+	{
+		if (!this->ring.push(state))
+			this->dropped++;
+	}
+
+	std::uint64_t get_dropped() const
+	{
+		return this->dropped;
+	}
+
+	/* the sdl callback's side, public so the device can be driven without sdl */
+	void render(std::int16_t* samples, int count);
+private:
+	static void callback(void* userdata, std::uint8_t* stream, int length);
+
+	/* a second's worth of ticks, far more than any latency setting lets queue up */
+	c_spsc_ring<audio_state_t, 64> ring;
+	std::uint64_t dropped{};
+
+	std::uint32_t device{};
+	int samples_per_tick = AUDIO_SAMPLE_RATE / 60;
+
+	/* the most ticks left queued when the callback starts on a new one */
+	std::size_t backlog{};
+
+	/* pattern positions per sample, the top 7 bits of the phase index the 128 samples */
+	std::uint32_t pitch_steps[256]{};
+	std::uint32_t beep_step{};
+
+	/* callback thread only */
+	audio_state_t current{};
+	std::uint32_t phase{};
+	int samples_left{};
+};
@@ -1,23 +1,44 @@
 #include "chip8.hpp"
 #include "instructions.hpp"
-#include "../ppu/ppu.hpp"
+#include "decoder.hpp"
+#include "../ppu/display.hpp"
+#include "../apu/apu.hpp"
+#include "../jit/jit.hpp"
+#include "../aot/aot.hpp"
+#include "../trace/trace.hpp"
+#include "savestate.hpp"
+#include "movie.hpp"
+#include "../metrics/metrics.hpp"
+#include <SDL.h>
 #include <memory>
-
-c_chip8::c_chip8(const std::string& filename)
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cctype>
+#include <cstring>
+
+c_chip8::c_chip8(const std::string& filename, c_display* display)
+	: display(display), rng(std::random_device{}()), scheduler(*this)
 {
-	this->file.open(filename, std::ios::binary | std::ios::in);
+	this->set_keymap(DEFAULT_KEYMAP);
+
+	std::ifstream file(filename, std::ios::binary | std::ios::in);
 
-	if (this->file.is_open())
+	if (file.is_open())
 	{
-		this->file.seekg(0, std::ios::end);
-		this->length = this->file.tellg();
-		/* we add the max fontset bytes so we can put the data there ourselves. */
-		this->data = std::make_unique<std::uint8_t[]>(this->length + MAX_FONTSET_BYTES);
-		this->file.seekg(0, std::ios::beg);
-		this->file.read(reinterpret_cast<char*>(this->data.get()), this->length);
-
-		this->setup_fontset();
-		this->setup_pixels();
+		file.seekg(0, std::ios::end);
+		this->length = file.tellg();
+
+		if (this->length > MEMORY_SIZE - PROGRAM_START)
+		{
+			std::printf("EMULATOR ERROR: %s is %u bytes, only the first %u fit in memory\n", filename.c_str(), this->length, MEMORY_SIZE - PROGRAM_START);
+			this->length = MEMORY_SIZE - PROGRAM_START;
+		}
+
+		file.seekg(0, std::ios::beg);
+		file.read(reinterpret_cast<char*>(&this->data[PROGRAM_START]), this->length);
+
+		this->power_on();
 	}
 	else
 	{
@@ -25,15 +46,241 @@ c_chip8::c_chip8(const std::string& filename)
 	}
 }
 
+c_chip8::c_chip8(const std::uint8_t* rom, std::size_t length, c_display* display)
+	: display(display), rng(std::random_device{}()), scheduler(*this)
+{
+	this->set_keymap(DEFAULT_KEYMAP);
+
+	if (length > MEMORY_SIZE - PROGRAM_START)
+	{
+		std::printf("EMULATOR ERROR: rom is %zu bytes, only the first %u fit in memory\n", length, MEMORY_SIZE - PROGRAM_START);
+		length = MEMORY_SIZE - PROGRAM_START;
+	}
+
+	this->length = static_cast<unsigned int>(length);
+	std::memcpy(&this->data[PROGRAM_START], rom, length);
+
+	this->power_on();
+}
+
+c_chip8::~c_chip8() = default;
+
+void c_chip8::set_engine(ENGINE engine)
+{
+	if (engine == ENGINE_JIT && !c_jit::supported())
+	{
+		std::printf("EMULATOR WARNING: the jit needs an x86-64 host, using the interpreter\n");
+		engine = ENGINE_INTERPRETER;
+	}
+
+	this->aot = nullptr;
+
+	if (engine == ENGINE_AOT)
+	{
+		const aot_program_t* program = aot::find(&this->data[PROGRAM_START], this->length, this->machine);
+
+		if (program == nullptr)
+		{
+			std::printf("EMULATOR WARNING: no recompiled blocks are linked in for this rom, using the interpreter\n");
+			engine = ENGINE_INTERPRETER;
+		}
+		else
+		{
+			this->aot = std::make_unique<c_aot>(*this, *program);
+		}
+	}
+
+	this->engine = engine;
+	this->jit = engine == ENGINE_JIT ? std::make_unique<c_jit>(*this) : nullptr;
+}
+
+void c_chip8::set_trace_file(const std::string& filename)
+{
+	this->tracer = std::make_unique<c_tracer>(filename);
+
+	if (!this->tracer->is_open())
+		this->tracer = nullptr;
+}
+
+std::uint64_t c_chip8::run(std::uint64_t budget)
+{
+	this->idle = false;
+
+	/* compiled and recompiled blocks don't emit trace records, so a traced machine always interprets */
+	if (this->engine == ENGINE_JIT && this->tracer == nullptr)
+		return this->jit->execute(budget);
+
+	if (this->engine == ENGINE_AOT && this->tracer == nullptr)
+		return this->aot->execute(budget);
+
+	return this->execute(budget);
+}
+
+void c_chip8::power_on()
+{
+	this->registers.pc = PROGRAM_START;
+
+	this->setup_fontset();
+	this->setup_pixels();
+	this->setup_decoded();
+}
+
 void c_chip8::setup_pixels()
 {
-	this->pixel_array = std::make_unique<std::uint8_t[]>(64 * 32);
+	this->framebuffer.clear();
+}
+
+void c_chip8::setup_decoded()
+{
+	/* value-initialized entries are OP_DECODE, so the cache fills itself lazily */
+	this->decoded = std::make_unique<decoded_instruction_t[]>(MEMORY_SIZE);
+}
+
+void c_chip8::invalidate_decoded(std::uint32_t address, std::uint32_t count)
+{
+	/* a store running off the top of memory wraps to the bottom, each piece is invalidated on its own */
+	if (address + count > MEMORY_SIZE)
+	{
+		this->invalidate_decoded(0, std::min<std::uint32_t>(address + count - MEMORY_SIZE, MEMORY_SIZE));
+		count = MEMORY_SIZE - address;
+	}
+
+	/* the instruction starting one byte earlier also covers address */
+	std::uint32_t first = address > 0 ? address - 1 : 0;
+	std::uint32_t last = std::min<std::uint32_t>(address + count, MEMORY_SIZE);
+
+	for (std::uint32_t i = first; i < last; i++)
+	{
+		this->decoded[i].handler = OP_DECODE;
+	}
+
+	if (this->jit != nullptr)
+		this->jit->invalidate(address, count);
+
+	if (this->aot != nullptr)
+		this->aot->invalidate(address, count);
+}
+
+void c_chip8::memory_written(std::uint32_t address, std::uint32_t count)
+{
+	if (count == 0)
+		return;
+
+	/* a store running off the top of memory wraps to the bottom, so can its pages */
+	std::uint32_t first = address / MEMORY_PAGE_SIZE;
+	std::uint32_t last = (address + count - 1) / MEMORY_PAGE_SIZE;
+
+	this->stores++;
+
+	for (std::uint32_t page = first; page <= last; page++)
+	{
+		this->written_pages.set(page % MEMORY_PAGES);
+	}
+
+	this->invalidate_decoded(address, count);
+}
+
+void c_chip8::fork_from(const c_chip8& parent)
+{
+	if (this->machine != parent.machine)
+		this->set_machine(parent.machine);
+
+	std::bitset<MEMORY_PAGES> pages = this->written_pages | parent.written_pages;
+
+	for (std::uint32_t page = 0; page < MEMORY_PAGES; page++)
+	{
+		if (!pages.test(page))
+			continue;
+
+		std::uint32_t address = page * MEMORY_PAGE_SIZE;
+
+		if (std::memcmp(&this->data[address], &parent.data[address], MEMORY_PAGE_SIZE) == 0)
+			continue;
+
+		std::memcpy(&this->data[address], &parent.data[address], MEMORY_PAGE_SIZE);
+		this->invalidate_decoded(address, MEMORY_PAGE_SIZE);
+	}
+
+	/* a page only this machine wrote holds the rom again, keeping its bit just costs a compare next time */
+	this->written_pages = pages;
+
+	this->registers = parent.registers;
+	this->framebuffer = parent.framebuffer;
+	this->halted = parent.halted;
+	this->rng.set_state(parent.rng.get_state());
+	this->keypad = parent.keypad;
+
+	std::memcpy(this->flags, parent.flags, sizeof(this->flags));
+	std::memcpy(this->audio_pattern, parent.audio_pattern, sizeof(this->audio_pattern));
+	this->audio_pitch = parent.audio_pitch;
+
+	/* set_mode restarts the realtime clock, which a fork that isn't changing modes has no reason to pay for */
+	if (this->scheduler.get_mode() != parent.scheduler.get_mode())
+		this->scheduler.set_mode(parent.scheduler.get_mode());
+
+	this->scheduler.set_instructions_per_second(parent.scheduler.get_instructions_per_second());
+	this->scheduler.set_phase(parent.scheduler.get_remainder(), parent.scheduler.get_balance());
+}
+
+void c_chip8::set_machine(MACHINE machine)
+{
+	this->machine = machine;
+
+	/* the same word can mean something else under another instruction set */
+	this->invalidate_decoded(0, MEMORY_SIZE);
+}
+
+void c_chip8::set_keypad(std::uint16_t keys)
+{
+	std::uint16_t pressed = keys & ~this->keypad;
+	this->keypad = keys;
+
+	if (!this->registers.key_wait || pressed == 0)
+		return;
+
+	std::uint8_t key = 0;
+
+	while (!(pressed & (1 << key)))
+	{
+		key++;
+	}
+
+	this->registers.v[this->registers.key_register] = key;
+	this->registers.key_wait = false;
+}
+
+bool c_chip8::set_keymap(const std::string& keys)
+{
+	if (keys.size() != 16)
+	{
+		std::printf("EMULATOR ERROR: a keymap needs one host key for each of the 16 hex keys, got %zu\n", keys.size());
+		return false;
+	}
+
+	for (int i = 0; i < 16; i++)
+	{
+		/* sdl keycodes for letters and digits are the lowercase characters themselves */
+		this->keymap[i] = static_cast<std::int32_t>(std::tolower(static_cast<unsigned char>(keys[i])));
+	}
+
+	return true;
+}
+
+int c_chip8::keypad_index(std::int32_t sym) const
+{
+	for (int i = 0; i < 16; i++)
+	{
+		if (this->keymap[i] == sym)
+			return i;
+	}
+
+	return -1;
 }
 
 void c_chip8::setup_fontset()
 {
 
-	std::uint8_t* ptr = &this->data[this->length];
+	std::uint8_t* ptr = &this->data[FONTSET_START];
 
 	std::uint8_t fontset[MAX_FONTSET_BYTES] =
 	{
@@ -59,506 +306,625 @@ void c_chip8::setup_fontset()
 	{
 		ptr[i] = fontset[i];
 	}
+
+	std::uint8_t big_fontset[MAX_BIG_FONTSET_BYTES] =
+	{
+		0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+		0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+		0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+		0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+		0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+		0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+		0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+		0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+		0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+		0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+		0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+		0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+	};
+
+	std::memcpy(&this->data[BIG_FONTSET_START], big_fontset, sizeof(big_fontset));
 };
 
-void c_chip8::emulate()
+namespace
 {
-	SDL_Event evnt;
-
-	while (true)
+	/* the V register an instruction leaves its result in, the last one for the loads of a range, which is what the trace records */
+	std::uint8_t written_register(const decoded_instruction_t& entry)
 	{
-		if (register_ptr->register_array[REGISTERS::PC].value_union.value16 > this->length)
+		switch (entry.handler)
 		{
-			std::cin.get();
-			break;
+			case OP_LDVXBYTE:
+			case OP_ADDVXBYTE:
+			case OP_LDVXVY:
+			case OP_ORVXVY:
+			case OP_ANDVXVY:
+			case OP_XORVXVY:
+			case OP_ADDVXVY:
+			case OP_SUBVXVY:
+			case OP_SHRVX:
+			case OP_SUBNVXVY:
+			case OP_SHLVX:
+			case OP_RND:
+			case OP_LDVXDT:
+			case OP_LDV0VXFROMIARRAY:
+			case OP_LOADFLAGS:
+				return entry.x;
+
+			/* 5XY3 loads from VX towards VY */
+			case OP_LOADVXVY:
+				return entry.y;
+
+			default:
+				return TRACE_NO_REGISTER;
 		}
+	}
+}
 
-		std::uint16_t high_bits = this->data[register_ptr->register_array[REGISTERS::PC].value_union.value16];
-		std::uint8_t low_bits = this->data[register_ptr->register_array[REGISTERS::PC].value_union.value16 + 1];
-		std::uint16_t opcode = static_cast<std::uint16_t>(high_bits);
-		opcode <<= 8;
-		opcode |= low_bits;
+void c_chip8::trace_retired(std::uint16_t pc, const decoded_instruction_t& entry)
+{
+	trace_record_t record{};
 
-		std::printf("%X%X PC = %i\n", high_bits, low_bits, register_ptr->register_array[REGISTERS::PC].value_union.value16);
+	record.pc = pc;
+	record.opcode = entry.opcode;
+	record.i = this->registers.i;
+	record.reg = written_register(entry);
 
-		std::uint16_t opcode_instruction = opcode & 0xF000;
+	if (record.reg != TRACE_NO_REGISTER)
+		record.value = this->registers.v[record.reg];
 
-		switch (opcode_instruction)
-		{
-			case 0x0000:
-			{
-				/*std::uint8_t low_byte = opcode & 0x00FF;
+	this->tracer->record(record);
+}
 
-				switch (low_byte)
-				{
-					case LOWOPCODE::CLS:
-					{
-						instructions::cls();
+std::uint64_t c_chip8::execute(std::uint64_t budget)
+{
+	/* blocked on FX0A, nothing runs until set_keypad sees a press */
+	if (this->registers.key_wait)
+		return 0;
 
-						break;
-					}
+	this->idle_loop.reset();
 
-					case LOWOPCODE::RET:
-					{
-						instructions::ret();
+	bool counting = this->metrics != nullptr && this->metrics->count_opcodes;
 
-						break;
-					}
+	if (this->tracer != nullptr)
+		return counting ? this->execute_impl<true, true>(budget) : this->execute_impl<true, false>(budget);
 
-					default:
-					{
-						break;
-					}
+	return counting ? this->execute_impl<false, true>(budget) : this->execute_impl<false, false>(budget);
+}
 
-					break;*/
+/*
+*	TRACING and COUNTING are template parameters so the plain loop carries no trace or metrics code at all
+*/
+template<bool TRACING, bool COUNTING>
+std::uint64_t c_chip8::execute_impl(std::uint64_t budget)
+{
+	c_register& regs = this->registers;
+	std::uint16_t& pc = regs.pc;
+	decoded_instruction_t* entry = nullptr;
+	std::uint64_t executed = 0;
+	[[maybe_unused]] std::uint16_t traced_pc = 0;
+	[[maybe_unused]] std::uint64_t* counts = COUNTING ? this->metrics->handlers : nullptr;
+
+	/*
+	*	every handler ends in NEXT(), which fetches the following pre-decoded entry
+	*	and jumps straight to its handler. with computed goto each handler gets its
+	*	own indirect branch instead of all of them sharing the one in a switch.
+	*/
+#if defined(__GNUC__) || defined(__clang__)
+	static void* dispatch_table[OP_MAX] =
+	{
+		&&op_decode, &&op_invalid, &&op_cls, &&op_ret, &&op_jp, &&op_call,
+		&&op_sevxbyte, &&op_snevxbyte, &&op_sevxvy, &&op_ldvxbyte, &&op_addvxbyte,
+		&&op_ldvxvy, &&op_orvxvy, &&op_andvxvy, &&op_xorvxvy, &&op_addvxvy,
+		&&op_subvxvy, &&op_shrvx, &&op_subnvxvy, &&op_shlvx, &&op_snevxvy,
+		&&op_ldiaddr, &&op_jpv0addr, &&op_rnd, &&op_drw, &&op_skpvx, &&op_sknpvx,
+		&&op_ldvxdt, &&op_ldvxk, &&op_lddtvx, &&op_ldstvx, &&op_addivx, &&op_ldfvx,
+		&&op_ldbvx, &&op_ldiarrayfromv0vx, &&op_ldv0vxfromiarray, &&op_scd, &&op_scu,
+		&&op_scr, &&op_scl, &&op_exit, &&op_low, &&op_high, &&op_savevxvy, &&op_loadvxvy,
+		&&op_ldilong, &&op_plane, &&op_audio, &&op_ldhfvx, &&op_pitch, &&op_saveflags,
+		&&op_loadflags
+	};
 
-				break;
-				}
+	#define HANDLER(label, op) label
+	#define DISPATCH() goto *dispatch_table[entry->handler]
+#else
+	#define HANDLER(label, op) case op
+	#define DISPATCH() goto dispatch
+#endif
 
-			case HIOPCODE::JP:
-			{
-				std::uint16_t value = opcode & 0x0FFF;
-				value -= 0x200; // restore to new 0x00 base. .code sections in rom images are based at 0x200;
-				instructions::jmp(value);
-				break;
-			}
+	#define NEXT() goto fetch
+	#define VX regs.v[entry->x]
+	#define VY regs.v[entry->y]
 
-			case HIOPCODE::CALL:
-			{
-				std::uint16_t value = opcode & 0x0FFF;
-				instructions::call(value);
-				break;
-			}
+fetch:
+	if (executed >= budget)
+		goto done;
 
-			case HIOPCODE::SEVXBYTE:
-			{
-				std::uint16_t reg_id = opcode & 0x0F00;
-				reg_id >>= 8;
+	/* an instruction needs both of its bytes inside memory */
+	if (pc > MEMORY_SIZE - 2)
+	{
+		this->halted = true;
+		goto done;
+	}
 
-				std::uint8_t value = static_cast<std::uint8_t>(opcode & 0x00FF);
+	if constexpr (TRACING)
+	{
+		if (entry != nullptr)
+			this->trace_retired(traced_pc, *entry);
 
-				register_t& reg = reinterpret_cast<register_t&>(register_ptr->register_array[reg_id]);
+		traced_pc = pc;
+	}
 
-				instructions::se(reg, value);
-				break;
-			}
+	entry = &this->decoded[pc];
+	pc += 2;
+	executed++;
 
-			case HIOPCODE::SNEVXBYTE:
-			{
-				std::uint16_t reg_id = opcode & 0x0F00;
-				reg_id >>= 8;
-				
-				std::uint8_t value = static_cast<std::uint8_t>(opcode & 0x00FF);
-				
-				register_t& reg = reinterpret_cast<register_t&>(register_ptr->register_array[reg_id]);
-				instructions::sne(reg, value);
-				break;
-			}
+	if constexpr (COUNTING)
+		counts[entry->handler]++;
 
-			case HIOPCODE::SEVXVY:
-			{
-				std::uint16_t regx_id = opcode & 0x0F00;
-				regx_id >>= 8;
+	DISPATCH();
 
-				std::uint16_t regy_id = opcode & 0x00F0;
-				regy_id >>= 4;
+#if !(defined(__GNUC__) || defined(__clang__))
+dispatch:
+	switch (entry->handler)
+	{
+#endif
 
-				register_t& x = reinterpret_cast<register_t&>(register_ptr->register_array[regx_id]);
-				register_t& y = reinterpret_cast<register_t&>(register_ptr->register_array[regy_id]);
+	HANDLER(op_decode, OP_DECODE):
+	{
+		std::uint16_t address = pc - 2;
+		std::uint16_t opcode = static_cast<std::uint16_t>(this->data[address] << 8) | this->data[address + 1];
 
-				instructions::se_registers(x, y);
-				break;
-			}
+		*entry = decoder::decode(opcode, this->machine);
 
-			case HIOPCODE::LDVXBYTE:
-			{
-				std::uint16_t reg_id = opcode & 0x0F00;
-				reg_id >>= 8;
-				std::uint8_t value = static_cast<std::uint8_t>(opcode & 0x00FF);
-				register_t& reg = reinterpret_cast<register_t&>(register_ptr->register_array[reg_id]);
+		/* fetch counted this one before its handler was known */
+		if constexpr (COUNTING)
+		{
+			counts[OP_DECODE]--;
+			counts[entry->handler]++;
+		}
 
-				instructions::ld_byte(reg, value);
+		DISPATCH();
+	}
 
-				break;
-			}
+	HANDLER(op_invalid, OP_INVALID):
+		NEXT();
 
-			case HIOPCODE::LD:
-			{
-				std::uint8_t lower_4bit_code = opcode & 0x000F;
-				
-				switch (lower_4bit_code)
-				{
-					case LOWOPCODE::VXVY:
-					{
-						std::uint16_t regx_id = opcode & 0x0F00;
-						regx_id >>= 8;
+	HANDLER(op_cls, OP_CLS):
+		instructions::cls(*this);
+		NEXT();
 
-						std::uint16_t regy_id = opcode & 0x00F0;
-						regy_id >>= 4;
+	HANDLER(op_ret, OP_RET):
+		if (!instructions::ret(*this))
+			goto fault;
 
+		NEXT();
 
-						register_t& regx = reinterpret_cast<register_t&>(register_ptr->register_array[regx_id]);
-						register_t& regy = reinterpret_cast<register_t&>(register_ptr->register_array[regy_id]);
+	HANDLER(op_jp, OP_JP):
+		/* a short jump back may close a loop that only waits, the rest of the budget then goes in whole passes */
+		if constexpr (!TRACING && !COUNTING)
+		{
+			if (entry->imm < pc && pc - entry->imm <= IDLE_LOOP_BYTES)
+				executed += this->idle_loop.check(*this, pc - 2, executed, budget);
+		}
 
-						instructions::ld_registers(regx, regy);
-						break;
-					}
+		instructions::jmp(*this, entry->imm);
+		NEXT();
 
-					case LOWOPCODE::ORVXVY:
-					{
-						std::uint16_t regx_id = opcode & 0x0F00;
-						regx_id >>= 8;
+	HANDLER(op_call, OP_CALL):
+		if (!instructions::call(*this, entry->imm))
+			goto fault;
 
-						std::uint16_t regy_id = opcode & 0x00F0;
-						regy_id >>= 4;
+		NEXT();
 
+	HANDLER(op_sevxbyte, OP_SEVXBYTE):
+		instructions::se(*this, VX, static_cast<std::uint8_t>(entry->imm));
+		NEXT();
 
-						register_t& regx = reinterpret_cast<register_t&>(register_ptr->register_array[regx_id]);
-						register_t& regy = reinterpret_cast<register_t&>(register_ptr->register_array[regy_id]);
+	HANDLER(op_snevxbyte, OP_SNEVXBYTE):
+		instructions::sne(*this, VX, static_cast<std::uint8_t>(entry->imm));
+		NEXT();
 
-						instructions::or_registers(regx, regy);
-						break;
-					}
+	HANDLER(op_sevxvy, OP_SEVXVY):
+		instructions::se_registers(*this, VX, VY);
+		NEXT();
 
+	HANDLER(op_ldvxbyte, OP_LDVXBYTE):
+		instructions::ld_byte(VX, static_cast<std::uint8_t>(entry->imm));
+		NEXT();
 
-					case LOWOPCODE::ANDVXVY:
-					{
-						std::uint16_t regx_id = opcode & 0x0F00;
-						regx_id >>= 8;
+	HANDLER(op_addvxbyte, OP_ADDVXBYTE):
+		instructions::add_byte(VX, static_cast<std::uint8_t>(entry->imm));
+		NEXT();
 
-						std::uint16_t regy_id = opcode & 0x00F0;
-						regy_id >>= 4;
+	HANDLER(op_ldvxvy, OP_LDVXVY):
+		instructions::ld_registers(VX, VY);
+		NEXT();
 
+	HANDLER(op_orvxvy, OP_ORVXVY):
+		instructions::or_registers(VX, VY);
+		NEXT();
 
-						register_t& regx = reinterpret_cast<register_t&>(register_ptr->register_array[regx_id]);
-						register_t& regy = reinterpret_cast<register_t&>(register_ptr->register_array[regy_id]);
+	HANDLER(op_andvxvy, OP_ANDVXVY):
+		instructions::and_registers(VX, VY);
+		NEXT();
 
-						instructions::and_registers(regx, regy);
-						break;
-					}
+	HANDLER(op_xorvxvy, OP_XORVXVY):
+		instructions::xor_registers(VX, VY);
+		NEXT();
 
-					case LOWOPCODE::XORVXVY:
-					{
-						std::uint16_t regx_id = opcode & 0x0F00;
-						regx_id >>= 8;
+	HANDLER(op_addvxvy, OP_ADDVXVY):
+		instructions::add_registers(*this, VX, VY);
+		NEXT();
 
-						std::uint16_t regy_id = opcode & 0x00F0;
-						regy_id >>= 4;
+	HANDLER(op_subvxvy, OP_SUBVXVY):
+		instructions::sub_registers(*this, VX, VY);
+		NEXT();
 
+	HANDLER(op_shrvx, OP_SHRVX):
+		instructions::shr(*this, VX);
+		NEXT();
 
-						register_t& regx = reinterpret_cast<register_t&>(register_ptr->register_array[regx_id]);
-						register_t& regy = reinterpret_cast<register_t&>(register_ptr->register_array[regy_id]);
+	HANDLER(op_subnvxvy, OP_SUBNVXVY):
+		instructions::subn_registers(*this, VX, VY);
+		NEXT();
 
-						instructions::xor_registers(regx, regy);
-						break;
-					}
+	HANDLER(op_shlvx, OP_SHLVX):
+		instructions::shl(*this, VX);
+		NEXT();
 
-					case LOWOPCODE::ADDVXVY:
-					{
-						std::uint16_t regx_id = opcode & 0x0F00;
-						regx_id >>= 8;
+	HANDLER(op_snevxvy, OP_SNEVXVY):
+		instructions::sne_register(*this, VX, VY);
+		NEXT();
 
-						std::uint16_t regy_id = opcode & 0x00F0;
-						regy_id >>= 4;
+	HANDLER(op_ldiaddr, OP_LDIADDR):
+		instructions::ld_iaddr(*this, entry->imm);
+		NEXT();
 
+	HANDLER(op_jpv0addr, OP_JPV0ADDR):
+		instructions::jmp_registerv0addr(*this, entry->imm);
+		NEXT();
 
-						register_t& regx = reinterpret_cast<register_t&>(register_ptr->register_array[regx_id]);
-						register_t& regy = reinterpret_cast<register_t&>(register_ptr->register_array[regy_id]);
+	HANDLER(op_rnd, OP_RND):
+		instructions::rnd_registerbyte(*this, VX, static_cast<std::uint8_t>(entry->imm));
+		NEXT();
 
-						instructions::add_registers(regx, regy);
-						break;
-					}
+	HANDLER(op_drw, OP_DRW):
+		instructions::draw(*this, VX, VY, entry->n, this->data);
+		NEXT();
 
-					case LOWOPCODE::SUBVXVY:
-					{
-						std::uint16_t regx_id = opcode & 0x0F00;
-						regx_id >>= 8;
+	HANDLER(op_skpvx, OP_SKPVX):
+		instructions::skip_if_pressed(*this, VX);
+		NEXT();
 
-						std::uint16_t regy_id = opcode & 0x00F0;
-						regy_id >>= 4;
+	HANDLER(op_sknpvx, OP_SKNPVX):
+		instructions::skip_if_not_pressed(*this, VX);
+		NEXT();
 
+	HANDLER(op_ldvxdt, OP_LDVXDT):
+		instructions::ld_registerdt(*this, VX);
+		NEXT();
 
-						register_t& regx = reinterpret_cast<register_t&>(register_ptr->register_array[regx_id]);
-						register_t& regy = reinterpret_cast<register_t&>(register_ptr->register_array[regy_id]);
+	HANDLER(op_ldvxk, OP_LDVXK):
+		instructions::ld_key_into_register(*this, entry->x);
+		goto done;
 
-						instructions::sub_registers(regx, regy);
-						break;
-					}
+	HANDLER(op_lddtvx, OP_LDDTVX):
+		instructions::ld_registerintodt(*this, VX);
+		NEXT();
 
-					case LOWOPCODE::SHRVX1:
-					{
-						std::uint16_t reg_id = opcode & 0x0F00;
-						reg_id >>= 8;
+	HANDLER(op_ldstvx, OP_LDSTVX):
+		instructions::ld_registerintost(*this, VX);
+		NEXT();
 
-						register_t& reg = reinterpret_cast<register_t&>(register_ptr->register_array[reg_id]);
+	HANDLER(op_addivx, OP_ADDIVX):
+		instructions::add_ifromregister(regs.i, VX);
+		NEXT();
 
-						instructions::shr(reg);
-						break;
-					}
+	HANDLER(op_ldfvx, OP_LDFVX):
+		instructions::ld_fvx(*this, VX);
+		NEXT();
 
-					case LOWOPCODE::SUBNVXVY:
-					{
-						std::uint16_t regx_id = opcode & 0x0F00;
-						regx_id >>= 8;
+	HANDLER(op_ldbvx, OP_LDBVX):
+		instructions::ld_bvx(*this, VX, this->data);
+		NEXT();
 
-						std::uint16_t regy_id = opcode & 0x00F0;
-						regy_id >>= 4;
+	HANDLER(op_ldiarrayfromv0vx, OP_LDIARRAYFROMV0VX):
+		instructions::ld_iarrayfromregister(*this, entry->x, this->data);
+		NEXT();
 
+	HANDLER(op_ldv0vxfromiarray, OP_LDV0VXFROMIARRAY):
+		instructions::ld_registerarrayi(*this, entry->x, this->data);
+		NEXT();
 
-						register_t& regx = reinterpret_cast<register_t&>(register_ptr->register_array[regx_id]);
-						register_t& regy = reinterpret_cast<register_t&>(register_ptr->register_array[regy_id]);
+	HANDLER(op_scd, OP_SCD):
+		this->framebuffer.scroll_down(entry->n);
+		NEXT();
 
-						instructions::subn_registers(regx, regy);
-						break;
-					}
+	HANDLER(op_scu, OP_SCU):
+		this->framebuffer.scroll_up(entry->n);
+		NEXT();
 
+	HANDLER(op_scr, OP_SCR):
+		this->framebuffer.scroll_right();
+		NEXT();
 
-					case LOWOPCODE::SHLVX1:
-					{
-						std::uint16_t reg_id = opcode & 0x0F00;
-						reg_id >>= 8;
+	HANDLER(op_scl, OP_SCL):
+		this->framebuffer.scroll_left();
+		NEXT();
 
-						register_t& reg = reinterpret_cast<register_t&>(register_ptr->register_array[reg_id]);
+	HANDLER(op_exit, OP_EXIT):
+		/* the program is done, stay on 00FD like a halted machine stays on any other instruction */
+		pc -= 2;
+		this->halted = true;
+		goto done;
+
+	HANDLER(op_low, OP_LOW):
+		this->framebuffer.set_hires(false);
+		NEXT();
+
+	HANDLER(op_high, OP_HIGH):
+		this->framebuffer.set_hires(true);
+		NEXT();
+
+	HANDLER(op_savevxvy, OP_SAVEVXVY):
+		instructions::save_range(*this, entry->x, entry->y, this->data);
+		NEXT();
+
+	HANDLER(op_loadvxvy, OP_LOADVXVY):
+		instructions::load_range(*this, entry->x, entry->y, this->data);
+		NEXT();
+
+	HANDLER(op_ldilong, OP_LDILONG):
+		instructions::ld_ilong(*this, this->data);
+		NEXT();
+
+	HANDLER(op_plane, OP_PLANE):
+		instructions::select_planes(*this, entry->x);
+		NEXT();
+
+	HANDLER(op_audio, OP_AUDIO):
+		instructions::ld_audio(*this, this->data);
+		NEXT();
+
+	HANDLER(op_ldhfvx, OP_LDHFVX):
+		instructions::ld_hfvx(*this, VX);
+		NEXT();
+
+	HANDLER(op_pitch, OP_PITCH):
+		instructions::ld_pitch(*this, VX);
+		NEXT();
+
+	HANDLER(op_saveflags, OP_SAVEFLAGS):
+		instructions::save_flags(*this, entry->x);
+		NEXT();
+
+	HANDLER(op_loadflags, OP_LOADFLAGS):
+		instructions::load_flags(*this, entry->x);
+		NEXT();
+
+#if !(defined(__GNUC__) || defined(__clang__))
+	default:
+		NEXT();
+	}
+#endif
+
+	#undef HANDLER
+	#undef DISPATCH
+	#undef NEXT
+	#undef VX
+	#undef VY
+
+fault:
+	/* a broken call stack can't be recovered from, stop the machine on the instruction that broke it */
+	pc -= 2;
+	std::printf("EMULATOR ERROR: call stack %s at %03X\n", regs.fault == FAULT_STACK_OVERFLOW ? "overflow" : "underflow", pc);
+	this->halted = true;
+
+done:
+	if constexpr (TRACING)
+	{
+		if (entry != nullptr)
+			this->trace_retired(traced_pc, *entry);
+	}
 
-						instructions::shl(reg);
-						break;
-					}
+	return executed;
+}
 
-					default:
-					{
-						break;
-					}
+void c_chip8::emulate()
+{
+	using clock = std::chrono::steady_clock;
 
-					break;
-				}
+	SDL_Event evnt{};
 
-				break;
-			}
+	clock::time_point next_frame = clock::now() + FRAME_DURATION;
+	bool running = true;
+	bool rewinding = false;
 
-			case HIOPCODE::SNEVXVY:
-			{
-				std::uint16_t regx_id = opcode & 0x0F00;
-				regx_id >>= 8;
+	/* keys down right now, and keys that went down since the last poll even if they already came back up */
+	std::uint16_t held = 0;
+	std::uint16_t pressed = 0;
 
-				std::uint16_t regy_id = opcode & 0x00F0;
-				regy_id >>= 4;
+	/* fast forward ticks can be shorter than two clock reads, so only the first tick of each host frame is timed */
+	bool time_tick = true;
 
+	auto handle = [&](const SDL_Event& evnt)
+	{
+		if (evnt.type == SDL_QUIT)
+		{
+			running = false;
+			return;
+		}
 
-				register_t& regx = reinterpret_cast<register_t&>(register_ptr->register_array[regx_id]);
-				register_t& regy = reinterpret_cast<register_t&>(register_ptr->register_array[regy_id]);
+		if (evnt.type != SDL_KEYDOWN && evnt.type != SDL_KEYUP)
+			return;
 
-				instructions::sne_register(regx, regy);
-				break;
-			}
+		if (evnt.key.keysym.sym == SDLK_BACKSPACE)
+		{
+			rewinding = evnt.type == SDL_KEYDOWN;
+			return;
+		}
+
+		int key = this->keypad_index(evnt.key.keysym.sym);
+
+		if (key < 0)
+			return;
 
-			case HIOPCODE::LDIADDR:
+		std::uint16_t bit = static_cast<std::uint16_t>(1 << key);
+
+		if (evnt.type == SDL_KEYDOWN)
+		{
+			held |= bit;
+			pressed |= bit;
+		}
+		else
+		{
+			held &= static_cast<std::uint16_t>(~bit);
+		}
+	};
+
+	while (running)
+	{
+		bool stepping_back = rewinding && this->rewind != nullptr;
+
+		/* holding backspace steps back one frame per tick instead of emulating */
+		if (stepping_back)
+		{
+			/* a recording follows the rewind, the frames stepped back over were never played */
+			if (this->rewind->rewind(*this, 1) && this->movie != nullptr)
+				this->movie->drop(1);
+		}
+		else
+		{
+			if (this->movie != nullptr)
+				this->movie->record(this->keypad);
+
+			if (this->metrics != nullptr && time_tick)
 			{
-				std::uint16_t value = opcode & 0x0FFF;
-				value -= 0x200; /* rebase the image by subtracting 0x200 */
-				instructions::ld_iaddr(value);
-				break;
+				clock::time_point start = clock::now();
+				this->metrics->instructions += this->scheduler.tick();
+				this->metrics->tick_time.record(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count());
+				this->metrics->ticks++;
+				time_tick = false;
 			}
-
-			case HIOPCODE::JPV0ADDR:
+			else if (this->metrics != nullptr)
 			{
-				std::uint16_t value = opcode & 0x0FFF;
-
-				instructions::jmp_registerv0addr(value);
-				break;
+				this->metrics->instructions += this->scheduler.tick();
+				this->metrics->ticks++;
 			}
-
-			case HIOPCODE::RND:
+			else
 			{
-				std::uint16_t reg_id = opcode & 0x0F00;
-				reg_id >>= 8;
-				register_t& reg = reinterpret_cast<register_t&>(register_ptr->register_array[reg_id]);
-			
-				std::uint8_t value = static_cast<std::uint8_t>(opcode & 0x00FF);
-
-				instructions::rnd_registerbyte(reg, value);
-				break;
+				this->scheduler.tick();
 			}
 
-			case HIOPCODE::DRW:
-			{
-				std::uint16_t regx_id = opcode & 0x0F00;
-				regx_id >>= 8;
-				register_t& regx = reinterpret_cast<register_t&>(register_ptr->register_array[regx_id]);
+			if (this->rewind != nullptr)
+				this->rewind->capture(*this);
+		}
 
-				std::uint16_t regy_id = opcode & 0x00F0;
-				regy_id >>= 4;
-				register_t& regy = reinterpret_cast<register_t&>(register_ptr->register_array[regy_id]);
+		/* one state per tick, stepping back and a stopped machine are silent whatever the timer says */
+		if (this->apu != nullptr)
+		{
+			audio_state_t state{};
 
-				std::uint8_t n = opcode & 0x000F;
+			if (this->scheduler.get_sounding() && !stepping_back && !this->halted)
+			{
+				bool has_pattern = std::any_of(std::begin(this->audio_pattern), std::end(this->audio_pattern), [](std::uint8_t byte) { return byte != 0; });
 
-				instructions::draw(regx, regx, n, this->data.get(), this->pixel_array.get());
-				break;
+				/* xo-chip roms that never load a pattern still expect the plain beep */
+				if (this->machine == MACHINE_XOCHIP && has_pattern)
+				{
+					state.mode = AUDIO_PATTERN;
+					state.pitch = this->audio_pitch;
+					std::memcpy(state.pattern, this->audio_pattern, sizeof(state.pattern));
+				}
+				else
+				{
+					state.mode = AUDIO_BEEP;
+				}
 			}
 
-			/* implement skp if pressed or not pressed here soon ! */
-			case HIOPCODE::SKP:
+			this->apu->push(state);
+		}
+
+		if (this->halted)
+		{
+			std::cin.get();
+			break;
+		}
+
+		clock::time_point now = clock::now();
+
+		/* fast forward and turbo run many ticks per host frame, input and video only need one */
+		if (this->scheduler.get_mode() == SPEED_REALTIME || now >= next_frame)
+		{
+			while (SDL_PollEvent(&evnt))
 			{
-				std::uint8_t lower_byte_code = static_cast<std::uint8_t>(opcode & 0x00FF);
-				
-				switch (lower_byte_code)
-				{
-					case LOWOPCODE::SKPVX:
-					{
-						std::uint16_t regx_id = opcode & 0x0F00;
-						regx_id >>= 8;
-						register_t& regx = reinterpret_cast<register_t&>(register_ptr->register_array[regx_id]);
-
-						instructions::skip_if_pressed(regx, evnt);
-						
-						break;
-					}
-
-					case LOWOPCODE::SKNPVX:
-					{
-						std::uint16_t regx_id = opcode & 0x0F00;
-						regx_id >>= 8;
-						register_t& regx = reinterpret_cast<register_t&>(register_ptr->register_array[regx_id]);
-
-						instructions::skip_if_not_pressed(regx, evnt);
-
-						break;
-					}
-
-					default:
-					{
-						break;
-					}
-
-					break;
-				}
-			
-				break;
+				handle(evnt);
 			}
 
-			case HIOPCODE::LDSPECIAL:
+			/* the keypad only changes here, once per frame, so a tap shorter than a frame still lasts one tick */
+			this->set_keypad(held | pressed);
+			pressed = 0;
+
+			if (this->display != nullptr)
 			{
-				std::uint8_t lower_byte_code = static_cast<std::uint8_t>(opcode & 0x00FF);
+				clock::time_point start = clock::now();
+				this->display->frame(this->framebuffer);
 
-				switch (lower_byte_code)
-				{
-					case LOWOPCODE::LDVXDT:
-					{	
-						std::uint16_t reg_id = opcode & 0x0F00;
-						reg_id >>= 8;
-
-						register_t& reg = reinterpret_cast<register_t&>(register_ptr->register_array[reg_id]);
-
-						instructions::ld_registerdt(reg);
-						break;
-					}
-					case LOWOPCODE::LDVXK:
-					{	std::uint16_t reg_id = opcode & 0x0F00;
-						reg_id >>= 8;
-
-						register_t& reg = reinterpret_cast<register_t&>(register_ptr->register_array[reg_id]);
-
-						instructions::ld_key_into_register(reg, evnt);
-						break;
-					}
-					case LOWOPCODE::LDDTVX:
-					{
-						std::uint16_t reg_id = opcode & 0x0F00;
-						reg_id >>= 8;
-
-						register_t& reg = reinterpret_cast<register_t&>(register_ptr->register_array[reg_id]);
-
-						instructions::ld_registerintodt(reg);
-						break;
-					}
-					case LOWOPCODE::LDSTVX:
-					{
-						std::uint16_t reg_id = opcode & 0x0F00;
-						reg_id >>= 8;
-
-						register_t& reg = reinterpret_cast<register_t&>(register_ptr->register_array[reg_id]);
-
-						instructions::ld_registerintost(reg);
-						break;
-					}
-					case LOWOPCODE::ADDIVX:
-					{
-						std::uint16_t reg_id = opcode & 0x0F00;
-						reg_id >>= 8;
-
-						register_t& reg = reinterpret_cast<register_t&>(register_ptr->register_array[reg_id]);
-						register_t& i = reinterpret_cast<register_t&>(register_ptr->register_array[REGISTERS::VI]);
-
-						instructions::add_ifromregister(i, reg);
-						break;
-					}
-					case LOWOPCODE::LDFVX:
-					{
-						/*IMPLEMENTATION FOR LD F, VX*/
-						std::uint16_t reg_id = opcode & 0x0F00;
-						reg_id >>= 8;
-
-						register_t& reg = reinterpret_cast<register_t&>(register_ptr->register_array[reg_id]);
-
-						instructions::ld_fvx(reg, this->length);
-						break;
-					}
-					case LOWOPCODE::LDBVX:
-					{
-						std::uint16_t reg_id = opcode & 0x0F00;
-						reg_id >>= 8;
-
-						register_t& reg = reinterpret_cast<register_t&>(register_ptr->register_array[reg_id]);
-
-						instructions::ld_bvx(reg, this->data.get());
-						break;
-					}
-					case LOWOPCODE::LDIARRAYFROMV0VX:
-					{
-						std::uint16_t byte = opcode & 0x0F00;
-						byte >>= 8;
-
-						std::uint8_t n = static_cast<std::uint8_t>(byte);
-
-
-						instructions::ld_iarrayfromregister(n, this->data.get());
-
-						break;
-					}
-					case LOWOPCODE::LDV0VXFROMIARRAY:
-					{
-						std::uint16_t byte = opcode & 0x0F00;
-						byte >>= 8;
-
-						std::uint8_t n = static_cast<std::uint8_t>(byte);
-
-						instructions::ld_registerarrayi(n, this->data.get());
-						break;
-					}
-
-					default:
-					{
-						break;
-					}
-
-					break;
-				}
+				if (this->metrics != nullptr)
+					this->metrics->present_time.record(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count());
+			}
 
-				break;
+			next_frame += FRAME_DURATION;
+			time_tick = true;
+
+			/* don't try to catch up on frames we fell behind on */
+			if (next_frame < now)
+			{
+				if (this->metrics != nullptr)
+					this->metrics->frames_dropped += (now - next_frame) / FRAME_DURATION + 1;
+
+				next_frame = now + FRAME_DURATION;
 			}
 
-			default:
+			if (this->metrics != nullptr && this->metrics->due(now))
 			{
-				break;
+				/* compiled blocks are only counted per run until the jit folds them in */
+				if (this->jit != nullptr)
+					this->jit->collect();
+
+				this->metrics->dump(*this, now);
 			}
+		}
 
-			break;
+		/*
+		*	a machine blocked on FX0A has nothing to run, so rather than looping
+		*	the host sleeps in the event queue until a key arrives or the next
+		*	deadline. whatever arrives is applied at the next poll like any other input.
+		*/
+		if (this->registers.key_wait && running)
+		{
+			clock::time_point deadline = this->scheduler.get_mode() == SPEED_REALTIME ? this->scheduler.get_next_tick() : next_frame;
+			long long timeout = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now()).count();
+
+			if (timeout > 0 && SDL_WaitEventTimeout(&evnt, static_cast<int>(timeout)))
+				handle(evnt);
 		}
 
-		if (SDL_PollEvent(&evnt) && evnt.type == SDL_QUIT)
-			break;
+		this->scheduler.wait();
+	}
 
-		SDL_RenderPresent(ppu_ptr->get_renderer());
+	if (this->metrics != nullptr)
+	{
+		if (this->jit != nullptr)
+			this->jit->collect();
 
-		register_ptr->register_array[REGISTERS::PC].value_union.value16 += 2;
+		this->metrics->dump(*this, clock::now());
 	}
-}
\ No newline at end of file
+
+	if (this->display != nullptr)
+		std::printf("frames presented: %llu, skipped: %llu\n", static_cast<unsigned long long>(this->display->get_frames_presented()), static_cast<unsigned long long>(this->display->get_frames_skipped()));
+}
@@ -6,25 +6,199 @@
 #include <memory>
 #include <vector>
 #include <bitset>
+#include <chrono>
 #include "registers.hpp"
+#include "decoder.hpp"
+#include "scheduler.hpp"
+#include "rng.hpp"
+#include "idle.hpp"
+#include "../ppu/framebuffer.hpp"
 
-static std::unique_ptr<c_register> register_ptr = std::make_unique<c_register>();
+class c_display;
+class c_apu;
+class c_jit;
+class c_aot;
+class c_tracer;
+class c_rewind;
+class c_movie;
+class c_metrics;
 
 constexpr int MAX_FONTSET_BYTES = 0x50;
 
+/* the super-chip 8x10 digits FX30 points at, 10 bytes each */
+constexpr int MAX_BIG_FONTSET_BYTES = 0xA0;
+
+/*
+*	guest memory is one flat image laid out the way the original interpreter
+*	had it: the font in low memory and the rom loaded at 0x200, so program
+*	addresses index it directly. building with CHIP8_MEMORY_64K widens it to
+*	the 64 KB address space XO-CHIP programs expect.
+*/
+#if defined(CHIP8_MEMORY_64K)
+constexpr std::uint32_t MEMORY_SIZE = 0x10000;
+#else
+constexpr std::uint32_t MEMORY_SIZE = 0x1000;
+#endif
+
+/* the image is a power of two, so wrapping an address is a single and */
+constexpr std::uint32_t MEMORY_MASK = MEMORY_SIZE - 1;
+
+/* forks share memory by 256 byte page, see fork_from */
+constexpr std::uint32_t MEMORY_PAGE_SIZE = 0x100;
+constexpr std::uint32_t MEMORY_PAGES = MEMORY_SIZE / MEMORY_PAGE_SIZE;
+constexpr std::uint16_t FONTSET_START = 0x000;
+constexpr std::uint16_t BIG_FONTSET_START = FONTSET_START + MAX_FONTSET_BYTES;
+constexpr std::uint16_t PROGRAM_START = 0x200;
+
+enum ENGINE
+{
+	ENGINE_INTERPRETER,
+	ENGINE_JIT,
+	/* blocks the recompile tool generated for this rom, linked into the executable */
+	ENGINE_AOT
+};
+
+constexpr int FRAMES_PER_SECOND = 60;
+constexpr std::chrono::nanoseconds FRAME_DURATION{ 1000000000 / FRAMES_PER_SECOND };
+
+/* the xo-chip pitch register's power on value, which plays the pattern at 4000 hz */
+constexpr std::uint8_t DEFAULT_AUDIO_PITCH = 64;
+
+/* instructions run between clock checks in turbo mode */
+constexpr std::uint64_t INSTRUCTIONS_PER_SLICE = 256;
+
+/* the left four columns of a qwerty keyboard, in hex key order 0 through F */
+constexpr const char* DEFAULT_KEYMAP = "x123qweasdzc4rfv";
+
+/*
+*	every piece of machine state lives on the instance, so any number of
+*	c_chip8 objects can run side by side on separate threads.
+*/
 class c_chip8
 {
 public:
-	c_chip8(const std::string& filename);
+	c_chip8(const std::string& filename, c_display* display = nullptr);
+
+	/* loads from a rom already in memory, such as one mapped from a c_rom_pack */
+	c_chip8(const std::uint8_t* rom, std::size_t length, c_display* display = nullptr);
+	~c_chip8();
 
 	void emulate();
+	std::uint64_t run(std::uint64_t budget);
+	std::uint64_t execute(std::uint64_t budget);
+	void set_engine(ENGINE engine);
+	void set_trace_file(const std::string& filename);
 	void setup_fontset();
 	void setup_pixels();
+	void setup_decoded();
+	void invalidate_decoded(std::uint32_t address, std::uint32_t count);
+
+	/* every guest store goes through here, it drops what was decoded from the bytes and marks their pages written */
+	void memory_written(std::uint32_t address, std::uint32_t count);
+
+	/*
+	*	turns this machine into a copy of parent, which has to have been loaded
+	*	from the same rom. memory pages neither of them ever wrote still hold the
+	*	rom image, so only pages either one wrote are compared and copied, and
+	*	only the decodes of pages that actually changed are dropped. the display,
+	*	sound and the optional recorders stay this machine's own.
+	*/
+	void fork_from(const c_chip8& parent);
+
+	/* latches the keys held for the coming tick and releases an FX0A wait on a fresh press */
+	void set_keypad(std::uint16_t keys);
+
+	/* host keys for hex keys 0 through F as a string of 16 letters or digits, see DEFAULT_KEYMAP */
+	bool set_keymap(const std::string& keys);
+
+	/* picks the instruction set, everything decoded or compiled so far is dropped */
+	void set_machine(MACHINE machine);
+
+	MACHINE get_machine() const
+	{
+		return this->machine;
+	}
+
+	/* how many stores memory_written has seen, two equal counts mean memory didn't change in between */
+	std::uint32_t get_stores() const
+	{
+		return this->stores;
+	}
+
+	/* size of the loaded rom in bytes, not of the memory it lives in */
+	unsigned int get_length() const
+	{
+		return this->length;
+	}
+
+	c_register registers{};
+	alignas(64) std::uint8_t data[MEMORY_SIZE]{};
+	c_framebuffer framebuffer{};
 
-	std::unique_ptr<std::uint8_t[]> data{};
-	std::uint8_t* ptr_to_fontset{};
-	std::unique_ptr<std::uint8_t[]> pixel_array{};
+	/* one pre-decoded entry per memory byte, indexed by PC */
+	std::unique_ptr<decoded_instruction_t[]> decoded{};
+	bool halted{};
+
+	/* set when the last run found the program in a loop that only waits on the timers or a key, see c_idle_loop */
+	bool idle{};
+
+	/* instructions the idle check retired without running them, they count as retired but throughput figures leave them out */
+	std::uint64_t idle_skipped{};
+
+	/* optional, without a display the machine runs headless */
+	c_display* display{};
+
+	/* optional, without one the sound timer runs silently */
+	c_apu* apu{};
+	c_rng rng;
+	c_scheduler scheduler;
+
+	/* one bit per hex key, bit n set while key n is held. written through set_keypad */
+	std::uint16_t keypad{};
+
+	/* the super-chip flag registers FX75 and FX85 copy V registers to and from */
+	std::uint8_t flags[16]{};
+
+	/* xo-chip 1-bit audio, 128 samples loaded by F002 and played at a rate FX3A sets */
+	std::uint8_t audio_pattern[16]{};
+	std::uint8_t audio_pitch = DEFAULT_AUDIO_PITCH;
+
+	/* optional rewind history, emulate captures every tick into it */
+	std::unique_ptr<c_rewind> rewind{};
+
+	/* optional input recording, emulate appends the keypad of every tick to it */
+	std::unique_ptr<c_movie> movie{};
+
+	/* optional runtime counters, null unless requested so an unmeasured machine pays nothing */
+	std::unique_ptr<c_metrics> metrics{};
 private:
+	template<bool TRACING, bool COUNTING>
+	std::uint64_t execute_impl(std::uint64_t budget);
+	void trace_retired(std::uint16_t pc, const decoded_instruction_t& entry);
+
+	/* resets the cpu and the caches once the rom is in memory */
+	void power_on();
+
+	int keypad_index(std::int32_t sym) const;
+
+	ENGINE engine = ENGINE_INTERPRETER;
+	MACHINE machine = MACHINE_CHIP8;
+
+	/* host keycode per hex key, keycodes for letters and digits are their lowercase ascii */
+	std::int32_t keymap[16]{};
+	std::unique_ptr<c_jit> jit{};
+	std::unique_ptr<c_aot> aot{};
+
+	/* null unless tracing was requested */
+	std::unique_ptr<c_tracer> tracer{};
+
 	unsigned int length{};
-	std::ifstream file;
-};
\ No newline at end of file
+
+	std::uint32_t stores{};
+
+	/* the interpreter's, the jit and the recompiled engine keep their own */
+	c_idle_loop idle_loop{};
+
+	/* pages stored to since power on, anything else still matches the rom */
+	std::bitset<MEMORY_PAGES> written_pages{};
+};
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "opcodes.hpp"
+
+/*
+*	which instruction set a machine decodes. super-chip adds the 128x64 mode,
+*	16x16 sprites, scrolling and the flag registers, xo-chip adds bitplanes,
+*	the long I load, register ranges and the audio pattern on top of that.
+*/
+enum MACHINE : std::uint8_t
+{
+	MACHINE_CHIP8,
+	MACHINE_SCHIP,
+	MACHINE_XOCHIP
+};
+
+/* chip8, schip or xochip, false for anything else */
+inline bool machine_from_name(const std::string& name, MACHINE& machine)
+{
+	if (name == "chip8")
+		machine = MACHINE_CHIP8;
+	else if (name == "schip")
+		machine = MACHINE_SCHIP;
+	else if (name == "xochip")
+		machine = MACHINE_XOCHIP;
+	else
+		return false;
+
+	return true;
+}
+
+/* the extensions the rom archives use, anything but .sc8 and .xo8 is plain chip-8 */
+inline MACHINE machine_from_extension(const std::string& extension)
+{
+	if (extension == ".sc8")
+		return MACHINE_SCHIP;
+
+	if (extension == ".xo8")
+		return MACHINE_XOCHIP;
+
+	return MACHINE_CHIP8;
+}
+
+/*
+*	one entry per handler in the threaded dispatch table of c_chip8::execute.
+*	the order here must match the label table built there.
+*/
+enum DECODED_OP : std::uint8_t
+{
+	OP_DECODE,
+	OP_INVALID,
+	OP_CLS,
+	OP_RET,
+	OP_JP,
+	OP_CALL,
+	OP_SEVXBYTE,
+	OP_SNEVXBYTE,
+	OP_SEVXVY,
+	OP_LDVXBYTE,
+	OP_ADDVXBYTE,
+	OP_LDVXVY,
+	OP_ORVXVY,
+	OP_ANDVXVY,
+	OP_XORVXVY,
+	OP_ADDVXVY,
+	OP_SUBVXVY,
+	OP_SHRVX,
+	OP_SUBNVXVY,
+	OP_SHLVX,
+	OP_SNEVXVY,
+	OP_LDIADDR,
+	OP_JPV0ADDR,
+	OP_RND,
+	OP_DRW,
+	OP_SKPVX,
+	OP_SKNPVX,
+	OP_LDVXDT,
+	OP_LDVXK,
+	OP_LDDTVX,
+	OP_LDSTVX,
+	OP_ADDIVX,
+	OP_LDFVX,
+	OP_LDBVX,
+	OP_LDIARRAYFROMV0VX,
+	OP_LDV0VXFROMIARRAY,
+	OP_SCD,
+	OP_SCU,
+	OP_SCR,
+	OP_SCL,
+	OP_EXIT,
+	OP_LOW,
+	OP_HIGH,
+	OP_SAVEVXVY,
+	OP_LOADVXVY,
+	OP_LDILONG,
+	OP_PLANE,
+	OP_AUDIO,
+	OP_LDHFVX,
+	OP_PITCH,
+	OP_SAVEFLAGS,
+	OP_LOADFLAGS,
+
+	OP_MAX
+};
+
+/*
+*	a rom word after decode. x, y and imm are pulled out of the opcode once so
+*	the handlers never have to mask them again. a zeroed entry is OP_DECODE,
+*	which makes a freshly allocated cache decode itself lazily.
+*/
+struct decoded_instruction_t
+{
+	std::uint8_t handler;
+	std::uint8_t x;
+	std::uint8_t y;
+	std::uint8_t n;
+	std::uint16_t imm;
+	std::uint16_t opcode;
+};
+
+namespace decoder
+{
+	/* opcodes outside the machine's instruction set decode to OP_INVALID like any unknown word */
+	inline decoded_instruction_t decode(std::uint16_t opcode, MACHINE machine = MACHINE_CHIP8)
+	{
+		decoded_instruction_t entry{};
+
+		entry.opcode = opcode;
+		entry.x = static_cast<std::uint8_t>((opcode & 0x0F00) >> 8);
+		entry.y = static_cast<std::uint8_t>((opcode & 0x00F0) >> 4);
+		entry.n = static_cast<std::uint8_t>(opcode & 0x000F);
+		entry.imm = opcode & 0x00FF;
+		entry.handler = OP_INVALID;
+
+		std::uint8_t low_byte = static_cast<std::uint8_t>(opcode & 0x00FF);
+
+		switch (opcode & 0xF000)
+		{
+			case 0x0000:
+			{
+				if (low_byte == LOWOPCODE::CLS)
+					entry.handler = OP_CLS;
+				else if (low_byte == LOWOPCODE::RET)
+					entry.handler = OP_RET;
+
+				if (machine == MACHINE_CHIP8 || entry.x != 0)
+					break;
+
+				if ((low_byte & 0xF0) == LOWOPCODE::SCD)
+					entry.handler = OP_SCD;
+				else if ((low_byte & 0xF0) == LOWOPCODE::SCU && machine == MACHINE_XOCHIP)
+					entry.handler = OP_SCU;
+				else if (low_byte == LOWOPCODE::SCR)
+					entry.handler = OP_SCR;
+				else if (low_byte == LOWOPCODE::SCL)
+					entry.handler = OP_SCL;
+				else if (low_byte == LOWOPCODE::EXIT)
+					entry.handler = OP_EXIT;
+				else if (low_byte == LOWOPCODE::LOW)
+					entry.handler = OP_LOW;
+				else if (low_byte == LOWOPCODE::HIGH)
+					entry.handler = OP_HIGH;
+
+				break;
+			}
+
+			case HIOPCODE::JP:
+			{
+				entry.handler = OP_JP;
+				entry.imm = opcode & 0x0FFF;
+				break;
+			}
+
+			case HIOPCODE::CALL:
+			{
+				entry.handler = OP_CALL;
+				entry.imm = opcode & 0x0FFF;
+				break;
+			}
+
+			case HIOPCODE::SEVXBYTE: entry.handler = OP_SEVXBYTE; break;
+			case HIOPCODE::SNEVXBYTE: entry.handler = OP_SNEVXBYTE; break;
+			case HIOPCODE::SEVXVY:
+			{
+				entry.handler = OP_SEVXVY;
+
+				if (machine == MACHINE_XOCHIP && entry.n == LOWOPCODE::SAVEVXVY)
+					entry.handler = OP_SAVEVXVY;
+				else if (machine == MACHINE_XOCHIP && entry.n == LOWOPCODE::LOADVXVY)
+					entry.handler = OP_LOADVXVY;
+
+				break;
+			}
+
+			case HIOPCODE::LDVXBYTE: entry.handler = OP_LDVXBYTE; break;
+			case HIOPCODE::ADDVXBYTE: entry.handler = OP_ADDVXBYTE; break;
+
+			case HIOPCODE::LD:
+			{
+				switch (entry.n)
+				{
+					case LOWOPCODE::VXVY: entry.handler = OP_LDVXVY; break;
+					case LOWOPCODE::ORVXVY: entry.handler = OP_ORVXVY; break;
+					case LOWOPCODE::ANDVXVY: entry.handler = OP_ANDVXVY; break;
+					case LOWOPCODE::XORVXVY: entry.handler = OP_XORVXVY; break;
+					case LOWOPCODE::ADDVXVY: entry.handler = OP_ADDVXVY; break;
+					case LOWOPCODE::SUBVXVY: entry.handler = OP_SUBVXVY; break;
+					case LOWOPCODE::SHRVX1: entry.handler = OP_SHRVX; break;
+					case LOWOPCODE::SUBNVXVY: entry.handler = OP_SUBNVXVY; break;
+					case LOWOPCODE::SHLVX1: entry.handler = OP_SHLVX; break;
+					default: break;
+				}
+
+				break;
+			}
+
+			case HIOPCODE::SNEVXVY: entry.handler = OP_SNEVXVY; break;
+
+			case HIOPCODE::LDIADDR:
+			{
+				entry.handler = OP_LDIADDR;
+				entry.imm = opcode & 0x0FFF;
+				break;
+			}
+
+			case HIOPCODE::JPV0ADDR:
+			{
+				entry.handler = OP_JPV0ADDR;
+				entry.imm = opcode & 0x0FFF;
+				break;
+			}
+
+			case HIOPCODE::RND: entry.handler = OP_RND; break;
+			case HIOPCODE::DRW: entry.handler = OP_DRW; break;
+
+			case HIOPCODE::SKP:
+			{
+				if (low_byte == LOWOPCODE::SKPVX)
+					entry.handler = OP_SKPVX;
+				else if (low_byte == LOWOPCODE::SKNPVX)
+					entry.handler = OP_SKNPVX;
+
+				break;
+			}
+
+			case HIOPCODE::LDSPECIAL:
+			{
+				switch (low_byte)
+				{
+					case LOWOPCODE::LDVXDT: entry.handler = OP_LDVXDT; break;
+					case LOWOPCODE::LDVXK: entry.handler = OP_LDVXK; break;
+					case LOWOPCODE::LDDTVX: entry.handler = OP_LDDTVX; break;
+					case LOWOPCODE::LDSTVX: entry.handler = OP_LDSTVX; break;
+					case LOWOPCODE::ADDIVX: entry.handler = OP_ADDIVX; break;
+					case LOWOPCODE::LDFVX: entry.handler = OP_LDFVX; break;
+					case LOWOPCODE::LDBVX: entry.handler = OP_LDBVX; break;
+					case LOWOPCODE::LDIARRAYFROMV0VX: entry.handler = OP_LDIARRAYFROMV0VX; break;
+					case LOWOPCODE::LDV0VXFROMIARRAY: entry.handler = OP_LDV0VXFROMIARRAY; break;
+					default: break;
+				}
+
+				if (machine == MACHINE_CHIP8)
+					break;
+
+				switch (low_byte)
+				{
+					case LOWOPCODE::LDHFVX: entry.handler = OP_LDHFVX; break;
+					case LOWOPCODE::SAVEFLAGS: entry.handler = OP_SAVEFLAGS; break;
+					case LOWOPCODE::LOADFLAGS: entry.handler = OP_LOADFLAGS; break;
+					default: break;
+				}
+
+				if (machine != MACHINE_XOCHIP)
+					break;
+
+				/* F000 takes the address from the word after it, FN01 picks the planes in N */
+				if (opcode == 0xF000)
+					entry.handler = OP_LDILONG;
+				else if (opcode == 0xF002)
+					entry.handler = OP_AUDIO;
+				else if (low_byte == LOWOPCODE::PLANE)
+					entry.handler = OP_PLANE;
+				else if (low_byte == LOWOPCODE::PITCH)
+					entry.handler = OP_PITCH;
+
+				break;
+			}
+
+			default:
+			{
+				break;
+			}
+		}
+
+		return entry;
+	}
+}
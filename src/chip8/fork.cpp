@@ -0,0 +1,49 @@
+#include "fork.hpp"
+
+c_fork_pool::c_fork_pool(const std::uint8_t* rom, std::size_t length, MACHINE machine)
+	: rom(rom, rom + length), machine(machine)
+{
+}
+
+std::unique_ptr<c_chip8> c_fork_pool::create()
+{
+	/* a recycled machine would have to be powered back on, a new one already is */
+	std::unique_ptr<c_chip8> chip8 = std::make_unique<c_chip8>(this->rom.data(), this->rom.size());
+
+	chip8->set_machine(this->machine);
+	return chip8;
+}
+
+std::unique_ptr<c_chip8> c_fork_pool::fork(const c_chip8& parent)
+{
+	std::unique_ptr<c_chip8> chip8{};
+
+	if (this->free.empty())
+	{
+		chip8 = this->create();
+	}
+	else
+	{
+		chip8 = std::move(this->free.back());
+		this->free.pop_back();
+	}
+
+	chip8->fork_from(parent);
+	return chip8;
+}
+
+void c_fork_pool::recycle(std::unique_ptr<c_chip8> chip8)
+{
+	if (chip8 != nullptr)
+		this->free.push_back(std::move(chip8));
+}
+
+void c_fork_pool::reserve(std::size_t count)
+{
+	this->free.reserve(count);
+
+	while (this->free.size() < count)
+	{
+		this->free.push_back(this->create());
+	}
+}
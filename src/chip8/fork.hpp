@@ -0,0 +1,45 @@
+#pragma once
+
+#include "chip8.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/*
+*	recycled machines for searches that fork one state many times over, e.g.
+*	trying each of the 16 keys for a few frames and keeping the best branch.
+*
+*	every machine in a pool runs the same rom, so a fork only copies the
+*	memory pages the parent or the recycled child ever wrote, see
+*	c_chip8::fork_from. a machine handed back with recycle keeps its memory
+*	and decodes, which is what makes the next fork into it cheap.
+*
+*	a pool is not thread safe, give each search thread its own.
+*/
+class c_fork_pool
+{
+public:
+	c_fork_pool(const std::uint8_t* rom, std::size_t length, MACHINE machine = MACHINE_CHIP8);
+
+	/* a machine at power on, the root of a search */
+	std::unique_ptr<c_chip8> create();
+
+	/* a copy of parent, which has to run this pool's rom */
+	std::unique_ptr<c_chip8> fork(const c_chip8& parent);
+
+	/* hands a machine back for a later fork to reuse */
+	void recycle(std::unique_ptr<c_chip8> chip8);
+
+	/* builds machines up front so the first forks don't allocate */
+	void reserve(std::size_t count);
+
+	std::size_t get_free() const
+	{
+		return this->free.size();
+	}
+private:
+	std::vector<std::uint8_t> rom;
+	MACHINE machine;
+	std::vector<std::unique_ptr<c_chip8>> free;
+};
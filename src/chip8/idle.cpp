@@ -0,0 +1,52 @@
+#include "idle.hpp"
+#include "chip8.hpp"
+#include <cstring>
+
+void c_idle_loop::take(const c_chip8& chip8, std::uint16_t address, std::uint64_t executed)
+{
+	this->jump = address;
+	this->executed = executed;
+	this->registers = chip8.registers;
+	this->rng = chip8.rng.get_state();
+	this->stores = chip8.get_stores();
+	this->changes = chip8.framebuffer.changes;
+	this->plane_mask = chip8.framebuffer.plane_mask;
+	std::memcpy(this->flags, chip8.flags, sizeof(this->flags));
+	std::memcpy(this->audio_pattern, chip8.audio_pattern, sizeof(this->audio_pattern));
+	this->audio_pitch = chip8.audio_pitch;
+}
+
+bool c_idle_loop::same(const c_chip8& chip8) const
+{
+	return std::memcmp(&this->registers, &chip8.registers, sizeof(this->registers)) == 0
+		&& this->rng == chip8.rng.get_state()
+		&& this->stores == chip8.get_stores()
+		&& this->changes == chip8.framebuffer.changes
+		&& this->plane_mask == chip8.framebuffer.plane_mask
+		&& std::memcmp(this->flags, chip8.flags, sizeof(this->flags)) == 0
+		&& std::memcmp(this->audio_pattern, chip8.audio_pattern, sizeof(this->audio_pattern)) == 0
+		&& this->audio_pitch == chip8.audio_pitch;
+}
+
+std::uint64_t c_idle_loop::check(c_chip8& chip8, std::uint16_t address, std::uint64_t executed, std::uint64_t budget)
+{
+	if (this->jump != address || !this->same(chip8))
+	{
+		this->take(chip8, address, executed);
+		return 0;
+	}
+
+	std::uint64_t pass = executed - this->executed;
+
+	chip8.idle = true;
+
+	if (pass == 0 || budget <= executed)
+		return 0;
+
+	std::uint64_t skipped = (budget - executed) / pass * pass;
+
+	/* the copy stays valid, the machine is where it was after those passes too */
+	this->executed += skipped;
+	chip8.idle_skipped += skipped;
+	return skipped;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include "registers.hpp"
+
+class c_chip8;
+
+/* only loops at most this many bytes long are looked at, the waits games idle in are a handful of instructions */
+constexpr std::uint16_t IDLE_LOOP_BYTES = 32;
+
+/*
+*	spots a loop that is only waiting, like FX07; 3X00; 1NNN on the delay
+*	timer, EXA1; 1NNN on a key or a 1NNN to itself.
+*
+*	an engine calls check every time it jumps back over a short distance. the
+*	first time it keeps a copy of the machine, the next time at the same jump
+*	it compares: if nothing at all changed, one pass of the loop leaves the
+*	machine exactly as it found it, so every further pass does too until a
+*	timer tick or a key press, which only ever happen between runs. the rest of
+*	the budget can then be retired in whole passes without running them.
+*/
+class c_idle_loop
+{
+public:
+	/* forgets the copy, instruction counts from another run can't be compared */
+	void reset()
+	{
+		this->jump = NO_JUMP;
+	}
+
+	/*
+	*	at the backward jump at address, with executed of budget instructions
+	*	retired so far. returns how many more count as retired right away,
+	*	always a whole number of passes, and marks the machine idle.
+	*/
+	std::uint64_t check(c_chip8& chip8, std::uint16_t address, std::uint64_t executed, std::uint64_t budget);
+private:
+	static constexpr std::uint32_t NO_JUMP = 0xFFFFFFFF;
+
+	void take(const c_chip8& chip8, std::uint16_t address, std::uint64_t executed);
+	bool same(const c_chip8& chip8) const;
+
+	std::uint32_t jump = NO_JUMP;
+	std::uint64_t executed{};
+
+	/* everything an instruction can change, memory and pixels by their change counts */
+	c_register registers{};
+	std::uint64_t rng{};
+	std::uint32_t stores{};
+	std::uint32_t changes{};
+	std::uint8_t plane_mask{};
+	std::uint8_t flags[16]{};
+	std::uint8_t audio_pattern[16]{};
+	std::uint8_t audio_pitch{};
+};
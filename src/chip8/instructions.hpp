@@ -1,446 +1,519 @@
 #pragma once
 
 #include "chip8.hpp"
-#include <random>
-#include "../ppu/ppu.hpp"
-
-enum HIOPCODE
-{
-	JP = 0x1000,
-	CALL = 0x2000,
-	SEVXBYTE = 0x3000,
-	SNEVXBYTE = 0x4000,
-	SEVXVY = 0x5000,
-	LDVXBYTE = 0x6000,
-	ADDVXBYTE = 0x7000,
-	LD = 0x8000,
-	SNEVXVY = 0x9000,
-	LDIADDR = 0xA000,
-	JPV0ADDR = 0xB000,
-	RND = 0xC000,
-	DRW = 0xD000,
-	SKP = 0xE000,
-	LDSPECIAL = 0xF000,
-
-};
-
-enum LOWOPCODE
-{
-	// 0x00NN instructions below
-	CLS = 0xE0,
-	RET = 0xEE,
-
-	VXVY = 0x0,
-	ORVXVY = 0x1,
-	ANDVXVY = 0x2,
-	XORVXVY = 0x3,
-	ADDVXVY = 0x4,
-	SUBVXVY = 0x5,
-	SHRVX1 = 0x6,
-	SUBNVXVY = 0x7,
-	SHLVX1 = 0xE,
-
-	SKPVX = 0x9E,
-	SKNPVX = 0xA1,
-
-	LDVXDT = 0x07,
-	LDVXK = 0x0A,
-	LDDTVX = 0x15,
-	LDSTVX = 0x18,
-	ADDIVX = 0x1E,
-	LDFVX = 0x29,
-	LDBVX = 0x33,
-	LDIARRAYFROMV0VX = 0x55,
-	LDV0VXFROMIARRAY = 0x65
-};
+#include "opcodes.hpp"
 
 namespace instructions
 {
-	
-	void cls()
+	/* xo-chip steps over F000 NNNN as a whole, it is the one instruction that is four bytes long */
+	inline void skip(c_chip8& chip8)
+	{
+		std::uint16_t& pc = chip8.registers.pc;
+
+		if (chip8.get_machine() == MACHINE_XOCHIP && chip8.data[pc & MEMORY_MASK] == 0xF0 && chip8.data[(pc + 1) & MEMORY_MASK] == 0x00)
+			pc += 4;
+		else
+			pc += 2;
+	}
+
+	inline void cls(c_chip8& chip8)
 	{
-		SDL_SetRenderDrawColor(ppu_ptr->get_renderer(), 0, 0, 0, 0);
-		SDL_RenderClear(ppu_ptr->get_renderer());
+		chip8.framebuffer.clear();
 	}
 	
-	void ret()
+	/*
+	*	RET INSTRUCTION IMPLEMENTATION FOR CHIP8, false on an empty stack
+	*/
+	inline bool ret(c_chip8& chip8)
 	{
-		register_ptr->register_array[REGISTERS::PC].value_union.value16 = register_ptr->stack.top();
-		register_ptr->stack.pop();
+		return chip8.registers.pop(chip8.registers.pc);
 	}
 
 	/*
-	*	CALL INSTRUCTION IMPLEMENTATION FOR CHIP8
+	*	CALL INSTRUCTION IMPLEMENTATION FOR CHIP8, false on a full stack
 	*/
-	void call(std::uint16_t value)
+	inline bool call(c_chip8& chip8, std::uint16_t value)
 	{
-		register_ptr->stack.push(register_ptr->register_array[REGISTERS::PC].value_union.value16);
-		register_ptr->register_array[REGISTERS::PC].value_union.value16 = value - 0x200; // it's based at 0x200 and the roms are based at 0x00 so we need to fix the image
-		// base by subtracting off 0x200
+		if (!chip8.registers.push(chip8.registers.pc))
+			return false;
+
+		chip8.registers.pc = value;
+		return true;
 	}
 
 	/*
 	*	JP INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void jmp(std::uint16_t value)
+	inline void jmp(c_chip8& chip8, std::uint16_t value)
 	{
-		register_ptr->register_array[REGISTERS::PC].value_union.value16 = value - 0x200; // it's based at 0x200 and the roms are based at 0x00 so we need to fix the image
-		// base by subtracting off 0x200
+		chip8.registers.pc = value;
 	}
 
 	/*
 	*	SE INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void se(register_t& vx, std::uint8_t value)
+	inline void se(c_chip8& chip8, std::uint8_t& vx, std::uint8_t value)
 	{
-		if (vx.value_union.value == value)
+		if (vx == value)
 		{
-			register_ptr->register_array[REGISTERS::PC].value_union.value16 += 4;
+			skip(chip8);
 		}
 	}
 
 	/*
 	*	SNE INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void sne(const register_t& vx, std::uint8_t value)
+	inline void sne(c_chip8& chip8, std::uint8_t vx, std::uint8_t value)
 	{
-		if (vx.value_union.value != value)
+		if (vx != value)
 		{
-			register_ptr->register_array[REGISTERS::PC].value_union.value16 += 4;
+			skip(chip8);
 		}
 	}
 
 	/*
 	*	SE VX VY INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void se_registers(const register_t& vx, const register_t& vy)
+	inline void se_registers(c_chip8& chip8, std::uint8_t vx, std::uint8_t vy)
 	{
-		if (vx.value_union.value == vy.value_union.value)
+		if (vx == vy)
 		{
-			register_ptr->register_array[REGISTERS::PC].value_union.value16 += 4;
+			skip(chip8);
 		}
 	}
 
 	/*
 	*	LD INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void ld_byte(register_t& vx, std::uint8_t value)
+	inline void ld_byte(std::uint8_t& vx, std::uint8_t value)
 	{
-		vx.value_union.value = value;
+		vx = value;
 	}
 
 	/*
 	*	ADD INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void add_byte(register_t& vx, std::uint8_t value)
+	inline void add_byte(std::uint8_t& vx, std::uint8_t value)
 	{
-		vx.value_union.value += value;
+		vx += value;
 	}
 
 	/*
 	*	LD VX VY INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void ld_registers(register_t& vx, const register_t& vy)
+	inline void ld_registers(std::uint8_t& vx, std::uint8_t vy)
 	{
-		vx.value_union.value = vy.value_union.value;
+		vx = vy;
 	}
 
 	/*
 	*	OR VX VY INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void or_registers(register_t& vx, const register_t& vy)
+	inline void or_registers(std::uint8_t& vx, std::uint8_t vy)
 	{
-		vx.value_union.value |= vy.value_union.value;
+		vx |= vy;
 	}
 
 	/*
 	*	AND VX VY INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void and_registers(register_t& vx, const register_t& vy)
+	inline void and_registers(std::uint8_t& vx, std::uint8_t vy)
 	{
-		vx.value_union.value &= vy.value_union.value;
+		vx &= vy;
 	}
 
 	/*
 	*	XOR VX VY INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void xor_registers(register_t& vx, const register_t& vy)
+	inline void xor_registers(std::uint8_t& vx, std::uint8_t vy)
 	{
-		vx.value_union.value ^= vy.value_union.value;
+		vx ^= vy;
 	}
 
 	/*
 	*	ADD VX VY INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void add_registers(register_t& vx, const register_t& vy)
+	inline void add_registers(c_chip8& chip8, std::uint8_t& vx, std::uint8_t vy)
 	{
-		std::uint16_t value = static_cast<std::uint16_t>(vx.value_union.value) + static_cast<std::uint16_t>(vy.value_union.value);
+		std::uint16_t value = static_cast<std::uint16_t>(vx) + static_cast<std::uint16_t>(vy);
 
 		if (value > 0xFF)
 		{
-			register_ptr->set_value<REGISTERS::VF, std::uint8_t>(1);
-			vx.value_union.value = static_cast<std::uint8_t>(value);
+			chip8.registers.get<REGISTERS::VF>() = 1;
+			vx = static_cast<std::uint8_t>(value);
 		
 			return;
 		}
 
-		vx.value_union.value = static_cast<std::uint8_t>(value);
+		vx = static_cast<std::uint8_t>(value);
 	}
 
 	/*
 	*	SUB VX VY INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void sub_registers(register_t& vx, const register_t& vy)
+	inline void sub_registers(c_chip8& chip8, std::uint8_t& vx, std::uint8_t vy)
 	{
-		std::uint8_t value = vx.value_union.value - vy.value_union.value;
+		std::uint8_t value = vx - vy;
 
-		if (vx.value_union.value > vy.value_union.value)
+		if (vx > vy)
 		{
-			register_ptr->set_value<REGISTERS::VF, std::uint8_t>(1);
-			vx.value_union.value = value;
+			chip8.registers.get<REGISTERS::VF>() = 1;
+			vx = value;
 
 			return;
 		}
 
-		register_ptr->set_value<REGISTERS::VF, std::uint8_t>(0);
-		vx.value_union.value = value;
+		chip8.registers.get<REGISTERS::VF>() = 0;
+		vx = value;
 	}
 
 	/*
 	*	SHR VX INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void shr(register_t& vx)
+	inline void shr(c_chip8& chip8, std::uint8_t& vx)
 	{
 		/* check if least significant bit is 1*/
-		if (vx.value_union.value & 0x01)
+		if (vx & 0x01)
 		{
-			register_ptr->set_value<REGISTERS::VF, std::uint8_t>(1);
-			vx.value_union.value >>= 1;
+			chip8.registers.get<REGISTERS::VF>() = 1;
+			vx >>= 1;
 			return;
 		}
 
-		register_ptr->set_value<REGISTERS::VF, std::uint8_t>(0);
-		vx.value_union.value >>= 1;
+		chip8.registers.get<REGISTERS::VF>() = 0;
+		vx >>= 1;
 	}
 
 	/*
 	*	SUBN VX VY INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void subn_registers(register_t& vx, const register_t& vy)
+	inline void subn_registers(c_chip8& chip8, std::uint8_t& vx, std::uint8_t vy)
 	{
 
-		std::uint8_t value = vy.value_union.value - vx.value_union.value;
+		std::uint8_t value = vy - vx;
 
-		if (vy.value_union.value > vx.value_union.value)
+		if (vy > vx)
 		{
-			register_ptr->set_value<REGISTERS::VF, std::uint8_t>(1);
-			vx.value_union.value = value;
+			chip8.registers.get<REGISTERS::VF>() = 1;
+			vx = value;
 
 			return;
 		}
 
-		register_ptr->set_value<REGISTERS::VF, std::uint8_t>(0);
-		vx.value_union.value = value;
+		chip8.registers.get<REGISTERS::VF>() = 0;
+		vx = value;
 	}
 
 	/*
 	*	SHL VX INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void shl(register_t& vx)
+	inline void shl(c_chip8& chip8, std::uint8_t& vx)
 	{
 		/* check if most significant bit is 1 */
-		if (vx.value_union.value & 0x80)
+		if (vx & 0x80)
 		{
-			register_ptr->set_value<REGISTERS::VF, std::uint8_t>(1);
-			vx.value_union.value <<= 1;
+			chip8.registers.get<REGISTERS::VF>() = 1;
+			vx <<= 1;
 		
 			return;
 		}
 
-		register_ptr->set_value<REGISTERS::VF, std::uint8_t>(0);
-		vx.value_union.value <<= 1;
+		chip8.registers.get<REGISTERS::VF>() = 0;
+		vx <<= 1;
 	}
 
 	/*
 	*	SNE VX VY INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void sne_register(const register_t& vx, const register_t& vy)
+	inline void sne_register(c_chip8& chip8, std::uint8_t vx, std::uint8_t vy)
 	{
-		if (vx.value_union.value != vy.value_union.value)
+		if (vx != vy)
 		{
-			register_ptr->register_array[REGISTERS::PC].value_union.value16 += 2;
+			skip(chip8);
 		}
 	}
 
 	/*
 	*	LD I, ADDR INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void ld_iaddr(std::uint16_t addr)
+	inline void ld_iaddr(c_chip8& chip8, std::uint16_t addr)
 	{
-		register_ptr->register_array[REGISTERS::VI].value_union.value16 = addr;
+		chip8.registers.i = addr;
 	}
 
 	/*
 	*	JP V0, ADDR INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void jmp_registerv0addr(std::uint16_t addr)
+	inline void jmp_registerv0addr(c_chip8& chip8, std::uint16_t addr)
 	{ 
-		/* subtract 0x200 to rebase the image */
-		register_ptr->register_array[REGISTERS::PC].value_union.value16 = (addr + static_cast<std::uint16_t>(register_ptr->register_array[REGISTERS::V0].value_union.value));
+		/* the sum can run past the top of memory, addresses wrap like every other access */
+		chip8.registers.pc = (addr + static_cast<std::uint16_t>(chip8.registers.v[0])) & MEMORY_MASK;
 	}
 
 	/*
 	*	RND VX, BYTE INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void rnd_registerbyte(register_t& vx, std::uint8_t byte)
+	inline void rnd_registerbyte(c_chip8& chip8, std::uint8_t& vx, std::uint8_t byte)
 	{
-		static std::random_device rd;
-		static std::mt19937 rng{ rd() };
-		static std::uniform_int_distribution<std::uint32_t> uid(0, 0xFF);
-
-		std::uint8_t value = uid(rng);
+		/* the generator lives on the instance so machines on separate threads never share it */
+		std::uint8_t value = chip8.rng.next_byte();
 
-		vx.value_union.value = value & byte;
+		vx = value & byte;
 	}
 
-	/* DRAW FUNCTION TO IMPLEMENT SOON */
-	void draw(const register_t& vx, const register_t& vy, std::uint8_t n, std::uint8_t* data, std::uint8_t* pixels)
+	/*
+	*	DRW VX, VY, N INSTRUCTION IMPLEMENTATION FOR CHIP8
+	*/
+	inline void draw(c_chip8& chip8, std::uint8_t vx, std::uint8_t vy, std::uint8_t n, std::uint8_t* data)
 	{
-		for (int i = 0; i < n; i++)
+		/* DXY0 is a 16x16 sprite of two bytes per row from super-chip on, plain chip-8 draws nothing */
+		bool large = n == 0 && chip8.get_machine() != MACHINE_CHIP8;
+		std::uint8_t rows = large ? 16 : n;
+		std::uint16_t address = chip8.registers.i;
+		bool collision = false;
+
+		/* with both planes selected the second plane's rows follow the first's */
+		for (int plane = 0; plane < FRAMEBUFFER_PLANES; plane++)
 		{
-			for (std::int8_t b = 7; b >= 0; b--)
-			{
-				for (int x = 0; x < n; x++)
-				{
-					std::uint8_t current_byte = data[register_ptr->register_array[REGISTERS::VI].value_union.value16 + x];
+			if (!(chip8.framebuffer.plane_mask & (1 << plane)))
+				continue;
 
-					std::uint8_t pixel = (current_byte >> b) & 1;
+			std::uint16_t sprite[16]{};
 
-					if (pixel != 0)
-					{
-						SDL_SetRenderDrawColor(ppu_ptr->get_renderer(), 255, 255, 255, 255);
-						SDL_RenderDrawPoint(ppu_ptr->get_renderer(), vx.value_union.value + b, vy.value_union.value + x);
-					}
+			for (std::uint32_t i = 0; i < rows; i++)
+			{
+				if (large)
+				{
+					sprite[i] = static_cast<std::uint16_t>(data[address & MEMORY_MASK] << 8) | data[(address + 1) & MEMORY_MASK];
+					address += 2;
+				}
+				else
+				{
+					sprite[i] = data[address & MEMORY_MASK];
+					address += 1;
 				}
 			}
+
+			collision |= chip8.framebuffer.draw(plane, vx, vy, sprite, rows, large ? 16 : 8);
 		}
+
+		chip8.registers.get<REGISTERS::VF>() = collision ? 1 : 0;
 	}
 
-	/* SKIP IF PRESSED INSTRUCTION TO IMPLEMENT SOON*/
-	void skip_if_pressed(const register_t& vx, SDL_Event& evnt)
+	/*
+	*	SKP VX INSTRUCTION IMPLEMENTATION FOR CHIP8
+	*/
+	inline void skip_if_pressed(c_chip8& chip8, std::uint8_t vx)
 	{
-		if (evnt.key.keysym.sym == vx.value_union.value)
+		if (chip8.keypad & (1 << (vx & 0xF)))
 		{
-			register_ptr->register_array[REGISTERS::PC].value_union.value16 += 2;
+			skip(chip8);
 		}
 	}
 
-	/* SKIP IF NOT PRESSED TO IMPLEMENT SOON */
-	void skip_if_not_pressed(const register_t& vx, SDL_Event& evnt)
+	/*
+	*	SKNP VX INSTRUCTION IMPLEMENTATION FOR CHIP8
+	*/
+	inline void skip_if_not_pressed(c_chip8& chip8, std::uint8_t vx)
 	{
-		if (evnt.key.keysym.sym != vx.value_union.value)
+		if (!(chip8.keypad & (1 << (vx & 0xF))))
 		{
-		//	register_ptr->register_array[REGISTERS::PC].value_union.value16 += 2;
+			skip(chip8);
 		}
 	}
 
 	/*
 	*	LD VX, DT INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void ld_registerdt(register_t& vx)
+	inline void ld_registerdt(c_chip8& chip8, std::uint8_t& vx)
 	{
-		vx.value_union.value = register_ptr->register_array[REGISTERS::V_DELAY].value_union.value;
+		vx = chip8.registers.delay;
 	}
 
-	/* LOAD KEY NUMBER INTO VX INSTRUCTION TO IMPLEMENT SOON */
-	void ld_key_into_register(register_t& val, SDL_Event& evnt)
+	/*
+	*	LD VX, K INSTRUCTION IMPLEMENTATION FOR CHIP8
+	*/
+	inline void ld_key_into_register(c_chip8& chip8, std::uint8_t x)
 	{
-		while (SDL_PollEvent(&evnt))
-		{
-			if (evnt.type == SDL_KEYDOWN)
-			{
-				val.value_union.value = evnt.key.keysym.sym;
-				break;
-			}
-		}
+		/* the cpu stops here, c_chip8::set_keypad fills VX and releases it on the next key press */
+		chip8.registers.key_wait = true;
+		chip8.registers.key_register = x;
 	}
 	
 	/*
 	*	LD DT, VX INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void ld_registerintodt(const register_t& vx)
+	inline void ld_registerintodt(c_chip8& chip8, std::uint8_t vx)
 	{
-		register_ptr->register_array[REGISTERS::V_DELAY].value_union.value = vx.value_union.value;
+		chip8.registers.delay = vx;
 	}
 	
 	/*
 	*	LD ST, VX INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void ld_registerintost(const register_t& vx)
+	inline void ld_registerintost(c_chip8& chip8, std::uint8_t vx)
 	{
-		register_ptr->register_array[REGISTERS::V_SOUND].value_union.value = vx.value_union.value;
+		chip8.registers.sound = vx;
 	}
 
 	/*
 	*	ADD I, VX INSTRUCTION IMPLEMENTATION FOR CHIP8
 	*/
-	void add_ifromregister(register_t& i, const register_t& vy)
+	inline void add_ifromregister(std::uint16_t& i, std::uint8_t vy)
 	{
-		i.value_union.value16 += vy.value_union.value;
+		i += vy;
 	}
 
 	/* LD F, VX IMPLEMENTATION SOON */	
 
-	void ld_fvx(const register_t& reg, std::uint16_t fontset_epilogue_data_block_start)
+	inline void ld_fvx(c_chip8& chip8, std::uint8_t reg)
 	{
-		register_ptr->register_array[REGISTERS::VI].value_union.value16 = fontset_epilogue_data_block_start + reg.value_union.value * 5;
+		chip8.registers.i = FONTSET_START + (reg & 0xF) * 5;
 	}
 
 	/* LD B, VX IMPLEMENTATION SOON */
-	void ld_bvx(register_t& arg, std::uint8_t* data)
+	inline void ld_bvx(c_chip8& chip8, std::uint8_t& arg, std::uint8_t* data)
 	{
-		std::uint8_t digits = arg.value_union.value;
+		std::uint8_t digits = arg;
+		std::uint16_t address = chip8.registers.i;
 
-		data[register_ptr->register_array[REGISTERS::VI].value_union.value16 + 2] = digits % 10;
+		data[(address + 2) & MEMORY_MASK] = digits % 10;
 		digits /= 10;
 
-		data[register_ptr->register_array[REGISTERS::VI].value_union.value16 + 1] = digits % 10;
+		data[(address + 1) & MEMORY_MASK] = digits % 10;
 		digits /= 10;
 
-		data[register_ptr->register_array[REGISTERS::VI].value_union.value16] = digits % 10;
+		data[address & MEMORY_MASK] = digits % 10;
+
+		chip8.memory_written(address & MEMORY_MASK, 3);
 	}
 
 	/* LD [I], VX IMPLEMENTATION */
-	void ld_iarrayfromregister(const std::uint8_t& n, std::uint8_t* data)
+	inline void ld_iarrayfromregister(c_chip8& chip8, const std::uint8_t& n, std::uint8_t* data)
 	{
-		std::uint16_t original = register_ptr->get_value<REGISTERS::VI, std::uint16_t>();
+		std::uint16_t address = chip8.registers.i;
 
 		for (int i = 0; i <= n; i++)
 		{
-			REGISTERS reg = static_cast<REGISTERS>(i);
-			data[register_ptr->register_array[REGISTERS::VI].value_union.value16] = register_ptr->register_array[reg].value_union.value; // it's based at 0x200 and the roms are based at 0x00 so we need to fix the image
-			// base by subtracting off 0x200
-			register_ptr->register_array[REGISTERS::VI].value_union.value16 += 1;
+			data[(address + i) & MEMORY_MASK] = chip8.registers.v[i];
 		}
 
-		register_ptr->set_value<REGISTERS::VI, std::uint16_t>(original);
+		chip8.memory_written(address & MEMORY_MASK, n + 1);
 	}
 
 	/*
 	*	LD VX, [I] IMPLEMENTATION
 	*/
 
-	void ld_registerarrayi(const std::uint8_t& n, std::uint8_t* data)
+	inline void ld_registerarrayi(c_chip8& chip8, const std::uint8_t& n, std::uint8_t* data)
 	{
-		std::uint16_t original = register_ptr->get_value<REGISTERS::VI, std::uint16_t>();
+		std::uint16_t address = chip8.registers.i;
 	
 		for (int i = 0; i <= n; i++)
 		{
-			REGISTERS reg = static_cast<REGISTERS>(i);
-			register_ptr->register_array[reg].value_union.value = data[register_ptr->register_array[REGISTERS::VI].value_union.value16];
-			register_ptr->register_array[REGISTERS::VI].value_union.value16 += 1;
+			chip8.registers.v[i] = data[(address + i) & MEMORY_MASK];
 		}
+	}
+
+	/*
+	*	LD HF, VX INSTRUCTION IMPLEMENTATION FOR SCHIP
+	*/
+	inline void ld_hfvx(c_chip8& chip8, std::uint8_t reg)
+	{
+		chip8.registers.i = BIG_FONTSET_START + (reg & 0xF) * 10;
+	}
+
+	/*
+	*	LD R, VX INSTRUCTION IMPLEMENTATION FOR SCHIP
+	*/
+	inline void save_flags(c_chip8& chip8, std::uint8_t x)
+	{
+		for (int i = 0; i <= x; i++)
+		{
+			chip8.flags[i] = chip8.registers.v[i];
+		}
+	}
 
-		register_ptr->set_value<REGISTERS::VI, std::uint16_t>(original);
+	/*
+	*	LD VX, R INSTRUCTION IMPLEMENTATION FOR SCHIP
+	*/
+	inline void load_flags(c_chip8& chip8, std::uint8_t x)
+	{
+		for (int i = 0; i <= x; i++)
+		{
+			chip8.registers.v[i] = chip8.flags[i];
+		}
+	}
+
+	/*
+	*	SAVE VX - VY INSTRUCTION IMPLEMENTATION FOR XOCHIP, the range runs backwards when x > y
+	*/
+	inline void save_range(c_chip8& chip8, std::uint8_t x, std::uint8_t y, std::uint8_t* data)
+	{
+		std::uint16_t address = chip8.registers.i;
+		int step = x <= y ? 1 : -1;
+		int count = (x <= y ? y - x : x - y) + 1;
+
+		for (int i = 0; i < count; i++)
+		{
+			data[(address + i) & MEMORY_MASK] = chip8.registers.v[x + i * step];
+		}
+
+		chip8.memory_written(address & MEMORY_MASK, count);
+	}
+
+	/*
+	*	LOAD VX - VY INSTRUCTION IMPLEMENTATION FOR XOCHIP
+	*/
+	inline void load_range(c_chip8& chip8, std::uint8_t x, std::uint8_t y, std::uint8_t* data)
+	{
+		std::uint16_t address = chip8.registers.i;
+		int step = x <= y ? 1 : -1;
+		int count = (x <= y ? y - x : x - y) + 1;
+
+		for (int i = 0; i < count; i++)
+		{
+			chip8.registers.v[x + i * step] = data[(address + i) & MEMORY_MASK];
+		}
+	}
+
+	/*
+	*	LD I, LONG INSTRUCTION IMPLEMENTATION FOR XOCHIP, the address is the word after the opcode
+	*/
+	inline void ld_ilong(c_chip8& chip8, std::uint8_t* data)
+	{
+		std::uint16_t& pc = chip8.registers.pc;
+
+		chip8.registers.i = static_cast<std::uint16_t>(data[pc & MEMORY_MASK] << 8) | data[(pc + 1) & MEMORY_MASK];
+		pc += 2;
+	}
+
+	/*
+	*	PLANE N INSTRUCTION IMPLEMENTATION FOR XOCHIP
+	*/
+	inline void select_planes(c_chip8& chip8, std::uint8_t n)
+	{
+		chip8.framebuffer.plane_mask = n & ((1 << FRAMEBUFFER_PLANES) - 1);
+	}
+
+	/*
+	*	AUDIO INSTRUCTION IMPLEMENTATION FOR XOCHIP
+	*/
+	inline void ld_audio(c_chip8& chip8, std::uint8_t* data)
+	{
+		std::uint16_t address = chip8.registers.i;
+
+		for (int i = 0; i < 16; i++)
+		{
+			chip8.audio_pattern[i] = data[(address + i) & MEMORY_MASK];
+		}
+	}
+
+	/*
+	*	PITCH VX INSTRUCTION IMPLEMENTATION FOR XOCHIP
+	*/
+	inline void ld_pitch(c_chip8& chip8, std::uint8_t vx)
+	{
+		chip8.audio_pitch = vx;
 	}
-}
\ No newline at end of file
+}
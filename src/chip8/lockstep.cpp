@@ -0,0 +1,889 @@
+#include "lockstep.hpp"
+#include "instructions.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LOCKSTEP_SSE2 1
+#endif
+
+namespace
+{
+	/* a bucket is only worth a masked pass over its span when at least one lane in this many belongs to it */
+	constexpr std::size_t SPARSE_LIMIT = 8;
+
+	/* lane arrays are padded to this, the widest vector the kernels use */
+	constexpr std::size_t LANE_PADDING = 32;
+
+	enum LANE_OP
+	{
+		LANE_LD,
+		LANE_ADD,
+		LANE_OR,
+		LANE_AND,
+		LANE_XOR,
+		/* ADD VX, VY, which only ever sets VF, a sum without a carry leaves it alone like instructions::add_registers */
+		LANE_ADD_CARRY,
+		LANE_SUB,
+		LANE_SUBN,
+		LANE_SHR,
+		LANE_SHL
+	};
+
+	/* one lane at a time, the tail of every kernel and the whole of it for a lane on its own */
+	struct scalar_t
+	{
+		using reg = std::uint8_t;
+		static constexpr std::size_t WIDTH = 1;
+
+		static reg load(const std::uint8_t* p) { return *p; }
+		static void store(std::uint8_t* p, reg a) { *p = a; }
+		static reg splat(std::uint8_t value) { return value; }
+		static reg add(reg a, reg b) { return static_cast<reg>(a + b); }
+		static reg sub(reg a, reg b) { return static_cast<reg>(a - b); }
+		static reg bit_or(reg a, reg b) { return a | b; }
+		static reg bit_and(reg a, reg b) { return a & b; }
+		static reg bit_xor(reg a, reg b) { return a ^ b; }
+		static reg and_not(reg a, reg b) { return static_cast<reg>(~a & b); }
+		static reg max(reg a, reg b) { return std::max(a, b); }
+		static reg equal(reg a, reg b) { return a == b ? 0xFF : 0x00; }
+		static reg shift_right_1(reg a) { return a >> 1; }
+		static reg shift_right_7(reg a) { return a >> 7; }
+	};
+
+#if defined(__AVX2__)
+	struct vector_t
+	{
+		using reg = __m256i;
+		static constexpr std::size_t WIDTH = 32;
+
+		static reg load(const std::uint8_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+		static void store(std::uint8_t* p, reg a) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a); }
+		static reg splat(std::uint8_t value) { return _mm256_set1_epi8(static_cast<char>(value)); }
+		static reg add(reg a, reg b) { return _mm256_add_epi8(a, b); }
+		static reg sub(reg a, reg b) { return _mm256_sub_epi8(a, b); }
+		static reg bit_or(reg a, reg b) { return _mm256_or_si256(a, b); }
+		static reg bit_and(reg a, reg b) { return _mm256_and_si256(a, b); }
+		static reg bit_xor(reg a, reg b) { return _mm256_xor_si256(a, b); }
+		static reg and_not(reg a, reg b) { return _mm256_andnot_si256(a, b); }
+		static reg max(reg a, reg b) { return _mm256_max_epu8(a, b); }
+		static reg equal(reg a, reg b) { return _mm256_cmpeq_epi8(a, b); }
+
+		/* there are no byte shifts, shift words and drop what crossed over from the neighbouring byte */
+		static reg shift_right_1(reg a) { return _mm256_and_si256(_mm256_srli_epi16(a, 1), splat(0x7F)); }
+		static reg shift_right_7(reg a) { return _mm256_and_si256(_mm256_srli_epi16(a, 7), splat(0x01)); }
+	};
+#elif defined(LOCKSTEP_SSE2)
+	struct vector_t
+	{
+		using reg = __m128i;
+		static constexpr std::size_t WIDTH = 16;
+
+		static reg load(const std::uint8_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+		static void store(std::uint8_t* p, reg a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a); }
+		static reg splat(std::uint8_t value) { return _mm_set1_epi8(static_cast<char>(value)); }
+		static reg add(reg a, reg b) { return _mm_add_epi8(a, b); }
+		static reg sub(reg a, reg b) { return _mm_sub_epi8(a, b); }
+		static reg bit_or(reg a, reg b) { return _mm_or_si128(a, b); }
+		static reg bit_and(reg a, reg b) { return _mm_and_si128(a, b); }
+		static reg bit_xor(reg a, reg b) { return _mm_xor_si128(a, b); }
+		static reg and_not(reg a, reg b) { return _mm_andnot_si128(a, b); }
+		static reg max(reg a, reg b) { return _mm_max_epu8(a, b); }
+		static reg equal(reg a, reg b) { return _mm_cmpeq_epi8(a, b); }
+		static reg shift_right_1(reg a) { return _mm_and_si128(_mm_srli_epi16(a, 1), splat(0x7F)); }
+		static reg shift_right_7(reg a) { return _mm_and_si128(_mm_srli_epi16(a, 7), splat(0x01)); }
+	};
+#else
+	using vector_t = scalar_t;
+#endif
+
+	template<typename S>
+	typename S::reg blend(typename S::reg a, typename S::reg b, typename S::reg mask)
+	{
+		return S::bit_or(S::and_not(mask, a), S::bit_and(mask, b));
+	}
+
+	/* unsigned a > b as a lane mask */
+	template<typename S>
+	typename S::reg greater(typename S::reg a, typename S::reg b)
+	{
+		return S::bit_xor(S::equal(S::max(a, b), b), S::splat(0xFF));
+	}
+
+	/*
+	*	vx = vx op vy (or op byte when vy is null) on the masked lanes in [first, last),
+	*	VF set the way the scalar handler sets it. VF is stored before VX, so with
+	*	X = F the result wins over the flag as it does in instructions.hpp.
+	*	returns where it stopped, the caller finishes the tail with scalar_t.
+	*/
+	template<typename S>
+	std::size_t alu(LANE_OP op, std::uint8_t* vx, const std::uint8_t* vy, std::uint8_t byte, std::uint8_t* vf, const std::uint8_t* mask, std::size_t first, std::size_t last)
+	{
+		using reg = typename S::reg;
+
+		const reg ones = S::splat(0xFF);
+		const reg one = S::splat(0x01);
+		const reg immediate = S::splat(byte);
+		std::size_t lane = first;
+
+		for (; lane + S::WIDTH <= last; lane += S::WIDTH)
+		{
+			reg m = S::load(mask + lane);
+			reg x = S::load(vx + lane);
+			reg y = vy != nullptr ? S::load(vy + lane) : immediate;
+			reg result{};
+			reg flag{};
+			reg flag_mask = S::splat(0x00);
+
+			switch (op)
+			{
+				case LANE_LD: result = y; break;
+				case LANE_ADD: result = S::add(x, y); break;
+				case LANE_OR: result = S::bit_or(x, y); break;
+				case LANE_AND: result = S::bit_and(x, y); break;
+				case LANE_XOR: result = S::bit_xor(x, y); break;
+
+				case LANE_ADD_CARRY:
+					result = S::add(x, y);
+					flag = one;
+					flag_mask = greater<S>(x, result);
+					break;
+
+				case LANE_SUB:
+					result = S::sub(x, y);
+					flag = S::bit_and(greater<S>(x, y), one);
+					flag_mask = ones;
+					break;
+
+				case LANE_SUBN:
+					result = S::sub(y, x);
+					flag = S::bit_and(greater<S>(y, x), one);
+					flag_mask = ones;
+					break;
+
+				case LANE_SHR:
+					result = S::shift_right_1(x);
+					flag = S::bit_and(x, one);
+					flag_mask = ones;
+					break;
+
+				case LANE_SHL:
+					result = S::add(x, x);
+					flag = S::shift_right_7(x);
+					flag_mask = ones;
+					break;
+			}
+
+			if (op >= LANE_ADD_CARRY)
+				S::store(vf + lane, blend<S>(S::load(vf + lane), flag, S::bit_and(m, flag_mask)));
+
+			S::store(vx + lane, blend<S>(S::load(vx + lane), result, m));
+		}
+
+		return lane;
+	}
+
+	/* condition = 2 on the masked lanes where vx == vy (or != when not_equal), the extra PC step of a taken skip */
+	template<typename S>
+	std::size_t compare(const std::uint8_t* vx, const std::uint8_t* vy, std::uint8_t byte, bool not_equal, std::uint8_t* condition, const std::uint8_t* mask, std::size_t first, std::size_t last)
+	{
+		using reg = typename S::reg;
+
+		const reg invert = S::splat(not_equal ? 0xFF : 0x00);
+		const reg two = S::splat(0x02);
+		const reg immediate = S::splat(byte);
+		std::size_t lane = first;
+
+		for (; lane + S::WIDTH <= last; lane += S::WIDTH)
+		{
+			reg y = vy != nullptr ? S::load(vy + lane) : immediate;
+			reg taken = S::bit_xor(S::equal(S::load(vx + lane), y), invert);
+
+			S::store(condition + lane, S::bit_and(S::bit_and(taken, S::load(mask + lane)), two));
+		}
+
+		return lane;
+	}
+
+	void run_alu(LANE_OP op, std::uint8_t* vx, const std::uint8_t* vy, std::uint8_t byte, std::uint8_t* vf, const std::uint8_t* mask, std::size_t first, std::size_t last)
+	{
+		std::size_t lane = alu<vector_t>(op, vx, vy, byte, vf, mask, first, last);
+		alu<scalar_t>(op, vx, vy, byte, vf, mask, lane, last);
+	}
+
+	void run_compare(const std::uint8_t* vx, const std::uint8_t* vy, std::uint8_t byte, bool not_equal, std::uint8_t* condition, const std::uint8_t* mask, std::size_t first, std::size_t last)
+	{
+		std::size_t lane = compare<vector_t>(vx, vy, byte, not_equal, condition, mask, first, last);
+		compare<scalar_t>(vx, vy, byte, not_equal, condition, mask, lane, last);
+	}
+
+	/* the handlers that leave memory different from the rom image, and how much of it from I */
+	std::uint32_t write_length(const decoded_instruction_t& entry)
+	{
+		switch (entry.handler)
+		{
+			case OP_LDBVX:
+				return 3;
+
+			case OP_LDIARRAYFROMV0VX:
+				return entry.x + 1u;
+
+			case OP_SAVEVXVY:
+				return (entry.x <= entry.y ? entry.y - entry.x : entry.x - entry.y) + 1u;
+
+			default:
+				return 0;
+		}
+	}
+}
+
+c_lockstep::c_lockstep(const std::uint8_t* rom, std::size_t length, std::size_t lanes, MACHINE machine)
+	: machine(machine), stride((lanes + LANE_PADDING - 1) / LANE_PADDING * LANE_PADDING)
+{
+	this->machines.reserve(lanes);
+
+	for (std::size_t lane = 0; lane < lanes; lane++)
+	{
+		this->machines.push_back(std::make_unique<c_chip8>(rom, length));
+		this->machines.back()->set_machine(machine);
+	}
+
+	this->v.assign(16 * this->stride, 0);
+	this->i.assign(this->stride, 0);
+	this->pc.assign(this->stride, 0);
+	this->delay.assign(this->stride, 0);
+	this->sound.assign(this->stride, 0);
+	this->sp.assign(this->stride, 0);
+	this->stack.assign(STACK_DEPTH * this->stride, 0);
+	this->keypad.assign(this->stride, 0);
+	this->mask.assign(this->stride, 0);
+	this->running.assign(this->stride, 0);
+	this->condition.assign(this->stride, 0);
+	this->dirty_low.assign(this->stride, 0);
+	this->dirty_high.assign(this->stride, 0);
+
+	for (std::size_t lane = 0; lane < lanes; lane++)
+	{
+		this->store(lane);
+	}
+
+	this->image = std::make_unique<std::uint8_t[]>(MEMORY_SIZE);
+	this->decoded = std::make_unique<decoded_instruction_t[]>(MEMORY_SIZE);
+	this->stamp = std::make_unique<std::uint32_t[]>(MEMORY_SIZE);
+	this->slot = std::make_unique<std::uint32_t[]>(MEMORY_SIZE);
+
+	if (lanes != 0)
+		std::memcpy(this->image.get(), this->machines[0]->data, MEMORY_SIZE);
+}
+
+c_lockstep::~c_lockstep() = default;
+
+void c_lockstep::load(std::size_t lane)
+{
+	c_register& registers = this->machines[lane]->registers;
+
+	for (int x = 0; x < 16; x++)
+	{
+		registers.v[x] = this->v[x * this->stride + lane];
+	}
+
+	for (unsigned int n = 0; n < STACK_DEPTH; n++)
+	{
+		registers.stack[n] = this->stack[n * this->stride + lane];
+	}
+
+	registers.i = this->i[lane];
+	registers.pc = this->pc[lane];
+	registers.delay = this->delay[lane];
+	registers.sound = this->sound[lane];
+	registers.sp = this->sp[lane];
+}
+
+void c_lockstep::store(std::size_t lane)
+{
+	const c_register& registers = this->machines[lane]->registers;
+
+	for (int x = 0; x < 16; x++)
+	{
+		this->v[x * this->stride + lane] = registers.v[x];
+	}
+
+	for (unsigned int n = 0; n < STACK_DEPTH; n++)
+	{
+		this->stack[n * this->stride + lane] = registers.stack[n];
+	}
+
+	this->i[lane] = registers.i;
+	this->pc[lane] = registers.pc;
+	this->delay[lane] = registers.delay;
+	this->sound[lane] = registers.sound;
+	this->sp[lane] = registers.sp;
+	this->keypad[lane] = this->machines[lane]->keypad;
+}
+
+c_chip8& c_lockstep::get_lane(std::size_t lane)
+{
+	this->load(lane);
+	return *this->machines[lane];
+}
+
+void c_lockstep::put_lane(std::size_t lane)
+{
+	this->store(lane);
+
+	/* whatever changed the machine may have rewritten its memory, find out how much of it still matches the image */
+	const std::uint8_t* data = this->machines[lane]->data;
+	std::uint32_t low = 0;
+	std::uint32_t high = MEMORY_SIZE;
+
+	while (low < high && data[low] == this->image[low])
+	{
+		low++;
+	}
+
+	while (high > low && data[high - 1] == this->image[high - 1])
+	{
+		high--;
+	}
+
+	this->dirty_low[lane] = low;
+	this->dirty_high[lane] = high;
+
+	/* a restored state may have halted or released the lane */
+	this->stale = true;
+}
+
+void c_lockstep::set_keypad(std::size_t lane, std::uint16_t keys)
+{
+	/* a released FX0A writes the key into VX */
+	c_chip8& chip8 = this->get_lane(lane);
+	bool waiting = chip8.registers.key_wait;
+
+	chip8.set_keypad(keys);
+	this->store(lane);
+
+	if (waiting && !chip8.registers.key_wait)
+		this->stale = true;
+}
+
+void c_lockstep::tick_timers()
+{
+	std::size_t lanes = this->machines.size();
+
+	for (std::size_t lane = 0; lane < lanes; lane++)
+	{
+		this->delay[lane] -= this->delay[lane] > 0;
+		this->sound[lane] -= this->sound[lane] > 0;
+	}
+}
+
+void c_lockstep::find_runnable()
+{
+	this->runnable.clear();
+
+	for (std::size_t lane = 0; lane < this->machines.size(); lane++)
+	{
+		const c_chip8& chip8 = *this->machines[lane];
+
+		bool running = !chip8.halted && !chip8.registers.key_wait;
+
+		if (running)
+			this->runnable.push_back(static_cast<std::uint32_t>(lane));
+
+		this->running[lane] = running ? 0xFF : 0x00;
+	}
+
+	this->stale = false;
+}
+
+std::uint64_t c_lockstep::run(std::uint64_t budget)
+{
+	std::uint64_t executed = 0;
+
+	for (std::uint64_t n = 0; n < budget; n++)
+	{
+		if (this->stale)
+			this->find_runnable();
+
+		if (this->runnable.empty())
+			break;
+
+		executed += this->step();
+	}
+
+	return executed;
+}
+
+std::uint64_t c_lockstep::step()
+{
+	std::uint64_t executed = 0;
+
+	this->groups.clear();
+	this->solo.clear();
+
+	/* copies of one rom fed the same input never diverge, which makes a single bucket of every lane the common case */
+	std::uint32_t leader = this->pc[this->runnable[0]];
+	bool uniform = leader <= MEMORY_SIZE - 2;
+
+	for (std::uint32_t lane : this->runnable)
+	{
+		uniform &= this->pc[lane] == leader && (leader + 2 <= this->dirty_low[lane] || leader >= this->dirty_high[lane]);
+	}
+
+	if (uniform)
+	{
+		this->groups.push_back({ static_cast<std::uint16_t>(leader), 0, static_cast<std::uint32_t>(this->runnable.size()) });
+	}
+	else
+	{
+		this->bucket();
+	}
+
+	const std::uint32_t* grouped = uniform ? this->runnable.data() : this->members.data();
+
+	for (const group_t& group : this->groups)
+	{
+		decoded_instruction_t& entry = this->decoded[group.pc];
+
+		if (entry.handler == OP_DECODE)
+			entry = decoder::decode(static_cast<std::uint16_t>(this->image[group.pc] << 8) | this->image[group.pc + 1], this->machine);
+
+		const std::uint32_t* lanes = grouped + group.first;
+
+		if (!this->vectorizable(entry) || this->faults(entry, lanes, group.count))
+		{
+			for (std::uint32_t n = 0; n < group.count; n++)
+			{
+				executed += this->scalar(lanes[n], entry);
+			}
+
+			continue;
+		}
+
+		std::size_t first = lanes[0];
+		std::size_t last = lanes[group.count - 1] + 1;
+
+		/* a dense bucket goes through the vector kernels in one masked pass, a sparse one lane by lane */
+		if (uniform)
+		{
+			this->apply(entry, this->running.data(), first, last);
+		}
+		else if (last - first <= group.count * SPARSE_LIMIT)
+		{
+			for (std::uint32_t n = 0; n < group.count; n++)
+			{
+				this->mask[lanes[n]] = 0xFF;
+			}
+
+			this->apply(entry, this->mask.data(), first, last);
+
+			for (std::uint32_t n = 0; n < group.count; n++)
+			{
+				this->mask[lanes[n]] = 0x00;
+			}
+		}
+		else
+		{
+			for (std::uint32_t n = 0; n < group.count; n++)
+			{
+				this->mask[lanes[n]] = 0xFF;
+				this->apply(entry, this->mask.data(), lanes[n], lanes[n] + 1);
+				this->mask[lanes[n]] = 0x00;
+			}
+		}
+
+		executed += group.count;
+		this->vector_instructions += group.count;
+	}
+
+	for (std::uint32_t lane : this->solo)
+	{
+		const c_chip8& chip8 = *this->machines[lane];
+		std::uint32_t address = this->pc[lane];
+		decoded_instruction_t entry{};
+
+		/* out of memory, the interpreter halts the lane without needing to know what it would have run */
+		if (address <= MEMORY_SIZE - 2)
+			entry = decoder::decode(static_cast<std::uint16_t>(chip8.data[address] << 8) | chip8.data[address + 1], this->machine);
+
+		if (entry.handler != OP_DECODE && this->vectorizable(entry) && !this->faults(entry, &lane, 1))
+		{
+			this->mask[lane] = 0xFF;
+			this->apply(entry, this->mask.data(), lane, lane + 1);
+			this->mask[lane] = 0x00;
+
+			executed++;
+			this->vector_instructions++;
+		}
+		else
+		{
+			executed += this->scalar(lane, entry);
+		}
+	}
+
+	return executed;
+}
+
+/* groups the runnable lanes by pc, lanes that may have rewritten the instruction at their pc go on their own */
+void c_lockstep::bucket()
+{
+	/* a wrapped stamp could match a stale one, start them all over */
+	if (++this->generation == 0)
+	{
+		std::fill_n(this->stamp.get(), MEMORY_SIZE, 0);
+		this->generation = 1;
+	}
+
+	this->member_group.resize(this->runnable.size());
+
+	for (std::size_t n = 0; n < this->runnable.size(); n++)
+	{
+		std::uint32_t lane = this->runnable[n];
+		std::uint32_t address = this->pc[lane];
+
+		if (address > MEMORY_SIZE - 2 || (address + 2 > this->dirty_low[lane] && address < this->dirty_high[lane]))
+		{
+			this->member_group[n] = UINT32_MAX;
+			this->solo.push_back(lane);
+			continue;
+		}
+
+		if (this->stamp[address] != this->generation)
+		{
+			this->stamp[address] = this->generation;
+			this->slot[address] = static_cast<std::uint32_t>(this->groups.size());
+			this->groups.push_back({ static_cast<std::uint16_t>(address), 0, 0 });
+		}
+
+		this->member_group[n] = this->slot[address];
+		this->groups[this->slot[address]].count++;
+	}
+
+	/* lay the buckets out one after another, runnable is in lane order so each bucket is too */
+	std::uint32_t offset = 0;
+
+	for (group_t& group : this->groups)
+	{
+		group.first = offset;
+		offset += group.count;
+		group.count = 0;
+	}
+
+	this->members.resize(offset);
+
+	for (std::size_t n = 0; n < this->runnable.size(); n++)
+	{
+		if (this->member_group[n] == UINT32_MAX)
+			continue;
+
+		group_t& group = this->groups[this->member_group[n]];
+		this->members[group.first + group.count++] = this->runnable[n];
+	}
+}
+
+bool c_lockstep::vectorizable(const decoded_instruction_t& entry) const
+{
+	switch (entry.handler)
+	{
+		case OP_INVALID:
+		case OP_JP:
+		case OP_JPV0ADDR:
+		case OP_CALL:
+		case OP_RET:
+		case OP_LDVXBYTE:
+		case OP_ADDVXBYTE:
+		case OP_LDVXVY:
+		case OP_ORVXVY:
+		case OP_ANDVXVY:
+		case OP_XORVXVY:
+		case OP_ADDVXVY:
+		case OP_SUBVXVY:
+		case OP_SUBNVXVY:
+		case OP_LDIADDR:
+		case OP_LDVXDT:
+		case OP_LDDTVX:
+		case OP_LDSTVX:
+		case OP_ADDIVX:
+		case OP_LDFVX:
+		case OP_LDHFVX:
+			return true;
+
+		/* with X = F the scalar handler shifts the flag it just wrote, not the old VF */
+		case OP_SHRVX:
+		case OP_SHLVX:
+			return entry.x != 0xF;
+
+		/* xo-chip skips have to look at the lane's memory for F000 */
+		case OP_SEVXBYTE:
+		case OP_SNEVXBYTE:
+		case OP_SEVXVY:
+		case OP_SNEVXVY:
+		case OP_SKPVX:
+		case OP_SKNPVX:
+			return this->machine != MACHINE_XOCHIP;
+
+		default:
+			return false;
+	}
+}
+
+/* a call on a full stack or a return on an empty one stops the lane, which only the scalar path reports */
+bool c_lockstep::faults(const decoded_instruction_t& entry, const std::uint32_t* lanes, std::uint32_t count) const
+{
+	if (entry.handler != OP_CALL && entry.handler != OP_RET)
+		return false;
+
+	std::uint8_t limit = entry.handler == OP_CALL ? STACK_DEPTH : 0;
+
+	for (std::uint32_t n = 0; n < count; n++)
+	{
+		if (this->sp[lanes[n]] == limit)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+*	runs one decoded instruction on the masked lanes in [first, last), with the
+*	same results the handlers in instructions.hpp give a single machine
+*/
+void c_lockstep::apply(const decoded_instruction_t& entry, const std::uint8_t* mask, std::size_t first, std::size_t last)
+{
+	std::uint8_t* vx = this->registers(entry.x);
+	std::uint8_t* vy = this->registers(entry.y);
+	std::uint8_t* vf = this->registers(0xF);
+	std::uint8_t byte = static_cast<std::uint8_t>(entry.imm);
+	std::uint16_t* pc = this->pc.data();
+	std::uint16_t* i = this->i.data();
+
+	switch (entry.handler)
+	{
+		case OP_LDVXBYTE: run_alu(LANE_LD, vx, nullptr, byte, vf, mask, first, last); break;
+		case OP_ADDVXBYTE: run_alu(LANE_ADD, vx, nullptr, byte, vf, mask, first, last); break;
+		case OP_LDVXVY: run_alu(LANE_LD, vx, vy, 0, vf, mask, first, last); break;
+		case OP_ORVXVY: run_alu(LANE_OR, vx, vy, 0, vf, mask, first, last); break;
+		case OP_ANDVXVY: run_alu(LANE_AND, vx, vy, 0, vf, mask, first, last); break;
+		case OP_XORVXVY: run_alu(LANE_XOR, vx, vy, 0, vf, mask, first, last); break;
+		case OP_ADDVXVY: run_alu(LANE_ADD_CARRY, vx, vy, 0, vf, mask, first, last); break;
+		case OP_SUBVXVY: run_alu(LANE_SUB, vx, vy, 0, vf, mask, first, last); break;
+		case OP_SUBNVXVY: run_alu(LANE_SUBN, vx, vy, 0, vf, mask, first, last); break;
+		case OP_SHRVX: run_alu(LANE_SHR, vx, nullptr, 0, vf, mask, first, last); break;
+		case OP_SHLVX: run_alu(LANE_SHL, vx, nullptr, 0, vf, mask, first, last); break;
+		case OP_LDVXDT: run_alu(LANE_LD, vx, this->delay.data(), 0, vf, mask, first, last); break;
+		case OP_LDDTVX: run_alu(LANE_LD, this->delay.data(), vx, 0, vf, mask, first, last); break;
+		case OP_LDSTVX: run_alu(LANE_LD, this->sound.data(), vx, 0, vf, mask, first, last); break;
+
+		case OP_SEVXBYTE:
+		case OP_SNEVXBYTE:
+			run_compare(vx, nullptr, byte, entry.handler == OP_SNEVXBYTE, this->condition.data(), mask, first, last);
+			break;
+
+		case OP_SEVXVY:
+		case OP_SNEVXVY:
+			run_compare(vx, vy, 0, entry.handler == OP_SNEVXVY, this->condition.data(), mask, first, last);
+			break;
+
+		case OP_SKPVX:
+		case OP_SKNPVX:
+		{
+			const std::uint16_t* keypad = this->keypad.data();
+			std::uint8_t* condition = this->condition.data();
+			std::uint16_t pressed = entry.handler == OP_SKPVX ? 1 : 0;
+
+			for (std::size_t lane = first; lane < last; lane++)
+			{
+				condition[lane] = ((keypad[lane] >> (vx[lane] & 0xF)) & 1) == pressed ? 2 : 0;
+			}
+
+			break;
+		}
+
+		default:
+			break;
+	}
+
+	/* the word sized registers are plain loops over the mask, which the compiler vectorizes itself */
+	switch (entry.handler)
+	{
+		case OP_JP:
+			for (std::size_t lane = first; lane < last; lane++)
+			{
+				pc[lane] = mask[lane] ? entry.imm : pc[lane];
+			}
+
+			return;
+
+		case OP_JPV0ADDR:
+		{
+			const std::uint8_t* v0 = this->registers(0);
+
+			for (std::size_t lane = first; lane < last; lane++)
+			{
+				pc[lane] = mask[lane] ? (entry.imm + v0[lane]) & MEMORY_MASK : pc[lane];
+			}
+
+			return;
+		}
+
+		/* the stack is indexed by each lane's own sp, faults() has already made sure none of them is full or empty */
+		case OP_CALL:
+		{
+			std::uint16_t* stack = this->stack.data();
+			std::uint8_t* sp = this->sp.data();
+
+			for (std::size_t lane = first; lane < last; lane++)
+			{
+				if (!mask[lane])
+					continue;
+
+				stack[sp[lane]++ * this->stride + lane] = pc[lane] + 2;
+				pc[lane] = entry.imm;
+			}
+
+			return;
+		}
+
+		case OP_RET:
+		{
+			const std::uint16_t* stack = this->stack.data();
+			std::uint8_t* sp = this->sp.data();
+
+			for (std::size_t lane = first; lane < last; lane++)
+			{
+				if (mask[lane])
+					pc[lane] = stack[--sp[lane] * this->stride + lane];
+			}
+
+			return;
+		}
+
+		case OP_SEVXBYTE:
+		case OP_SNEVXBYTE:
+		case OP_SEVXVY:
+		case OP_SNEVXVY:
+		case OP_SKPVX:
+		case OP_SKNPVX:
+		{
+			const std::uint8_t* condition = this->condition.data();
+
+			for (std::size_t lane = first; lane < last; lane++)
+			{
+				pc[lane] += (2 + condition[lane]) & mask[lane];
+			}
+
+			return;
+		}
+
+		case OP_LDIADDR:
+			for (std::size_t lane = first; lane < last; lane++)
+			{
+				i[lane] = mask[lane] ? entry.imm : i[lane];
+			}
+
+			break;
+
+		case OP_ADDIVX:
+			for (std::size_t lane = first; lane < last; lane++)
+			{
+				i[lane] += vx[lane] & mask[lane];
+			}
+
+			break;
+
+		case OP_LDFVX:
+			for (std::size_t lane = first; lane < last; lane++)
+			{
+				i[lane] = mask[lane] ? static_cast<std::uint16_t>(FONTSET_START + (vx[lane] & 0xF) * 5) : i[lane];
+			}
+
+			break;
+
+		case OP_LDHFVX:
+			for (std::size_t lane = first; lane < last; lane++)
+			{
+				i[lane] = mask[lane] ? static_cast<std::uint16_t>(BIG_FONTSET_START + (vx[lane] & 0xF) * 10) : i[lane];
+			}
+
+			break;
+
+		default:
+			break;
+	}
+
+	for (std::size_t lane = first; lane < last; lane++)
+	{
+		pc[lane] += 2 & mask[lane];
+	}
+}
+
+/* one instruction on the lane's own machine, the reference every kernel above has to agree with */
+std::uint64_t c_lockstep::scalar(std::size_t lane, const decoded_instruction_t& entry)
+{
+	c_chip8& chip8 = *this->machines[lane];
+	std::uint32_t length = write_length(entry);
+
+	if (length != 0)
+	{
+		std::uint32_t address = this->i[lane] & MEMORY_MASK;
+
+		/* a write that wraps around the top of memory could be anywhere */
+		if (address + length > MEMORY_SIZE)
+		{
+			this->dirty_low[lane] = 0;
+			this->dirty_high[lane] = MEMORY_SIZE;
+		}
+		else if (this->dirty_low[lane] >= this->dirty_high[lane])
+		{
+			this->dirty_low[lane] = address;
+			this->dirty_high[lane] = address + length;
+		}
+		else
+		{
+			this->dirty_low[lane] = std::min(this->dirty_low[lane], address);
+			this->dirty_high[lane] = std::max(this->dirty_high[lane], address + length);
+		}
+	}
+
+	/* the most common ones call straight into instructions.hpp with the lane arrays, skipping the round trip through the lane's registers */
+	switch (entry.handler)
+	{
+		case OP_CLS:
+			instructions::cls(chip8);
+			this->pc[lane] += 2;
+			this->scalar_instructions++;
+			return 1;
+
+		case OP_RND:
+			instructions::rnd_registerbyte(chip8, this->registers(entry.x)[lane], static_cast<std::uint8_t>(entry.imm));
+			this->pc[lane] += 2;
+			this->scalar_instructions++;
+			return 1;
+
+		case OP_DRW:
+			chip8.registers.i = this->i[lane];
+			instructions::draw(chip8, this->registers(entry.x)[lane], this->registers(entry.y)[lane], entry.n, chip8.data);
+			this->registers(0xF)[lane] = chip8.registers.v[0xF];
+			this->pc[lane] += 2;
+			this->scalar_instructions++;
+			return 1;
+
+		default:
+			break;
+	}
+
+	this->load(lane);
+	std::uint64_t executed = chip8.execute(1);
+	this->store(lane);
+
+	if (chip8.halted || chip8.registers.key_wait)
+		this->stale = true;
+
+	this->scalar_instructions += executed;
+	return executed;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "chip8.hpp"
+
+/*
+*	many copies of one rom run in lockstep, one instruction per lane per step.
+*
+*	the cpu (V, I, PC, the timers and the call stack) is stored structure of arrays,
+*	one array per register with a byte or word per lane. every step the lanes
+*	are bucketed by PC, each bucket decodes once from the rom image and ALU,
+*	timer, jump, call, skip and key instructions are applied across the whole
+*	bucket with AVX2 (or SSE2) under a lane mask. everything else, drawing,
+*	memory and random numbers, runs scalar on the lane's own c_chip8, which
+*	also holds its memory and framebuffer.
+*
+*	a lane that writes memory decodes on its own wherever its writes could
+*	have changed the code, so self-modifying roms stay exact.
+*/
+class c_lockstep
+{
+public:
+	c_lockstep(const std::uint8_t* rom, std::size_t length, std::size_t lanes, MACHINE machine = MACHINE_CHIP8);
+	~c_lockstep();
+
+	std::size_t get_lanes() const
+	{
+		return this->machines.size();
+	}
+
+	/* up to budget instructions per lane, a lane stops early when it halts or waits on FX0A. returns the total over all lanes */
+	std::uint64_t run(std::uint64_t budget);
+
+	/* decrements every lane's delay and sound timers, once per 60 hz tick */
+	void tick_timers();
+
+	void set_keypad(std::size_t lane, std::uint16_t keys);
+
+	/* the lane's machine with its registers brought up to date, for reading its framebuffer, seeding it or saving it */
+	c_chip8& get_lane(std::size_t lane);
+
+	/* reads the registers back after the machine from get_lane was changed, e.g. by restoring a save state */
+	void put_lane(std::size_t lane);
+
+	bool is_halted(std::size_t lane) const
+	{
+		return this->machines[lane]->halted;
+	}
+
+	/* instructions retired through the lane kernels and through a lane's own c_chip8 */
+	std::uint64_t get_vector_instructions() const
+	{
+		return this->vector_instructions;
+	}
+
+	std::uint64_t get_scalar_instructions() const
+	{
+		return this->scalar_instructions;
+	}
+private:
+	struct group_t
+	{
+		std::uint16_t pc;
+		std::uint32_t first;
+		std::uint32_t count;
+	};
+
+	std::uint64_t step();
+	void bucket();
+	void apply(const decoded_instruction_t& entry, const std::uint8_t* mask, std::size_t first, std::size_t last);
+	bool vectorizable(const decoded_instruction_t& entry) const;
+	std::uint64_t scalar(std::size_t lane, const decoded_instruction_t& entry);
+	bool faults(const decoded_instruction_t& entry, const std::uint32_t* lanes, std::uint32_t count) const;
+	void load(std::size_t lane);
+	void store(std::size_t lane);
+	void find_runnable();
+
+	std::uint8_t* registers(int x)
+	{
+		return this->v.data() + x * this->stride;
+	}
+
+	MACHINE machine;
+	std::vector<std::unique_ptr<c_chip8>> machines;
+
+	/*
+	*	lane arrays, padded to stride lanes so the kernels never need a tail on
+	*	the padding. V and the stack keep every register in one block, register x
+	*	of lane n at x * stride + n.
+	*/
+	std::size_t stride{};
+	std::vector<std::uint8_t> v;
+	std::vector<std::uint16_t> i;
+	std::vector<std::uint16_t> pc;
+	std::vector<std::uint8_t> delay;
+	std::vector<std::uint8_t> sound;
+	std::vector<std::uint8_t> sp;
+	std::vector<std::uint16_t> stack;
+	std::vector<std::uint16_t> keypad;
+
+	/* 0xFF for the lanes the kernel being run applies to, and for every runnable lane, which is the mask when they all share a pc */
+	std::vector<std::uint8_t> mask;
+	std::vector<std::uint8_t> running;
+	std::vector<std::uint8_t> condition;
+
+	/* the bytes a lane may have written, [dirty_low, dirty_high), anything outside still matches the rom image */
+	std::vector<std::uint32_t> dirty_low;
+	std::vector<std::uint32_t> dirty_high;
+
+	/* memory as every lane powered on, and one decode per address of it shared by all lanes */
+	std::unique_ptr<std::uint8_t[]> image;
+	std::unique_ptr<decoded_instruction_t[]> decoded;
+
+	/* per step bucketing, a stamp per address tells whether it has a group yet this step */
+	std::vector<std::uint32_t> runnable;
+	std::vector<std::uint32_t> members;
+	std::vector<std::uint32_t> member_group;
+	std::vector<std::uint32_t> solo;
+	std::vector<group_t> groups;
+	std::unique_ptr<std::uint32_t[]> stamp;
+	std::unique_ptr<std::uint32_t[]> slot;
+	std::uint32_t generation{};
+
+	/* set when a lane may have stopped or started, the runnable list is rebuilt before the next step */
+	bool stale = true;
+
+	std::uint64_t vector_instructions{};
+	std::uint64_t scalar_instructions{};
+};
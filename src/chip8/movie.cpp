@@ -0,0 +1,154 @@
+#include "movie.hpp"
+#include "chip8.hpp"
+#include "savestate.hpp"
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+	/* fnv-1a over the rom as loaded, before the program had a chance to modify itself */
+	std::uint32_t rom_hash(const c_chip8& chip8)
+	{
+		std::uint32_t hash = 0x811C9DC5;
+
+		for (unsigned int i = 0; i < chip8.get_length(); i++)
+		{
+			hash ^= chip8.data[PROGRAM_START + i];
+			hash *= 0x01000193;
+		}
+
+		return hash;
+	}
+}
+
+void c_movie::begin(c_chip8& chip8, std::uint64_t seed, std::uint32_t instructions_per_second, std::uint8_t engine)
+{
+	this->header = { MOVIE_MAGIC, MOVIE_VERSION, engine, chip8.get_machine(), chip8.get_length(), rom_hash(chip8), seed, instructions_per_second, 0 };
+	this->frames.clear();
+
+	chip8.rng.seed(seed);
+}
+
+void c_movie::drop(std::size_t count)
+{
+	this->frames.resize(this->frames.size() > count ? this->frames.size() - count : 0);
+}
+
+bool c_movie::matches(const c_chip8& chip8) const
+{
+	return this->header.rom_size == chip8.get_length() && this->header.rom_hash == rom_hash(chip8);
+}
+
+bool c_movie::save(const std::string& filename)
+{
+	std::FILE* file = std::fopen(filename.c_str(), "wb");
+
+	if (file == nullptr)
+	{
+		std::printf("MOVIE ERROR: couldn't open %s for writing\n", filename.c_str());
+		return false;
+	}
+
+	this->header.frames = static_cast<std::uint32_t>(this->frames.size());
+
+	bool written = std::fwrite(&this->header, sizeof(this->header), 1, file) == 1
+		&& std::fwrite(this->frames.data(), sizeof(std::uint16_t), this->frames.size(), file) == this->frames.size();
+
+	std::fclose(file);
+	return written;
+}
+
+bool c_movie::load(const std::string& filename)
+{
+	std::FILE* file = std::fopen(filename.c_str(), "rb");
+
+	if (file == nullptr)
+	{
+		std::printf("MOVIE ERROR: couldn't open %s\n", filename.c_str());
+		return false;
+	}
+
+	movie_header_t header{};
+
+	if (std::fread(&header, sizeof(header), 1, file) != 1 || header.magic != MOVIE_MAGIC || header.version != MOVIE_VERSION)
+	{
+		std::printf("MOVIE ERROR: %s is not a version %u movie\n", filename.c_str(), MOVIE_VERSION);
+		std::fclose(file);
+		return false;
+	}
+
+	std::vector<std::uint16_t> frames(header.frames);
+	std::size_t length = std::fread(frames.data(), sizeof(std::uint16_t), frames.size(), file);
+	std::fclose(file);
+
+	if (length != frames.size())
+	{
+		std::printf("MOVIE ERROR: %s is truncated, %zu of %u frames\n", filename.c_str(), length, header.frames);
+		return false;
+	}
+
+	this->header = header;
+	this->frames = std::move(frames);
+	return true;
+}
+
+c_replay::c_replay(c_chip8& chip8, const c_movie& movie, std::uint32_t checkpoint_interval)
+	: chip8(chip8), movie(movie), checkpoint_interval(checkpoint_interval != 0 ? checkpoint_interval : 1)
+{
+	const movie_header_t& header = movie.get_header();
+
+	if (!movie.matches(chip8))
+		std::printf("MOVIE WARNING: the movie was recorded against a different rom\n");
+
+	chip8.set_machine(header.machine <= MACHINE_XOCHIP ? static_cast<MACHINE>(header.machine) : MACHINE_CHIP8);
+	chip8.set_engine(static_cast<ENGINE>(header.engine));
+	chip8.rng.seed(header.seed);
+	chip8.scheduler.set_mode(SPEED_FAST_FORWARD);
+	chip8.scheduler.set_instructions_per_second(header.instructions_per_second);
+
+	this->checkpoints.push_back(savestate::serialize(chip8));
+}
+
+bool c_replay::step()
+{
+	if (this->frame >= this->movie.get_frames() || this->chip8.halted)
+		return false;
+
+	/* same order as emulate, the keypad is latched before the tick that sees it */
+	this->chip8.set_keypad(this->movie.get_keys(this->frame));
+	this->instructions += this->chip8.scheduler.tick();
+	this->frame++;
+
+	if (this->frame % this->checkpoint_interval == 0 && this->frame / this->checkpoint_interval == this->checkpoints.size())
+		this->checkpoints.push_back(savestate::serialize(this->chip8));
+
+	return true;
+}
+
+bool c_replay::seek(std::size_t frame)
+{
+	if (frame > this->movie.get_frames())
+		return false;
+
+	std::size_t checkpoint = std::min(frame / this->checkpoint_interval, this->checkpoints.size() - 1);
+	std::size_t checkpoint_frame = checkpoint * this->checkpoint_interval;
+
+	/* playing on from where we are beats restoring when the target is ahead and no closer checkpoint exists */
+	if (frame < this->frame || this->frame < checkpoint_frame)
+	{
+		const std::vector<std::uint8_t>& state = this->checkpoints[checkpoint];
+
+		if (state.empty() || !savestate::restore(this->chip8, state.data(), state.size()))
+			return false;
+
+		this->frame = checkpoint_frame;
+	}
+
+	while (this->frame < frame)
+	{
+		if (!this->step())
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class c_chip8;
+
+constexpr std::uint32_t MOVIE_MAGIC = 0x564D3843; // "C8MV"
+constexpr std::uint16_t MOVIE_VERSION = 1;
+
+/* frames between the save states a replay keeps for seeking, ten seconds of play */
+constexpr std::uint32_t MOVIE_CHECKPOINT_INTERVAL = 600;
+
+struct movie_header_t
+{
+	std::uint32_t magic;
+	std::uint16_t version;
+	std::uint8_t engine;
+
+	/* the MACHINE, 0 in movies made before there was a choice, which is plain chip-8 */
+	std::uint8_t machine;
+	std::uint32_t rom_size;
+	std::uint32_t rom_hash;
+	std::uint64_t seed;
+	std::uint32_t instructions_per_second;
+	std::uint32_t frames;
+};
+
+/*
+*	an input movie is everything besides the rom that decides how a run goes:
+*	the rng seed, the instruction clock, the engine, the instruction set and
+*	the keypad bitmap of every 60 hz tick starting from power on. the file is
+*	the header followed by one little endian u16 per tick.
+*/
+class c_movie
+{
+public:
+	/* starts an empty recording of a freshly loaded machine and reseeds it so the run can be reproduced */
+	void begin(c_chip8& chip8, std::uint64_t seed, std::uint32_t instructions_per_second, std::uint8_t engine);
+
+	void record(std::uint16_t keypad)
+	{
+		this->frames.push_back(keypad);
+	}
+
+	/* forgets the last count ticks, used when a recording is rewound */
+	void drop(std::size_t count);
+
+	std::uint16_t get_keys(std::size_t frame) const
+	{
+		return frame < this->frames.size() ? this->frames[frame] : 0;
+	}
+
+	std::size_t get_frames() const
+	{
+		return this->frames.size();
+	}
+
+	const movie_header_t& get_header() const
+	{
+		return this->header;
+	}
+
+	/* whether chip8 holds the rom the movie was recorded against */
+	bool matches(const c_chip8& chip8) const;
+
+	bool save(const std::string& filename);
+	bool load(const std::string& filename);
+private:
+	movie_header_t header{};
+	std::vector<std::uint16_t> frames;
+};
+
+/*
+*	plays a movie back on a headless machine as fast as the host allows.
+*	a save state is kept every checkpoint_interval frames on the way, so
+*	seeking only replays from the nearest checkpoint before the target.
+*/
+class c_replay
+{
+public:
+	/* chip8 has to be freshly loaded with the movie's rom */
+	c_replay(c_chip8& chip8, const c_movie& movie, std::uint32_t checkpoint_interval = MOVIE_CHECKPOINT_INTERVAL);
+
+	/* plays one tick, false once the movie is over or the machine halted */
+	bool step();
+
+	/* lands on the state just before tick frame is played */
+	bool seek(std::size_t frame);
+
+	std::size_t get_frame() const
+	{
+		return this->frame;
+	}
+
+	std::uint64_t get_instructions() const
+	{
+		return this->instructions;
+	}
+private:
+	c_chip8& chip8;
+	const c_movie& movie;
+	std::uint32_t checkpoint_interval{};
+
+	std::size_t frame{};
+	std::uint64_t instructions{};
+
+	/* checkpoints[n] is the state before tick n * checkpoint_interval */
+	std::vector<std::vector<std::uint8_t>> checkpoints;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+enum HIOPCODE
+{
+	JP = 0x1000,
+	CALL = 0x2000,
+	SEVXBYTE = 0x3000,
+	SNEVXBYTE = 0x4000,
+	SEVXVY = 0x5000,
+	LDVXBYTE = 0x6000,
+	ADDVXBYTE = 0x7000,
+	LD = 0x8000,
+	SNEVXVY = 0x9000,
+	LDIADDR = 0xA000,
+	JPV0ADDR = 0xB000,
+	RND = 0xC000,
+	DRW = 0xD000,
+	SKP = 0xE000,
+	LDSPECIAL = 0xF000,
+
+};
+
+enum LOWOPCODE
+{
+	// 0x00NN instructions below
+	CLS = 0xE0,
+	RET = 0xEE,
+
+	// super-chip 0x00NN, the scrolls by n rows keep n in the low nibble
+	SCD = 0xC0,
+	SCU = 0xD0,
+	SCR = 0xFB,
+	SCL = 0xFC,
+	EXIT = 0xFD,
+	LOW = 0xFE,
+	HIGH = 0xFF,
+
+	// xo-chip 0x5XYN
+	SAVEVXVY = 0x2,
+	LOADVXVY = 0x3,
+
+	VXVY = 0x0,
+	ORVXVY = 0x1,
+	ANDVXVY = 0x2,
+	XORVXVY = 0x3,
+	ADDVXVY = 0x4,
+	SUBVXVY = 0x5,
+	SHRVX1 = 0x6,
+	SUBNVXVY = 0x7,
+	SHLVX1 = 0xE,
+
+	SKPVX = 0x9E,
+	SKNPVX = 0xA1,
+
+	LDVXDT = 0x07,
+	LDVXK = 0x0A,
+	LDDTVX = 0x15,
+	LDSTVX = 0x18,
+	ADDIVX = 0x1E,
+	LDFVX = 0x29,
+	LDBVX = 0x33,
+	LDIARRAYFROMV0VX = 0x55,
+	LDV0VXFROMIARRAY = 0x65,
+
+	// super-chip and xo-chip 0xFXNN
+	LDILONG = 0x00,
+	PLANE = 0x01,
+	AUDIO = 0x02,
+	LDHFVX = 0x30,
+	PITCH = 0x3A,
+	SAVEFLAGS = 0x75,
+	LOADFLAGS = 0x85
+};
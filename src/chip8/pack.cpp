@@ -0,0 +1,262 @@
+#include "pack.hpp"
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	struct pending_t
+	{
+		std::uint8_t sha1[SHA1_SIZE];
+		const pack_rom_t* rom;
+	};
+}
+
+namespace rompack
+{
+	std::size_t write(const std::string& filename, const std::vector<pack_rom_t>& roms)
+	{
+		std::vector<pending_t> pending(roms.size());
+
+		for (std::size_t i = 0; i < roms.size(); i++)
+		{
+			sha1(roms[i].bytes.data(), roms[i].bytes.size(), pending[i].sha1);
+			pending[i].rom = &roms[i];
+		}
+
+		/* stable, so of several copies of a rom the first one given keeps its name */
+		std::stable_sort(pending.begin(), pending.end(), [](const pending_t& a, const pending_t& b)
+		{
+			return std::memcmp(a.sha1, b.sha1, SHA1_SIZE) < 0;
+		});
+
+		pending.erase(std::unique(pending.begin(), pending.end(), [](const pending_t& a, const pending_t& b)
+		{
+			return std::memcmp(a.sha1, b.sha1, SHA1_SIZE) == 0;
+		}), pending.end());
+
+		std::vector<pack_entry_t> entries(pending.size());
+		std::vector<char> names;
+
+		std::uint64_t names_offset = sizeof(pack_header_t) + entries.size() * sizeof(pack_entry_t);
+
+		for (std::size_t i = 0; i < pending.size(); i++)
+		{
+			const std::string& name = pending[i].rom->name;
+
+			std::memcpy(entries[i].sha1, pending[i].sha1, SHA1_SIZE);
+			entries[i].size = static_cast<std::uint32_t>(pending[i].rom->bytes.size());
+			entries[i].name = static_cast<std::uint32_t>(names.size());
+			entries[i].profile = pending[i].rom->profile;
+
+			names.insert(names.end(), name.begin(), name.end());
+			names.push_back('\0');
+		}
+
+		std::uint64_t offset = names_offset + names.size();
+
+		for (pack_entry_t& entry : entries)
+		{
+			entry.offset = offset;
+			offset += entry.size;
+		}
+
+		pack_header_t header{ PACK_MAGIC, PACK_VERSION, 0, static_cast<std::uint32_t>(entries.size()), static_cast<std::uint32_t>(names_offset), offset };
+
+		std::FILE* file = std::fopen(filename.c_str(), "wb");
+
+		if (file == nullptr)
+		{
+			std::printf("PACK ERROR: couldn't open %s for writing\n", filename.c_str());
+			return 0;
+		}
+
+		bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+		written = written && std::fwrite(entries.data(), sizeof(pack_entry_t), entries.size(), file) == entries.size();
+		written = written && std::fwrite(names.data(), 1, names.size(), file) == names.size();
+
+		for (std::size_t i = 0; written && i < pending.size(); i++)
+		{
+			const std::vector<std::uint8_t>& bytes = pending[i].rom->bytes;
+			written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+		}
+
+		std::fclose(file);
+
+		if (!written)
+		{
+			std::printf("PACK ERROR: couldn't write %s\n", filename.c_str());
+			return 0;
+		}
+
+		return entries.size();
+	}
+}
+
+c_rom_pack::~c_rom_pack()
+{
+	this->close();
+}
+
+bool c_rom_pack::open(const std::string& filename)
+{
+	this->close();
+
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	LARGE_INTEGER length{};
+
+	if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &length) || length.QuadPart == 0)
+	{
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+
+		std::printf("PACK ERROR: couldn't open %s\n", filename.c_str());
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	void* view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+	this->file = file;
+	this->mapping = mapping;
+
+	if (view == nullptr)
+	{
+		std::printf("PACK ERROR: couldn't map %s\n", filename.c_str());
+		this->close();
+		return false;
+	}
+
+	this->base = static_cast<const std::uint8_t*>(view);
+	this->size = static_cast<std::size_t>(length.QuadPart);
+#else
+	int file = ::open(filename.c_str(), O_RDONLY);
+	struct stat status{};
+
+	if (file < 0 || fstat(file, &status) != 0 || status.st_size == 0)
+	{
+		if (file >= 0)
+			::close(file);
+
+		std::printf("PACK ERROR: couldn't open %s\n", filename.c_str());
+		return false;
+	}
+
+	/* the mapping keeps its own reference to the file, the descriptor isn't needed past this */
+	void* view = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+
+	if (view == MAP_FAILED)
+	{
+		std::printf("PACK ERROR: couldn't map %s\n", filename.c_str());
+		return false;
+	}
+
+	this->base = static_cast<const std::uint8_t*>(view);
+	this->size = static_cast<std::size_t>(status.st_size);
+#endif
+
+	pack_header_t header{};
+
+	if (this->size >= sizeof(header))
+		std::memcpy(&header, this->base, sizeof(header));
+
+	if (header.magic != PACK_MAGIC || header.version != PACK_VERSION || header.size != this->size)
+	{
+		std::printf("PACK ERROR: %s isn't a version %u rom pack\n", filename.c_str(), PACK_VERSION);
+		this->close();
+		return false;
+	}
+
+	bool valid = header.names_offset == sizeof(header) + static_cast<std::uint64_t>(header.count) * sizeof(pack_entry_t) && header.names_offset <= this->size;
+
+	/* everything an entry points at has to be inside the file, a corrupt pack mustn't read past the mapping */
+	this->entries = reinterpret_cast<const pack_entry_t*>(this->base + sizeof(header));
+
+	for (std::uint32_t i = 0; valid && i < header.count; i++)
+	{
+		const pack_entry_t& entry = this->entries[i];
+
+		valid = entry.offset >= header.names_offset && entry.offset <= this->size && entry.size <= this->size - entry.offset;
+	}
+
+	/* every name ends before the first rom, so a nul there terminates all of them */
+	if (valid && header.count > 0)
+	{
+		std::uint64_t first = this->entries[0].offset;
+
+		for (std::uint32_t i = 1; i < header.count; i++)
+		{
+			first = std::min<std::uint64_t>(first, this->entries[i].offset);
+		}
+
+		valid = first > header.names_offset && this->base[first - 1] == '\0';
+
+		for (std::uint32_t i = 0; valid && i < header.count; i++)
+		{
+			valid = header.names_offset + this->entries[i].name < first;
+		}
+	}
+
+	if (!valid)
+	{
+		std::printf("PACK ERROR: %s is corrupt\n", filename.c_str());
+		this->close();
+		return false;
+	}
+
+	this->count = header.count;
+	this->names_offset = header.names_offset;
+	return true;
+}
+
+void c_rom_pack::close()
+{
+#if defined(_WIN32)
+	if (this->base != nullptr)
+		UnmapViewOfFile(this->base);
+
+	if (this->mapping != nullptr)
+		CloseHandle(this->mapping);
+
+	if (this->file != nullptr)
+		CloseHandle(this->file);
+
+	this->file = nullptr;
+	this->mapping = nullptr;
+#else
+	if (this->base != nullptr)
+		munmap(const_cast<std::uint8_t*>(this->base), this->size);
+#endif
+
+	this->base = nullptr;
+	this->size = 0;
+	this->entries = nullptr;
+	this->count = 0;
+	this->names_offset = 0;
+}
+
+std::ptrdiff_t c_rom_pack::find(const std::uint8_t digest[SHA1_SIZE]) const
+{
+	const pack_entry_t* end = this->entries + this->count;
+	const pack_entry_t* entry = std::lower_bound(this->entries, end, digest, [](const pack_entry_t& a, const std::uint8_t* b)
+	{
+		return std::memcmp(a.sha1, b, SHA1_SIZE) < 0;
+	});
+
+	if (entry == end || std::memcmp(entry->sha1, digest, SHA1_SIZE) != 0)
+		return -1;
+
+	return entry - this->entries;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "decoder.hpp"
+#include "../util/sha1.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+constexpr std::uint32_t PACK_MAGIC = 0x4B503843; // "C8PK"
+constexpr std::uint16_t PACK_VERSION = 1;
+
+struct pack_header_t
+{
+	std::uint32_t magic;
+	std::uint16_t version;
+	std::uint16_t reserved;
+	std::uint32_t count;
+	std::uint32_t names_offset;
+	std::uint64_t size;
+};
+
+struct pack_entry_t
+{
+	std::uint8_t sha1[SHA1_SIZE];
+	std::uint32_t size;
+	std::uint64_t offset;
+	std::uint32_t name;
+
+	/* the MACHINE the rom was written for, taken from its extension when the pack is built */
+	std::uint8_t profile;
+	std::uint8_t reserved[3];
+};
+
+static_assert(sizeof(pack_header_t) == 24, "pack header layout changed");
+static_assert(sizeof(pack_entry_t) == 40, "pack entry layout changed");
+
+/* one rom handed to rompack::write */
+struct pack_rom_t
+{
+	std::string name;
+	MACHINE profile;
+	std::vector<std::uint8_t> bytes;
+};
+
+/*
+*	a rom pack is many roms in one little endian file: the header, the index
+*	sorted by sha-1 so a rom is found with a binary search, a table of the
+*	nul terminated source paths, then the rom images back to back. identical
+*	roms are stored once.
+*/
+namespace rompack
+{
+	/* returns the number of roms written, duplicates dropped */
+	std::size_t write(const std::string& filename, const std::vector<pack_rom_t>& roms);
+}
+
+/*
+*	read only view of a pack file. the file is mapped rather than read, so
+*	opening a pack of any size costs one open and the index is only paged in
+*	as it is touched. rom pointers stay valid until the pack is closed.
+*/
+class c_rom_pack
+{
+public:
+	c_rom_pack() = default;
+	~c_rom_pack();
+
+	c_rom_pack(const c_rom_pack&) = delete;
+	c_rom_pack& operator=(const c_rom_pack&) = delete;
+
+	bool open(const std::string& filename);
+	void close();
+
+	std::size_t get_count() const
+	{
+		return this->count;
+	}
+
+	const pack_entry_t& get_entry(std::size_t index) const
+	{
+		return this->entries[index];
+	}
+
+	const std::uint8_t* get_rom(std::size_t index) const
+	{
+		return this->base + this->entries[index].offset;
+	}
+
+	const char* get_name(std::size_t index) const
+	{
+		return reinterpret_cast<const char*>(this->base + this->names_offset + this->entries[index].name);
+	}
+
+	/* index of the rom with this digest, or -1 */
+	std::ptrdiff_t find(const std::uint8_t digest[SHA1_SIZE]) const;
+private:
+	const std::uint8_t* base{};
+	std::size_t size{};
+	const pack_entry_t* entries{};
+	std::size_t count{};
+	std::size_t names_offset{};
+
+#if defined(_WIN32)
+	void* file{};
+	void* mapping{};
+#endif
+};
@@ -1,11 +1,10 @@
 #pragma once
 
 #include <cstdint>
-#include <iostream>
-#include <concepts>
-#include <stack>
+#include <type_traits>
 
-constexpr unsigned int MAX_REGISTERS = 21;
+/* return addresses the call stack can hold, as many as the original interpreter had room for */
+constexpr unsigned int STACK_DEPTH = 16;
 
 enum REGISTERS
 {
@@ -32,74 +31,77 @@ enum REGISTERS
 	PC
 };
 
-struct register_t
+enum CPU_FAULT : std::uint8_t
 {
-	union values
-	{
-		std::uint8_t value;
-		std::uint16_t value16;
-	};
-
-	values value_union;
+	FAULT_NONE,
+	FAULT_STACK_OVERFLOW,
+	FAULT_STACK_UNDERFLOW
 };
 
-class c_register
+/*
+*	the whole cpu, return stack included, as one plain 64 byte block. it never
+*	touches the heap, copies with a memcpy and sits in a single cache line.
+*/
+class alignas(64) c_register
 {
 public:
-	template<REGISTERS REG_ID, std::integral T>
-	void set_value(T value)
+	/* resolves to the field behind REG_ID at compile time */
+	template<REGISTERS REG_ID>
+	auto& get()
 	{
-		if (std::is_same_v<T, std::uint16_t>)
-		{
-			this->register_array[REG_ID].value_union.value16 = value;
-		}
-		else if (std::is_same_v<T, std::uint8_t>)
-		{
-			this->register_array[REG_ID].value_union.value = value;
-		}
+		if constexpr (REG_ID <= REGISTERS::VF)
+			return this->v[REG_ID];
+		else if constexpr (REG_ID == REGISTERS::VI)
+			return this->i;
+		else if constexpr (REG_ID == REGISTERS::V_DELAY)
+			return this->delay;
+		else if constexpr (REG_ID == REGISTERS::V_SOUND)
+			return this->sound;
+		else if constexpr (REG_ID == REGISTERS::VSP)
+			return this->sp;
+		else
+			return this->pc;
 	}
 
-	template<enum REGISTERS REG_ID, std::integral T>
-	void increment()
+	/* a full stack drops the address and records the fault instead */
+	bool push(std::uint16_t address)
 	{
-		if (std::is_same_v<T, std::uint16_t>)
-		{
-			this->register_array[REG_ID].value_union.value16 += 1;
-		}
-		else if (std::is_same_v<T, std::uint8_t>)
+		if (this->sp >= STACK_DEPTH)
 		{
-			this->register_array[REG_ID].value_union.value += 1;
+			this->fault = FAULT_STACK_OVERFLOW;
+			return false;
 		}
+
+		this->stack[this->sp++] = address;
+		return true;
 	}
 
-	template<enum REGISTERS REG_ID, std::integral T>
-	void decrement()
+	bool pop(std::uint16_t& address)
 	{
-		if (std::is_same_v<T, std::uint16_t>)
-		{
-			this->register_array[REG_ID].value_union.value16 -= 1;
-		}
-		else if (std::is_same_v<T, std::uint8_t>)
+		if (this->sp == 0)
 		{
-			this->register_array[REG_ID].value_union.value -= 1;
+			this->fault = FAULT_STACK_UNDERFLOW;
+			return false;
 		}
+
+		address = this->stack[--this->sp];
+		return true;
 	}
 
+	std::uint8_t v[16];
+	std::uint16_t i;
+	std::uint16_t pc;
+	std::uint8_t delay;
+	std::uint8_t sound;
+	std::uint8_t sp;
+	CPU_FAULT fault;
 
-	template<enum REGISTERS REG_ID, std::integral T>
-	T get_value()
-	{
-		if (std::is_same_v<T, std::uint16_t>)
-		{
-			return this->register_array[REG_ID].value_union.value16;
-		}
-		else if (std::is_same_v<T, std::uint8_t>)
-		{
-			return this->register_array[REG_ID].value_union.value;
-		}
-	}
+	/* set by FX0A, the cpu retires nothing until a key press lands in V[key_register] */
+	bool key_wait;
+	std::uint8_t key_register;
+
+	std::uint16_t stack[STACK_DEPTH];
+};
 
-	std::stack<std::uint16_t> stack;
-	register_t register_array[MAX_REGISTERS];
-private:
-};
\ No newline at end of file
+static_assert(sizeof(c_register) == 64, "the register file is meant to fill exactly one cache line");
+static_assert(std::is_trivially_copyable_v<c_register>, "the register file has to stay copyable with memcpy");
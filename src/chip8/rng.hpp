@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+*	xorshift64* generator. the whole state is one word, so it fits in a save
+*	state and a run started from the same seed draws the same numbers.
+*/
+class c_rng
+{
+public:
+	c_rng(std::uint64_t seed = 0)
+	{
+		this->seed(seed);
+	}
+
+	void seed(std::uint64_t seed)
+	{
+		/* splitmix64 spreads small seeds over the whole word, zero would lock xorshift at zero */
+		std::uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		z ^= z >> 31;
+
+		this->state = z != 0 ? z : 0x9E3779B97F4A7C15ull;
+	}
+
+	std::uint8_t next_byte()
+	{
+		this->state ^= this->state >> 12;
+		this->state ^= this->state << 25;
+		this->state ^= this->state >> 27;
+
+		return static_cast<std::uint8_t>((this->state * 0x2545F4914F6CDD1Dull) >> 56);
+	}
+
+	std::uint64_t get_state() const
+	{
+		return this->state;
+	}
+
+	void set_state(std::uint64_t state)
+	{
+		this->state = state != 0 ? state : 0x9E3779B97F4A7C15ull;
+	}
+private:
+	std::uint64_t state{};
+};
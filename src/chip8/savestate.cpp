@@ -0,0 +1,402 @@
+#include "savestate.hpp"
+#include "chip8.hpp"
+#include <cstring>
+#include <cstdio>
+
+namespace
+{
+	constexpr std::uint16_t FLAG_HIRES = 1 << 0;
+	constexpr std::uint16_t FLAG_HALTED = 1 << 1;
+
+	/* the high byte of the flags word holds the cpu fault */
+	constexpr int FLAG_FAULT_SHIFT = 8;
+
+	/* V0-VF, then I, PC, DT, ST, the FX0A wait flag and its register */
+	constexpr std::size_t REGISTERS_SIZE = 16 + 2 * sizeof(std::uint16_t) + 4;
+	constexpr std::size_t STACK_SIZE = sizeof(std::uint16_t) + STACK_DEPTH * sizeof(std::uint16_t);
+	constexpr std::size_t DISPLAY_SIZE = sizeof(std::uint16_t) + sizeof(c_framebuffer::rows);
+
+	/* rng state, keypad, scheduler remainder and balance. everything a replay needs to continue identically */
+	constexpr std::size_t DETERMINISM_SIZE = sizeof(std::uint64_t) + sizeof(std::uint16_t) + sizeof(std::uint32_t) + sizeof(std::int64_t);
+
+	/* machine, plane mask, the super-chip flags, the xo-chip audio pattern and pitch */
+	constexpr std::size_t EXTENSIONS_SIZE = 2 + sizeof(c_chip8::flags) + sizeof(c_chip8::audio_pattern) + 1;
+
+	void put16(std::uint8_t*& out, std::uint16_t value)
+	{
+		std::memcpy(out, &value, sizeof(value));
+		out += sizeof(value);
+	}
+
+	std::uint16_t get16(const std::uint8_t*& in)
+	{
+		std::uint16_t value;
+		std::memcpy(&value, in, sizeof(value));
+		in += sizeof(value);
+		return value;
+	}
+
+	template<typename T>
+	void put(std::uint8_t*& out, T value)
+	{
+		std::memcpy(out, &value, sizeof(value));
+		out += sizeof(value);
+	}
+
+	template<typename T>
+	T get(const std::uint8_t*& in)
+	{
+		T value;
+		std::memcpy(&value, in, sizeof(value));
+		in += sizeof(value);
+		return value;
+	}
+
+	void put_varint(std::vector<std::uint8_t>& out, std::size_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back(static_cast<std::uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+
+		out.push_back(static_cast<std::uint8_t>(value));
+	}
+
+	std::size_t get_varint(const std::uint8_t*& in)
+	{
+		std::size_t value = 0;
+
+		for (int shift = 0; ; shift += 7)
+		{
+			std::uint8_t byte = *in++;
+			value |= static_cast<std::size_t>(byte & 0x7F) << shift;
+
+			if ((byte & 0x80) == 0)
+				return value;
+		}
+	}
+
+	/* encodes current ^ previous as alternating zero runs and literal runs */
+	std::vector<std::uint8_t> encode_delta(const std::vector<std::uint8_t>& previous, const std::vector<std::uint8_t>& current)
+	{
+		std::vector<std::uint8_t> out;
+		std::size_t size = current.size();
+		std::size_t i = 0;
+
+		while (i < size)
+		{
+			std::size_t zeros = i;
+
+			while (zeros < size && current[zeros] == previous[zeros])
+			{
+				zeros++;
+			}
+
+			std::size_t literals = zeros;
+
+			while (literals < size && current[literals] != previous[literals])
+			{
+				literals++;
+			}
+
+			put_varint(out, zeros - i);
+			put_varint(out, literals - zeros);
+
+			for (std::size_t j = zeros; j < literals; j++)
+			{
+				out.push_back(current[j] ^ previous[j]);
+			}
+
+			i = literals;
+		}
+
+		return out;
+	}
+
+	void apply_delta(std::vector<std::uint8_t>& state, const std::vector<std::uint8_t>& delta)
+	{
+		const std::uint8_t* in = delta.data();
+		const std::uint8_t* end = in + delta.size();
+		std::size_t position = 0;
+
+		while (in < end)
+		{
+			position += get_varint(in);
+			std::size_t literals = get_varint(in);
+
+			for (std::size_t j = 0; j < literals; j++)
+			{
+				state[position++] ^= *in++;
+			}
+		}
+	}
+}
+
+namespace savestate
+{
+	std::size_t size(const c_chip8&)
+	{
+		return sizeof(savestate_header_t) + REGISTERS_SIZE + STACK_SIZE + DISPLAY_SIZE + DETERMINISM_SIZE + EXTENSIONS_SIZE + MEMORY_SIZE;
+	}
+
+	bool serialize(const c_chip8& chip8, std::uint8_t* out)
+	{
+		savestate_header_t header{ SAVESTATE_MAGIC, SAVESTATE_VERSION, 0, MEMORY_SIZE, static_cast<std::uint32_t>(size(chip8)) };
+		std::memcpy(out, &header, sizeof(header));
+		out += sizeof(header);
+
+		const c_register& regs = chip8.registers;
+
+		std::memcpy(out, regs.v, sizeof(regs.v));
+		out += sizeof(regs.v);
+
+		put16(out, regs.i);
+		put16(out, regs.pc);
+		put<std::uint8_t>(out, regs.delay);
+		put<std::uint8_t>(out, regs.sound);
+		put<std::uint8_t>(out, regs.key_wait ? 1 : 0);
+		put<std::uint8_t>(out, regs.key_register);
+
+		/* slots above the stack pointer are stale but saved anyway, it keeps the layout fixed */
+		put16(out, regs.sp);
+
+		for (std::uint16_t slot : regs.stack)
+		{
+			put16(out, slot);
+		}
+
+		std::uint16_t flags = (chip8.framebuffer.hires ? FLAG_HIRES : 0) | (chip8.halted ? FLAG_HALTED : 0) | (regs.fault << FLAG_FAULT_SHIFT);
+		put16(out, flags);
+
+		std::memcpy(out, chip8.framebuffer.rows, sizeof(chip8.framebuffer.rows));
+		out += sizeof(chip8.framebuffer.rows);
+
+		put<std::uint64_t>(out, chip8.rng.get_state());
+		put<std::uint16_t>(out, chip8.keypad);
+		put<std::uint32_t>(out, chip8.scheduler.get_remainder());
+		put<std::int64_t>(out, chip8.scheduler.get_balance());
+
+		put<std::uint8_t>(out, chip8.get_machine());
+		put<std::uint8_t>(out, chip8.framebuffer.plane_mask);
+
+		std::memcpy(out, chip8.flags, sizeof(chip8.flags));
+		out += sizeof(chip8.flags);
+
+		std::memcpy(out, chip8.audio_pattern, sizeof(chip8.audio_pattern));
+		out += sizeof(chip8.audio_pattern);
+
+		put<std::uint8_t>(out, chip8.audio_pitch);
+
+		std::memcpy(out, chip8.data, MEMORY_SIZE);
+		return true;
+	}
+
+	std::vector<std::uint8_t> serialize(const c_chip8& chip8)
+	{
+		std::vector<std::uint8_t> state(size(chip8));
+
+		if (!serialize(chip8, state.data()))
+			state.clear();
+
+		return state;
+	}
+
+	bool restore(c_chip8& chip8, const std::uint8_t* state, std::size_t length)
+	{
+		savestate_header_t header{};
+
+		if (length < sizeof(header))
+			return false;
+
+		std::memcpy(&header, state, sizeof(header));
+
+		if (header.magic != SAVESTATE_MAGIC || header.version != SAVESTATE_VERSION)
+		{
+			std::printf("SAVESTATE ERROR: not a version %u save state\n", SAVESTATE_VERSION);
+			return false;
+		}
+
+		if (header.memory_size != MEMORY_SIZE || header.size != size(chip8) || length < header.size)
+		{
+			std::printf("SAVESTATE ERROR: save state was made for a %u byte memory image\n", header.memory_size);
+			return false;
+		}
+
+		const std::uint8_t* in = state + sizeof(header);
+
+		c_register& regs = chip8.registers;
+
+		std::memcpy(regs.v, in, sizeof(regs.v));
+		in += sizeof(regs.v);
+
+		regs.i = get16(in);
+		regs.pc = get16(in);
+		regs.delay = get<std::uint8_t>(in);
+		regs.sound = get<std::uint8_t>(in);
+		regs.key_wait = get<std::uint8_t>(in) != 0;
+		regs.key_register = get<std::uint8_t>(in) & 0xF;
+
+		std::uint16_t depth = get16(in);
+		regs.sp = static_cast<std::uint8_t>(depth < STACK_DEPTH ? depth : STACK_DEPTH);
+
+		for (std::uint16_t& slot : regs.stack)
+		{
+			slot = get16(in);
+		}
+
+		std::uint16_t flags = get16(in);
+		chip8.framebuffer.hires = (flags & FLAG_HIRES) != 0;
+		chip8.halted = (flags & FLAG_HALTED) != 0;
+		regs.fault = static_cast<CPU_FAULT>(flags >> FLAG_FAULT_SHIFT);
+
+		std::memcpy(chip8.framebuffer.rows, in, sizeof(chip8.framebuffer.rows));
+		in += sizeof(chip8.framebuffer.rows);
+		chip8.framebuffer.dirty = true;
+
+		chip8.rng.set_state(get<std::uint64_t>(in));
+		chip8.keypad = get<std::uint16_t>(in);
+
+		std::uint32_t remainder = get<std::uint32_t>(in);
+		chip8.scheduler.set_phase(remainder, get<std::int64_t>(in));
+
+		std::uint8_t machine = get<std::uint8_t>(in);
+		chip8.framebuffer.plane_mask = get<std::uint8_t>(in) & ((1 << FRAMEBUFFER_PLANES) - 1);
+
+		std::memcpy(chip8.flags, in, sizeof(chip8.flags));
+		in += sizeof(chip8.flags);
+
+		std::memcpy(chip8.audio_pattern, in, sizeof(chip8.audio_pattern));
+		in += sizeof(chip8.audio_pattern);
+
+		chip8.audio_pitch = get<std::uint8_t>(in);
+
+		std::memcpy(chip8.data, in, header.memory_size);
+		chip8.memory_written(0, MEMORY_SIZE);
+
+		/* the restored memory may hold different code than what was decoded or compiled, set_machine drops both */
+		chip8.set_machine(machine <= MACHINE_XOCHIP ? static_cast<MACHINE>(machine) : MACHINE_CHIP8);
+		return true;
+	}
+
+	bool save_file(const c_chip8& chip8, const std::string& filename)
+	{
+		std::vector<std::uint8_t> state = serialize(chip8);
+
+		if (state.empty())
+			return false;
+
+		std::FILE* file = std::fopen(filename.c_str(), "wb");
+
+		if (file == nullptr)
+		{
+			std::printf("SAVESTATE ERROR: couldn't open %s for writing\n", filename.c_str());
+			return false;
+		}
+
+		bool written = std::fwrite(state.data(), 1, state.size(), file) == state.size();
+		std::fclose(file);
+		return written;
+	}
+
+	bool load_file(c_chip8& chip8, const std::string& filename)
+	{
+		std::FILE* file = std::fopen(filename.c_str(), "rb");
+
+		if (file == nullptr)
+		{
+			std::printf("SAVESTATE ERROR: couldn't open %s\n", filename.c_str());
+			return false;
+		}
+
+		std::vector<std::uint8_t> state(size(chip8));
+		std::size_t length = std::fread(state.data(), 1, state.size(), file);
+		std::fclose(file);
+
+		return restore(chip8, state.data(), length);
+	}
+}
+
+c_rewind::c_rewind(std::size_t capacity_frames, std::uint32_t keyframe_interval)
+	: capacity_frames(capacity_frames), keyframe_interval(keyframe_interval)
+{
+}
+
+void c_rewind::capture(const c_chip8& chip8)
+{
+	this->scratch.resize(savestate::size(chip8));
+
+	if (!savestate::serialize(chip8, this->scratch.data()))
+		return;
+
+	entry_t entry{};
+
+	if (this->previous.size() != this->scratch.size() || this->since_keyframe >= this->keyframe_interval)
+	{
+		entry.keyframe = true;
+		entry.payload = this->scratch;
+		this->since_keyframe = 0;
+	}
+	else
+	{
+		entry.keyframe = false;
+		entry.payload = encode_delta(this->previous, this->scratch);
+	}
+
+	this->since_keyframe++;
+	this->bytes += entry.payload.size();
+	this->entries.push_back(std::move(entry));
+	this->previous.swap(this->scratch);
+
+	this->evict();
+}
+
+void c_rewind::evict()
+{
+	while (this->entries.size() > this->capacity_frames)
+	{
+		this->bytes -= this->entries.front().payload.size();
+		this->entries.pop_front();
+
+		/* deltas whose keyframe is gone can't be rebuilt */
+		while (!this->entries.empty() && !this->entries.front().keyframe)
+		{
+			this->bytes -= this->entries.front().payload.size();
+			this->entries.pop_front();
+		}
+	}
+}
+
+bool c_rewind::rewind(c_chip8& chip8, std::size_t frames_back)
+{
+	if (frames_back >= this->entries.size())
+		return false;
+
+	std::size_t target = this->entries.size() - 1 - frames_back;
+	std::size_t keyframe = target;
+
+	while (!this->entries[keyframe].keyframe)
+	{
+		keyframe--;
+	}
+
+	std::vector<std::uint8_t> state = this->entries[keyframe].payload;
+
+	for (std::size_t i = keyframe + 1; i <= target; i++)
+	{
+		apply_delta(state, this->entries[i].payload);
+	}
+
+	if (!savestate::restore(chip8, state.data(), state.size()))
+		return false;
+
+	while (this->entries.size() > target + 1)
+	{
+		this->bytes -= this->entries.back().payload.size();
+		this->entries.pop_back();
+	}
+
+	this->since_keyframe = static_cast<std::uint32_t>(target - keyframe + 1);
+	this->previous = std::move(state);
+	return true;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <deque>
+
+class c_chip8;
+
+constexpr std::uint32_t SAVESTATE_MAGIC = 0x53533843; // "C8SS"
+constexpr std::uint16_t SAVESTATE_VERSION = 6;
+
+struct savestate_header_t
+{
+	std::uint32_t magic;
+	std::uint16_t version;
+	std::uint16_t reserved;
+	std::uint32_t memory_size;
+	std::uint32_t size;
+};
+
+/*
+*	a save state is a fixed-size little endian image of the machine:
+*	header, register file, stack depth and slots, display mode and rows,
+*	rng, keypad and scheduler carry, instruction set, plane mask, flag
+*	registers and audio pattern, memory.
+*	the size only depends on the memory size the emulator was built with,
+*	which is what lets the rewind buffer xor consecutive states against each other.
+*/
+namespace savestate
+{
+	std::size_t size(const c_chip8& chip8);
+
+	bool serialize(const c_chip8& chip8, std::uint8_t* out);
+	std::vector<std::uint8_t> serialize(const c_chip8& chip8);
+	bool restore(c_chip8& chip8, const std::uint8_t* state, std::size_t length);
+
+	bool save_file(const c_chip8& chip8, const std::string& filename);
+	bool load_file(c_chip8& chip8, const std::string& filename);
+}
+
+/*
+*	rewind history. every keyframe_interval frames a full state is kept, the
+*	frames in between are stored as the run-length encoded xor against the
+*	frame before them, which is mostly zeros.
+*/
+class c_rewind
+{
+public:
+	c_rewind(std::size_t capacity_frames, std::uint32_t keyframe_interval = 60);
+
+	/* call once per emulated frame */
+	void capture(const c_chip8& chip8);
+
+	/* restores the state frames_back captures ago, 0 being the latest, and drops everything newer */
+	bool rewind(c_chip8& chip8, std::size_t frames_back = 1);
+
+	std::size_t get_frames() const
+	{
+		return this->entries.size();
+	}
+
+	std::size_t get_bytes() const
+	{
+		return this->bytes;
+	}
+private:
+	struct entry_t
+	{
+		bool keyframe;
+		std::vector<std::uint8_t> payload;
+	};
+
+	void evict();
+
+	std::size_t capacity_frames{};
+	std::uint32_t keyframe_interval{};
+	std::uint32_t since_keyframe{};
+	std::size_t bytes{};
+
+	std::deque<entry_t> entries;
+
+	/* the last captured state, deltas are taken against it */
+	std::vector<std::uint8_t> previous;
+	std::vector<std::uint8_t> scratch;
+};
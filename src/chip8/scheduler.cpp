@@ -0,0 +1,114 @@
+#include "scheduler.hpp"
+#include "chip8.hpp"
+#include <thread>
+
+c_scheduler::c_scheduler(c_chip8& chip8)
+	: chip8(chip8), next_tick(clock::now())
+{
+}
+
+void c_scheduler::set_mode(SPEED_MODE mode)
+{
+	this->mode = mode;
+	this->next_tick = clock::now();
+}
+
+void c_scheduler::set_instructions_per_second(std::uint32_t instructions_per_second)
+{
+	this->instructions_per_second = instructions_per_second;
+	this->remainder = 0;
+}
+
+void c_scheduler::tick_timers()
+{
+	std::uint8_t& delay = this->chip8.registers.delay;
+	std::uint8_t& sound = this->chip8.registers.sound;
+
+	if (delay > 0)
+		delay--;
+
+	this->sounding = sound > 0;
+
+	if (sound > 0)
+		sound--;
+}
+
+std::uint64_t c_scheduler::tick()
+{
+	std::uint64_t executed = 0;
+
+	if (this->mode == SPEED_TURBO)
+	{
+		clock::time_point deadline = this->next_tick + FRAME_DURATION;
+
+		do
+		{
+			executed += this->chip8.run(INSTRUCTIONS_PER_SLICE);
+		} while (!this->chip8.halted && !this->chip8.registers.key_wait && !this->chip8.idle && clock::now() < deadline);
+
+		/* a machine waiting on the timers or a key can't get anywhere before the tick, sleep it out instead of spinning or ticking early */
+		if (this->chip8.idle || this->chip8.registers.key_wait)
+			this->sleep_until(deadline);
+	}
+	else
+	{
+		this->remainder += this->instructions_per_second;
+		this->balance += this->remainder / TIMER_HZ;
+		this->remainder %= TIMER_HZ;
+
+		if (this->balance > 0)
+		{
+			executed = this->chip8.run(static_cast<std::uint64_t>(this->balance));
+			this->balance -= static_cast<std::int64_t>(executed);
+		}
+
+		/* a halted machine will never pay its balance back, and one waiting on a key shouldn't burst once it gets it */
+		if (this->chip8.halted || this->chip8.registers.key_wait)
+			this->balance = 0;
+	}
+
+	this->tick_timers();
+	this->ticks++;
+	this->next_tick += FRAME_DURATION;
+
+	return executed;
+}
+
+void c_scheduler::wait()
+{
+	clock::time_point now = clock::now();
+
+	if (this->mode != SPEED_REALTIME)
+	{
+		/* keep the turbo deadline anchored to now so a slow frame doesn't trigger a burst of short ticks */
+		if (this->next_tick < now)
+			this->next_tick = now;
+
+		return;
+	}
+
+	if (this->next_tick <= now)
+	{
+		/* more than a tick behind, drop the backlog instead of fast forwarding through it */
+		if (now - this->next_tick > FRAME_DURATION)
+			this->next_tick = now;
+
+		return;
+	}
+
+	this->sleep_until(this->next_tick);
+}
+
+void c_scheduler::sleep_until(clock::time_point deadline)
+{
+	clock::time_point now = clock::now();
+
+	/* the os scheduler routinely oversleeps by a fraction of a millisecond, so wake early and yield the rest */
+	if (deadline > now && deadline - now > SLEEP_SLACK)
+		std::this_thread::sleep_until(deadline - SLEEP_SLACK);
+
+	while (clock::now() < deadline)
+	{
+		std::this_thread::yield();
+	}
+}
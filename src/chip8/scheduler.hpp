@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+
+class c_chip8;
+
+enum SPEED_MODE
+{
+	/* instructions_per_second, sleeping out the rest of every 60 hz tick */
+	SPEED_REALTIME,
+	/* instructions_per_second worth of work per tick but no sleeping, timers stay exact relative to the guest */
+	SPEED_FAST_FORWARD,
+	/* as many instructions as the host manages, timers still tick at 60 hz wall clock */
+	SPEED_TURBO
+};
+
+constexpr std::uint32_t DEFAULT_INSTRUCTIONS_PER_SECOND = 700;
+constexpr int TIMER_HZ = 60;
+
+/* a thread is woken this long before a deadline and yields away the remainder */
+constexpr std::chrono::microseconds SLEEP_SLACK{ 1000 };
+
+/*
+*	drives a machine in 60 hz ticks. each tick runs that tick's share of the
+*	instruction clock and then decrements the delay and sound timers.
+*/
+class c_scheduler
+{
+public:
+	using clock = std::chrono::steady_clock;
+
+	c_scheduler(c_chip8& chip8);
+
+	void set_mode(SPEED_MODE mode);
+	void set_instructions_per_second(std::uint32_t instructions_per_second);
+
+	SPEED_MODE get_mode() const
+	{
+		return this->mode;
+	}
+
+	std::uint32_t get_instructions_per_second() const
+	{
+		return this->instructions_per_second;
+	}
+
+	/* runs one tick and returns the instructions it executed */
+	std::uint64_t tick();
+
+	/* in realtime mode sleeps until the next tick is due, otherwise returns immediately */
+	void wait();
+
+	void tick_timers();
+
+	/* whether the sound timer was running during the last tick, it may have just run out */
+	bool get_sounding() const
+	{
+		return this->sounding;
+	}
+
+	std::uint64_t get_ticks() const
+	{
+		return this->ticks;
+	}
+
+	clock::time_point get_next_tick() const
+	{
+		return this->next_tick;
+	}
+
+	/* the instruction carry between ticks, part of the machine state as far as save states are concerned */
+	std::uint32_t get_remainder() const
+	{
+		return this->remainder;
+	}
+
+	std::int64_t get_balance() const
+	{
+		return this->balance;
+	}
+
+	void set_phase(std::uint32_t remainder, std::int64_t balance)
+	{
+		this->remainder = remainder;
+		this->balance = balance;
+	}
+private:
+	void sleep_until(clock::time_point deadline);
+
+	c_chip8& chip8;
+
+	SPEED_MODE mode = SPEED_REALTIME;
+	std::uint32_t instructions_per_second = DEFAULT_INSTRUCTIONS_PER_SECOND;
+
+	/* instructions_per_second rarely divides by 60, the remainder carries into the next tick */
+	std::uint32_t remainder{};
+
+	/* negative when an engine overshot its budget, e.g. a jit block that ran past the end of a tick */
+	std::int64_t balance{};
+
+	std::uint64_t ticks{};
+	bool sounding{};
+	clock::time_point next_tick{};
+};
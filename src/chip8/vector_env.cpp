@@ -0,0 +1,135 @@
+#include "vector_env.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	/* chunks per pool thread, enough for stealing to even out environments that end early */
+	constexpr std::size_t CHUNKS_PER_THREAD = 4;
+}
+
+c_vector_env::c_vector_env(const std::uint8_t* rom, std::size_t length, std::size_t count, env_observation_t* observations, const env_config_t& config)
+	: config(config), observations(observations), pool(config.threads)
+{
+	this->initial = std::make_unique<c_chip8>(rom, length);
+	this->initial->set_machine(config.machine);
+	this->initial->scheduler.set_mode(SPEED_FAST_FORWARD);
+	this->initial->scheduler.set_instructions_per_second(config.instructions_per_second);
+	this->rom_end = PROGRAM_START + this->initial->get_length();
+
+	this->machines.reserve(count);
+
+	for (std::size_t i = 0; i < count; i++)
+	{
+		this->machines.push_back(std::make_unique<c_chip8>(rom, length));
+	}
+
+	this->frames.assign(count, 0);
+	this->episodes.assign(count, 0);
+	this->finished.assign(count, ENV_RUNNING);
+
+	std::size_t chunk_count = std::min(count, this->pool.get_threads() * CHUNKS_PER_THREAD);
+
+	for (std::size_t i = 0; i < chunk_count; i++)
+	{
+		this->chunks.push_back({ count * i / chunk_count, count * (i + 1) / chunk_count, 0 });
+	}
+
+	this->reset_all();
+}
+
+std::uint64_t c_vector_env::step(const std::uint16_t* actions, std::uint32_t frames, std::uint8_t* done)
+{
+	this->actions = actions;
+	this->step_frames = frames;
+
+	for (chunk_t& chunk : this->chunks)
+	{
+		this->pool.submit([this, &chunk] { this->run_chunk(chunk); });
+	}
+
+	this->pool.wait();
+
+	std::uint64_t instructions = 0;
+
+	for (chunk_t& chunk : this->chunks)
+	{
+		instructions += chunk.instructions;
+	}
+
+	std::memcpy(done, this->finished.data(), this->finished.size());
+	return instructions;
+}
+
+void c_vector_env::run_chunk(chunk_t& chunk)
+{
+	chunk.instructions = 0;
+
+	for (std::size_t index = chunk.first; index < chunk.last; index++)
+	{
+		if (this->finished[index] != ENV_RUNNING)
+			continue;
+
+		this->machines[index]->set_keypad(this->actions[index]);
+		this->finished[index] = this->run_machine(index, chunk.instructions);
+		this->observe(index);
+	}
+}
+
+ENV_DONE c_vector_env::run_machine(std::size_t index, std::uint64_t& instructions)
+{
+	c_chip8& chip8 = *this->machines[index];
+
+	for (std::uint32_t frame = 0; frame < this->step_frames; frame++)
+	{
+		instructions += chip8.scheduler.tick();
+		this->frames[index]++;
+
+		if (chip8.halted)
+			return ENV_HALTED;
+
+		if (chip8.registers.pc < PROGRAM_START || chip8.registers.pc >= this->rom_end)
+			return ENV_PC_OUT_OF_ROM;
+
+		if (this->config.max_frames != 0 && this->frames[index] >= this->config.max_frames)
+			return ENV_WATCHDOG;
+	}
+
+	return ENV_RUNNING;
+}
+
+void c_vector_env::observe(std::size_t index)
+{
+	c_framebuffer& framebuffer = this->machines[index]->framebuffer;
+
+	if (!framebuffer.dirty)
+		return;
+
+	env_observation_t& observation = this->observations[index];
+
+	std::memcpy(observation.rows, framebuffer.rows, sizeof(observation.rows));
+	observation.hires = framebuffer.hires;
+	framebuffer.dirty = false;
+}
+
+void c_vector_env::reset(std::size_t index)
+{
+	c_chip8& chip8 = *this->machines[index];
+
+	chip8.fork_from(*this->initial);
+	chip8.rng.seed(this->config.seed + index + this->episodes[index] * this->machines.size());
+	chip8.framebuffer.dirty = true;
+
+	this->episodes[index]++;
+	this->frames[index] = 0;
+	this->finished[index] = ENV_RUNNING;
+	this->observe(index);
+}
+
+void c_vector_env::reset_all()
+{
+	for (std::size_t i = 0; i < this->machines.size(); i++)
+	{
+		this->reset(i);
+	}
+}
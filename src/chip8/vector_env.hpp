@@ -0,0 +1,115 @@
+#pragma once
+
+#include "chip8.hpp"
+#include "../util/thread_pool.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/* why an environment stopped, 0 while it is still running. looked at once at the end of every frame */
+enum ENV_DONE : std::uint8_t
+{
+	ENV_RUNNING,
+	/* 00FD or a cpu fault */
+	ENV_HALTED,
+	/* PC left the rom, which a correct program never does */
+	ENV_PC_OUT_OF_ROM,
+	/* the episode ran for max_frames frames */
+	ENV_WATCHDOG
+};
+
+/*
+*	one environment's framebuffer as the caller sees it, the same packed rows
+*	c_framebuffer keeps, bit 63 - (x & 63) of word[x >> 6] of rows[plane][y]
+*	is the pixel. only the top 32 rows and word[0] are used unless hires is set.
+*/
+struct env_observation_t
+{
+	framebuffer_row_t rows[FRAMEBUFFER_PLANES][HIRES_HEIGHT];
+	std::uint8_t hires;
+	std::uint8_t reserved[15];
+};
+
+struct env_config_t
+{
+	MACHINE machine = MACHINE_CHIP8;
+	std::uint32_t instructions_per_second = DEFAULT_INSTRUCTIONS_PER_SECOND;
+
+	/* environment n's first episode is seeded with seed + n, every reset moves it on by the number of environments */
+	std::uint64_t seed = 0;
+
+	/* frames an episode may run before it is ended as ENV_WATCHDOG, 0 for no limit */
+	std::uint64_t max_frames = 0;
+
+	/* 0 for one per hardware thread */
+	std::size_t threads = 0;
+};
+
+/*
+*	n machines on one rom, stepped together for an agent's training loop. a
+*	step hands every running environment its keypad for the next frames, runs
+*	them spread over a thread pool and blocks until all of them are through,
+*	so the caller never deals with threads.
+*
+*	observations go straight into the caller's array, one env_observation_t per
+*	environment, written by the worker that stepped it and only when the
+*	picture changed. nothing is allocated per step.
+*/
+class c_vector_env
+{
+public:
+	c_vector_env(const std::uint8_t* rom, std::size_t length, std::size_t count, env_observation_t* observations, const env_config_t& config = {});
+
+	std::size_t get_count() const
+	{
+		return this->machines.size();
+	}
+
+	/*
+	*	runs every environment that isn't done for frames frames, pressing
+	*	actions[n] on environment n, and returns the instructions they ran.
+	*	done[n] gets an ENV_DONE, an environment that is done stays put until reset.
+	*/
+	std::uint64_t step(const std::uint16_t* actions, std::uint32_t frames, std::uint8_t* done);
+
+	/* back to power on with a fresh seed, its observation is rewritten */
+	void reset(std::size_t index);
+	void reset_all();
+
+	/* the machine behind an environment, for saving it or reading more than the picture */
+	c_chip8& get_machine(std::size_t index)
+	{
+		return *this->machines[index];
+	}
+private:
+	/* the environments one pool task steps */
+	struct chunk_t
+	{
+		std::size_t first;
+		std::size_t last;
+		std::uint64_t instructions;
+	};
+
+	void run_chunk(chunk_t& chunk);
+	ENV_DONE run_machine(std::size_t index, std::uint64_t& instructions);
+	void observe(std::size_t index);
+
+	env_config_t config;
+	std::uint32_t rom_end{};
+
+	/* every reset is a fork of this one, which never runs */
+	std::unique_ptr<c_chip8> initial;
+	std::vector<std::unique_ptr<c_chip8>> machines;
+	std::vector<std::uint64_t> frames;
+	std::vector<std::uint64_t> episodes;
+	std::vector<std::uint8_t> finished;
+	env_observation_t* observations{};
+
+	std::vector<chunk_t> chunks;
+	c_thread_pool pool;
+
+	/* the arguments of the step in flight, read by the pool tasks */
+	const std::uint16_t* actions{};
+	std::uint32_t step_frames{};
+};
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+enum HOST_REG
+{
+	RAX,
+	RCX,
+	RDX,
+	RBX,
+	RSP,
+	RBP,
+	RSI,
+	RDI,
+	R8,
+	R9,
+	R10,
+	R11,
+	R12,
+	R13,
+	R14,
+	R15
+};
+
+enum ALU_OP
+{
+	ALU_ADD = 0x01,
+	ALU_OR = 0x09,
+	ALU_AND = 0x21,
+	ALU_SUB = 0x29,
+	ALU_XOR = 0x31,
+	ALU_CMP = 0x39,
+	ALU_MOV = 0x89
+};
+
+/* the /digit opcode extension of the 0x81 group, same order as the ALU_OP encodings */
+enum ALU_EXT
+{
+	EXT_ADD = 0,
+	EXT_OR = 1,
+	EXT_AND = 4,
+	EXT_SUB = 5,
+	EXT_XOR = 6,
+	EXT_CMP = 7
+};
+
+enum SHIFT_EXT
+{
+	EXT_SHL = 4,
+	EXT_SHR = 5
+};
+
+enum CONDITION
+{
+	CC_E = 0x4,
+	CC_NE = 0x5,
+	CC_BE = 0x6,
+	CC_A = 0x7
+};
+
+/*
+*	minimal x86-64 encoder for the handful of instruction forms the jit emits.
+*	every memory operand is [rbp + disp8], rbp always holds the guest register file.
+*/
+class c_emitter
+{
+public:
+	c_emitter(std::uint8_t* buffer, std::size_t capacity)
+		: buffer(buffer), capacity(capacity)
+	{
+	}
+
+	std::uint8_t* cursor()
+	{
+		return this->buffer + this->size;
+	}
+
+	std::size_t remaining() const
+	{
+		return this->capacity - this->size;
+	}
+
+	std::size_t position() const
+	{
+		return this->size;
+	}
+
+	void byte(std::uint8_t value)
+	{
+		this->buffer[this->size++] = value;
+	}
+
+	void imm16(std::uint16_t value)
+	{
+		this->byte(value & 0xFF);
+		this->byte(value >> 8);
+	}
+
+	void imm32(std::uint32_t value)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			this->byte(static_cast<std::uint8_t>(value >> (i * 8)));
+		}
+	}
+
+	void push(HOST_REG reg)
+	{
+		if (reg >= R8)
+			this->byte(0x41);
+
+		this->byte(0x50 + (reg & 7));
+	}
+
+	void pop(HOST_REG reg)
+	{
+		if (reg >= R8)
+			this->byte(0x41);
+
+		this->byte(0x58 + (reg & 7));
+	}
+
+	void ret()
+	{
+		this->byte(0xC3);
+	}
+
+	void mov_r64_r64(HOST_REG dst, HOST_REG src)
+	{
+		this->rex(true, src, dst);
+		this->byte(0x89);
+		this->modrm_rr(src, dst);
+	}
+
+	void movzx_r32_m8(HOST_REG dst, std::int8_t disp)
+	{
+		this->rex(false, dst, RBP);
+		this->byte(0x0F);
+		this->byte(0xB6);
+		this->modrm_disp8(dst, disp);
+	}
+
+	void movzx_r32_m16(HOST_REG dst, std::int8_t disp)
+	{
+		this->rex(false, dst, RBP);
+		this->byte(0x0F);
+		this->byte(0xB7);
+		this->modrm_disp8(dst, disp);
+	}
+
+	void mov_m8_r8(std::int8_t disp, HOST_REG src)
+	{
+		/* sil and dil are only reachable with a rex prefix */
+		this->rex(false, src, RBP, src >= RSP && src <= RDI);
+		this->byte(0x88);
+		this->modrm_disp8(src, disp);
+	}
+
+	void mov_m16_r16(std::int8_t disp, HOST_REG src)
+	{
+		this->byte(0x66);
+		this->rex(false, src, RBP);
+		this->byte(0x89);
+		this->modrm_disp8(src, disp);
+	}
+
+	void mov_m16_imm16(std::int8_t disp, std::uint16_t value)
+	{
+		this->byte(0x66);
+		this->byte(0xC7);
+		this->modrm_disp8(0, disp);
+		this->imm16(value);
+	}
+
+	void mov_r32_imm32(HOST_REG dst, std::uint32_t value)
+	{
+		this->rex(false, 0, dst);
+		this->byte(0xB8 + (dst & 7));
+		this->imm32(value);
+	}
+
+	void alu_r32_r32(ALU_OP op, HOST_REG dst, HOST_REG src)
+	{
+		this->rex(false, src, dst);
+		this->byte(op);
+		this->modrm_rr(src, dst);
+	}
+
+	void alu_r32_imm32(ALU_EXT ext, HOST_REG dst, std::uint32_t value)
+	{
+		this->rex(false, 0, dst);
+		this->byte(0x81);
+		this->modrm_rr(ext, dst);
+		this->imm32(value);
+	}
+
+	void shift_r32_1(SHIFT_EXT ext, HOST_REG dst)
+	{
+		this->rex(false, 0, dst);
+		this->byte(0xD1);
+		this->modrm_rr(ext, dst);
+	}
+
+	void setcc_r8(CONDITION cc, HOST_REG dst)
+	{
+		this->rex(false, 0, dst, dst >= RSP && dst <= RDI);
+		this->byte(0x0F);
+		this->byte(0x90 | cc);
+		this->modrm_rr(0, dst);
+	}
+
+	void cmovcc_r32_r32(CONDITION cc, HOST_REG dst, HOST_REG src)
+	{
+		this->rex(false, dst, src);
+		this->byte(0x0F);
+		this->byte(0x40 | cc);
+		this->modrm_rr(dst, src);
+	}
+
+	/* returns the offset of the rel8 byte for patch_rel8 */
+	std::size_t jcc_rel8(CONDITION cc)
+	{
+		this->byte(0x70 | cc);
+		this->byte(0x00);
+		return this->size - 1;
+	}
+
+	void patch_rel8(std::size_t at)
+	{
+		this->buffer[at] = static_cast<std::uint8_t>(this->size - (at + 1));
+	}
+private:
+	void rex(bool w, int reg, int rm, bool force = false)
+	{
+		std::uint8_t prefix = 0x40 | (w ? 0x08 : 0x00) | ((reg >> 3) << 2) | (rm >> 3);
+
+		if (prefix != 0x40 || force)
+			this->byte(prefix);
+	}
+
+	void modrm_rr(int reg, int rm)
+	{
+		this->byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+	}
+
+	void modrm_disp8(int reg, std::int8_t disp)
+	{
+		this->byte(0x40 | ((reg & 7) << 3) | (RBP & 7));
+		this->byte(static_cast<std::uint8_t>(disp));
+	}
+
+	std::uint8_t* buffer{};
+	std::size_t capacity{};
+	std::size_t size{};
+};
@@ -0,0 +1,576 @@
+#include "jit.hpp"
+#include "emitter.hpp"
+#include "../chip8/chip8.hpp"
+#include "../chip8/decoder.hpp"
+#include "../metrics/metrics.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define JIT_SUPPORTED 1
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+namespace
+{
+	/* host registers guest V registers get pinned to, rax/rcx/rdx stay free as scratch */
+	constexpr HOST_REG pool[] = { RBX, R12, R13, R14, R15, RSI, RDI, R8, R9, R10, R11 };
+	constexpr std::uint32_t POOL_SIZE = sizeof(pool) / sizeof(pool[0]);
+
+	/* registers a block saves, rsi and rdi are callee saved on win64 */
+	constexpr HOST_REG saved[] = { RBX, RBP, R12, R13, R14, R15, RSI, RDI };
+
+	/* the worst case a single guest instruction expands to, plus the fixed block overhead */
+	constexpr std::size_t MAX_BYTES_PER_INSTRUCTION = 48;
+	constexpr std::size_t MAX_BLOCK_OVERHEAD = 256;
+
+	enum INSTRUCTION_KIND
+	{
+		KIND_UNSUPPORTED,
+		KIND_SIMPLE,
+		KIND_TERMINATOR
+	};
+
+	INSTRUCTION_KIND classify(std::uint8_t handler)
+	{
+		switch (handler)
+		{
+			case OP_LDVXBYTE:
+			case OP_ADDVXBYTE:
+			case OP_LDVXVY:
+			case OP_ORVXVY:
+			case OP_ANDVXVY:
+			case OP_XORVXVY:
+			case OP_ADDVXVY:
+			case OP_SUBVXVY:
+			case OP_SHRVX:
+			case OP_SUBNVXVY:
+			case OP_SHLVX:
+			case OP_LDIADDR:
+			case OP_ADDIVX:
+			case OP_LDVXDT:
+			case OP_LDDTVX:
+			case OP_LDSTVX:
+				return KIND_SIMPLE;
+
+			case OP_JP:
+			case OP_SEVXBYTE:
+			case OP_SNEVXBYTE:
+			case OP_SEVXVY:
+			case OP_SNEVXVY:
+				return KIND_TERMINATOR;
+
+			default:
+				return KIND_UNSUPPORTED;
+		}
+	}
+
+	/* bitmask of the guest V registers an instruction reads or writes */
+	std::uint16_t registers_used(const decoded_instruction_t& entry)
+	{
+		std::uint16_t x = 1 << entry.x;
+		std::uint16_t y = 1 << entry.y;
+		std::uint16_t vf = 1 << REGISTERS::VF;
+
+		switch (entry.handler)
+		{
+			case OP_LDVXVY:
+			case OP_ORVXVY:
+			case OP_ANDVXVY:
+			case OP_XORVXVY:
+			case OP_SEVXVY:
+			case OP_SNEVXVY:
+				return x | y;
+
+			case OP_ADDVXVY:
+			case OP_SUBVXVY:
+			case OP_SUBNVXVY:
+				return x | y | vf;
+
+			case OP_SHRVX:
+			case OP_SHLVX:
+				return x | vf;
+
+			case OP_LDIADDR:
+			case OP_JP:
+				return 0;
+
+			default:
+				return x;
+		}
+	}
+
+	/* blocks address the register file through its base pointer, every field is within a disp8 of it */
+	std::int8_t disp(REGISTERS reg)
+	{
+		switch (reg)
+		{
+			case REGISTERS::VI:
+				return static_cast<std::int8_t>(offsetof(c_register, i));
+
+			case REGISTERS::V_DELAY:
+				return static_cast<std::int8_t>(offsetof(c_register, delay));
+
+			case REGISTERS::V_SOUND:
+				return static_cast<std::int8_t>(offsetof(c_register, sound));
+
+			case REGISTERS::VSP:
+				return static_cast<std::int8_t>(offsetof(c_register, sp));
+
+			case REGISTERS::PC:
+				return static_cast<std::int8_t>(offsetof(c_register, pc));
+
+			default:
+				return static_cast<std::int8_t>(offsetof(c_register, v) + reg);
+		}
+	}
+
+	int popcount(std::uint32_t value)
+	{
+		int count = 0;
+
+		for (; value != 0; value &= value - 1)
+		{
+			count++;
+		}
+
+		return count;
+	}
+}
+
+c_jit::c_jit(c_chip8& chip8)
+	: chip8(chip8)
+{
+	this->blocks.assign(MEMORY_SIZE, nullptr);
+	this->state.assign(MEMORY_SIZE, BLOCK_UNKNOWN);
+	this->covered.assign(MEMORY_SIZE, 0);
+	this->runs.assign(MEMORY_SIZE, 0);
+	this->handler_list.assign(MEMORY_SIZE, 0);
+
+#if JIT_SUPPORTED
+	#if defined(_WIN32)
+		void* memory = VirtualAlloc(nullptr, JIT_CODE_BYTES, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+	#else
+		void* memory = mmap(nullptr, JIT_CODE_BYTES, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (memory == MAP_FAILED)
+			memory = nullptr;
+	#endif
+
+	if (memory == nullptr)
+	{
+		std::printf("JIT ERROR: couldn't allocate executable memory, falling back to the interpreter\n");
+	}
+
+	this->code = static_cast<std::uint8_t*>(memory);
+#endif
+}
+
+c_jit::~c_jit()
+{
+	if (this->code == nullptr)
+		return;
+
+#if defined(_WIN32)
+	VirtualFree(this->code, 0, MEM_RELEASE);
+#else
+	munmap(this->code, JIT_CODE_BYTES);
+#endif
+}
+
+bool c_jit::supported()
+{
+	return JIT_SUPPORTED;
+}
+
+void c_jit::flush()
+{
+	/* the blocks are about to be forgotten, their counts go first */
+	this->collect();
+	this->handlers.clear();
+
+	std::fill(this->blocks.begin(), this->blocks.end(), nullptr);
+	std::fill(this->state.begin(), this->state.end(), BLOCK_UNKNOWN);
+	std::fill(this->covered.begin(), this->covered.end(), 0);
+	this->code_used = 0;
+}
+
+void c_jit::collect()
+{
+	if (this->chip8.metrics == nullptr)
+		return;
+
+	std::uint64_t* counts = this->chip8.metrics->handlers;
+
+	for (std::uint32_t pc = 0; pc < MEMORY_SIZE; pc++)
+	{
+		if (this->runs[pc] == 0)
+			continue;
+
+		const std::uint8_t* list = &this->handlers[this->handler_list[pc]];
+
+		for (std::uint8_t i = 1; i <= list[0]; i++)
+		{
+			counts[list[i]] += this->runs[pc];
+		}
+
+		this->runs[pc] = 0;
+	}
+}
+
+void c_jit::invalidate(std::uint32_t address, std::uint32_t count)
+{
+	/* self-modifying code is rare enough that dropping every block is cheaper than tracking them */
+	std::uint32_t last = std::min<std::uint32_t>(address + count, static_cast<std::uint32_t>(this->covered.size()));
+
+	for (std::uint32_t i = address; i < last; i++)
+	{
+		if (this->covered[i])
+		{
+			this->flush();
+			return;
+		}
+	}
+}
+
+std::uint64_t c_jit::execute(std::uint64_t budget)
+{
+	std::uint16_t& pc = this->chip8.registers.pc;
+	void* registers = &this->chip8.registers;
+	std::uint64_t executed = 0;
+	std::uint64_t* runs = this->chip8.metrics != nullptr && this->chip8.metrics->count_opcodes ? this->runs.data() : nullptr;
+
+	this->idle.reset();
+
+	while (executed < budget && !this->chip8.halted && !this->chip8.registers.key_wait)
+	{
+		if (pc > MEMORY_SIZE - 2)
+		{
+			this->chip8.halted = true;
+			break;
+		}
+
+		std::uint16_t start = pc;
+
+		if (this->state[pc] == BLOCK_UNKNOWN)
+			this->compile(pc);
+
+		if (this->state[pc] == BLOCK_COMPILED)
+		{
+			if (runs != nullptr)
+				runs[pc]++;
+
+			executed += this->blocks[pc](registers);
+		}
+		else
+			executed += this->chip8.execute(1);
+
+		/* skipped passes would go missing from the per block counts */
+		if (runs == nullptr && pc <= start && start - pc < IDLE_LOOP_BYTES)
+			executed += this->idle.check(this->chip8, start, executed, budget);
+	}
+
+	return executed;
+}
+
+std::uint16_t c_jit::skip_length(std::uint16_t address) const
+{
+	const std::uint8_t* data = this->chip8.data;
+
+	/* same rule as instructions::skip, F000 NNNN is skipped whole */
+	if (this->chip8.get_machine() == MACHINE_XOCHIP && data[address & MEMORY_MASK] == 0xF0 && data[(address + 1) & MEMORY_MASK] == 0x00)
+		return 4;
+
+	return 2;
+}
+
+void c_jit::compile(std::uint16_t start)
+{
+	this->state[start] = BLOCK_INTERPRET;
+
+	if (this->code == nullptr)
+		return;
+
+	const std::uint8_t* data = this->chip8.data;
+
+	decoded_instruction_t list[JIT_MAX_BLOCK_INSTRUCTIONS];
+	std::uint32_t count = 0;
+	std::uint16_t used = 0;
+	bool terminated = false;
+	std::uint32_t pc = start;
+
+	while (count < JIT_MAX_BLOCK_INSTRUCTIONS && pc + 1 < MEMORY_SIZE)
+	{
+		decoded_instruction_t entry = decoder::decode(static_cast<std::uint16_t>(data[pc] << 8) | data[pc + 1], this->chip8.get_machine());
+		INSTRUCTION_KIND kind = classify(entry.handler);
+
+		if (kind == KIND_UNSUPPORTED)
+			break;
+
+		std::uint16_t needs = used | registers_used(entry);
+
+		if (popcount(needs) > static_cast<int>(POOL_SIZE))
+			break;
+
+		used = needs;
+		list[count++] = entry;
+		pc += 2;
+
+		if (kind == KIND_TERMINATOR)
+		{
+			terminated = true;
+			break;
+		}
+	}
+
+	if (count == 0)
+		return;
+
+	if (MAX_BLOCK_OVERHEAD + count * MAX_BYTES_PER_INSTRUCTION > JIT_CODE_BYTES - this->code_used)
+	{
+		this->flush();
+		this->state[start] = BLOCK_INTERPRET;
+	}
+
+	HOST_REG host[16]{};
+	std::uint32_t pinned = 0;
+
+	for (int i = 0; i < 16; i++)
+	{
+		if (used & (1 << i))
+			host[i] = pool[pinned++];
+	}
+
+	c_emitter emit{ this->code + this->code_used, JIT_CODE_BYTES - this->code_used };
+	std::uint8_t* entry_point = emit.cursor();
+
+	for (HOST_REG reg : saved)
+	{
+		emit.push(reg);
+	}
+
+#if defined(_WIN32)
+	emit.mov_r64_r64(RBP, RCX);
+#else
+	emit.mov_r64_r64(RBP, RDI);
+#endif
+
+	for (int i = 0; i < 16; i++)
+	{
+		if (used & (1 << i))
+			emit.movzx_r32_m8(host[i], disp(static_cast<REGISTERS>(i)));
+	}
+
+	HOST_REG vf = host[REGISTERS::VF];
+
+	for (std::uint32_t i = 0; i < count; i++)
+	{
+		const decoded_instruction_t& entry = list[i];
+		std::uint16_t next = static_cast<std::uint16_t>(start + i * 2 + 2);
+		HOST_REG vx = host[entry.x];
+		HOST_REG vy = host[entry.y];
+
+		switch (entry.handler)
+		{
+			case OP_LDVXBYTE:
+			{
+				emit.mov_r32_imm32(vx, entry.imm);
+				break;
+			}
+
+			case OP_ADDVXBYTE:
+			{
+				emit.alu_r32_imm32(EXT_ADD, vx, entry.imm);
+				emit.alu_r32_imm32(EXT_AND, vx, 0xFF);
+				break;
+			}
+
+			case OP_LDVXVY:
+			{
+				emit.alu_r32_r32(ALU_MOV, vx, vy);
+				break;
+			}
+
+			case OP_ORVXVY:
+			{
+				emit.alu_r32_r32(ALU_OR, vx, vy);
+				break;
+			}
+
+			case OP_ANDVXVY:
+			{
+				emit.alu_r32_r32(ALU_AND, vx, vy);
+				break;
+			}
+
+			case OP_XORVXVY:
+			{
+				emit.alu_r32_r32(ALU_XOR, vx, vy);
+				break;
+			}
+
+			case OP_ADDVXVY:
+			{
+				/* like the interpreter, VF is only touched when the add carries */
+				emit.alu_r32_r32(ALU_MOV, RAX, vx);
+				emit.alu_r32_r32(ALU_ADD, RAX, vy);
+				emit.alu_r32_imm32(EXT_CMP, RAX, 0xFF);
+				std::size_t no_carry = emit.jcc_rel8(CC_BE);
+				emit.mov_r32_imm32(vf, 1);
+				emit.patch_rel8(no_carry);
+				emit.alu_r32_imm32(EXT_AND, RAX, 0xFF);
+				emit.alu_r32_r32(ALU_MOV, vx, RAX);
+				break;
+			}
+
+			case OP_SUBVXVY:
+			case OP_SUBNVXVY:
+			{
+				HOST_REG lhs = entry.handler == OP_SUBVXVY ? vx : vy;
+				HOST_REG rhs = entry.handler == OP_SUBVXVY ? vy : vx;
+
+				emit.alu_r32_r32(ALU_MOV, RAX, lhs);
+				emit.alu_r32_r32(ALU_XOR, RCX, RCX);
+				emit.alu_r32_r32(ALU_CMP, RAX, rhs);
+				emit.setcc_r8(CC_A, RCX);
+				emit.alu_r32_r32(ALU_SUB, RAX, rhs);
+				emit.alu_r32_imm32(EXT_AND, RAX, 0xFF);
+				emit.alu_r32_r32(ALU_MOV, vf, RCX);
+				emit.alu_r32_r32(ALU_MOV, vx, RAX);
+				break;
+			}
+
+			case OP_SHRVX:
+			{
+				/* VF is written before VX is shifted, exactly like the interpreter, so 8FF6 shifts the new VF */
+				emit.alu_r32_r32(ALU_MOV, RCX, vx);
+				emit.alu_r32_imm32(EXT_AND, RCX, 0x01);
+				emit.alu_r32_r32(ALU_MOV, vf, RCX);
+				emit.shift_r32_1(EXT_SHR, vx);
+				break;
+			}
+
+			case OP_SHLVX:
+			{
+				emit.alu_r32_r32(ALU_MOV, RCX, vx);
+				emit.alu_r32_imm32(EXT_AND, RCX, 0x80);
+				emit.alu_r32_r32(ALU_XOR, RDX, RDX);
+				emit.alu_r32_r32(ALU_CMP, RCX, RDX);
+				emit.setcc_r8(CC_NE, RDX);
+				emit.alu_r32_r32(ALU_MOV, vf, RDX);
+				emit.shift_r32_1(EXT_SHL, vx);
+				emit.alu_r32_imm32(EXT_AND, vx, 0xFF);
+				break;
+			}
+
+			case OP_LDIADDR:
+			{
+				emit.mov_m16_imm16(disp(REGISTERS::VI), entry.imm);
+				break;
+			}
+
+			case OP_ADDIVX:
+			{
+				emit.movzx_r32_m16(RAX, disp(REGISTERS::VI));
+				emit.alu_r32_r32(ALU_ADD, RAX, vx);
+				emit.mov_m16_r16(disp(REGISTERS::VI), RAX);
+				break;
+			}
+
+			case OP_LDVXDT:
+			{
+				emit.movzx_r32_m8(vx, disp(REGISTERS::V_DELAY));
+				break;
+			}
+
+			case OP_LDDTVX:
+			{
+				emit.mov_m8_r8(disp(REGISTERS::V_DELAY), vx);
+				break;
+			}
+
+			case OP_LDSTVX:
+			{
+				emit.mov_m8_r8(disp(REGISTERS::V_SOUND), vx);
+				break;
+			}
+
+			case OP_JP:
+			{
+				emit.mov_m16_imm16(disp(REGISTERS::PC), entry.imm);
+				break;
+			}
+
+			case OP_SEVXBYTE:
+			case OP_SNEVXBYTE:
+			case OP_SEVXVY:
+			case OP_SNEVXVY:
+			{
+				emit.mov_r32_imm32(RCX, next);
+				emit.mov_r32_imm32(RDX, static_cast<std::uint16_t>(next + skip_length(next)));
+
+				if (entry.handler == OP_SEVXBYTE || entry.handler == OP_SNEVXBYTE)
+					emit.alu_r32_imm32(EXT_CMP, vx, entry.imm);
+				else
+					emit.alu_r32_r32(ALU_CMP, vx, vy);
+
+				bool equal = entry.handler == OP_SEVXBYTE || entry.handler == OP_SEVXVY;
+				emit.cmovcc_r32_r32(equal ? CC_E : CC_NE, RCX, RDX);
+				emit.mov_m16_r16(disp(REGISTERS::PC), RCX);
+				break;
+			}
+
+			default:
+			{
+				break;
+			}
+		}
+	}
+
+	if (!terminated)
+		emit.mov_m16_imm16(disp(REGISTERS::PC), static_cast<std::uint16_t>(pc));
+
+	for (int i = 0; i < 16; i++)
+	{
+		if (used & (1 << i))
+			emit.mov_m8_r8(disp(static_cast<REGISTERS>(i)), host[i]);
+	}
+
+	emit.mov_r32_imm32(RAX, count);
+
+	for (int i = sizeof(saved) / sizeof(saved[0]) - 1; i >= 0; i--)
+	{
+		emit.pop(saved[i]);
+	}
+
+	emit.ret();
+
+	this->code_used += emit.position();
+	this->blocks[start] = reinterpret_cast<jit_block_t>(entry_point);
+	this->state[start] = BLOCK_COMPILED;
+
+	this->handler_list[start] = static_cast<std::uint32_t>(this->handlers.size());
+	this->handlers.push_back(static_cast<std::uint8_t>(count));
+
+	for (std::uint32_t i = 0; i < count; i++)
+	{
+		this->handlers.push_back(list[i].handler);
+	}
+
+	/* an xo-chip skip looked at the instruction after the block to see how far to skip */
+	std::uint32_t end = terminated && this->chip8.get_machine() == MACHINE_XOCHIP ? pc + 2 : pc;
+
+	for (std::uint32_t i = start; i < end && i < MEMORY_SIZE; i++)
+	{
+		this->covered[i] = 1;
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "../chip8/idle.hpp"
+
+class c_chip8;
+
+/* a compiled block takes the guest register file and returns how many guest instructions it retired */
+using jit_block_t = std::uint32_t(*)(void* registers);
+
+constexpr std::size_t JIT_CODE_BYTES = 4 * 1024 * 1024;
+constexpr std::uint32_t JIT_MAX_BLOCK_INSTRUCTIONS = 64;
+
+enum JIT_BLOCK_STATE : std::uint8_t
+{
+	BLOCK_UNKNOWN,
+	BLOCK_COMPILED,
+	BLOCK_INTERPRET
+};
+
+/*
+*	basic block recompiler for x86-64 hosts.
+*
+*	a block runs straight-line ALU, LD and timer instructions and ends at a
+*	JP or skip, which it compiles, or right before anything it can't compile
+*	(CALL, RET, JP V0, DRW, key and memory ops), which the interpreter then
+*	executes. the V registers a block touches are pinned in host registers
+*	for its whole length and written back on exit.
+*/
+class c_jit
+{
+public:
+	c_jit(c_chip8& chip8);
+	~c_jit();
+
+	static bool supported();
+
+	std::uint64_t execute(std::uint64_t budget);
+	void invalidate(std::uint32_t address, std::uint32_t count);
+	void flush();
+
+	/* adds the instructions compiled blocks retired since the last call to the machine's metrics */
+	void collect();
+private:
+	void compile(std::uint16_t start);
+
+	/* bytes a taken skip at address moves past */
+	std::uint16_t skip_length(std::uint16_t address) const;
+
+	c_chip8& chip8;
+	std::uint8_t* code{};
+	std::size_t code_used{};
+
+	/* indexed by guest address */
+	std::vector<jit_block_t> blocks;
+	std::vector<std::uint8_t> state;
+	std::vector<std::uint8_t> covered;
+
+	/*
+	*	a block always retires all of its instructions, so with metrics on it is
+	*	enough to count runs per block and multiply by its handlers in collect.
+	*	handlers holds, for every block, its length followed by its handlers.
+	*/
+	std::vector<std::uint64_t> runs;
+	std::vector<std::uint32_t> handler_list;
+	std::vector<std::uint8_t> handlers;
+
+	c_idle_loop idle{};
+};
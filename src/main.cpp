@@ -1,12 +1,205 @@
 #include "chip8/chip8.hpp"
+#include "ppu/display.hpp"
+#include "apu/apu.hpp"
+#include "chip8/savestate.hpp"
+#include "chip8/movie.hpp"
+#include "metrics/metrics.hpp"
 #include <string>
+#include <cstring>
+#include <filesystem>
+#include <cstdlib>
+#include <random>
 
-int main()
+int main(int argc, char** argv)
 {
 	std::string filename = "random.ch8";
-	c_chip8 chip8{ filename };
+	ENGINE engine = ENGINE_INTERPRETER;
+	SPEED_MODE mode = SPEED_REALTIME;
+	std::uint32_t instructions_per_second = DEFAULT_INSTRUCTIONS_PER_SECOND;
+	std::string trace_file{};
+	std::string load_state{};
+	std::string save_state{};
+	std::size_t rewind_seconds{};
+	std::string record_file{};
+	std::uint64_t seed = std::random_device{}();
+	bool seeded = false;
+	std::string keymap{};
+	MACHINE machine = MACHINE_CHIP8;
+	bool machine_given = false;
+	DISPLAY_BACKEND backend = DISPLAY_SDL;
+	std::string dump_prefix = "frame_";
+	display_options_t display_options{};
+	std::string metrics_sink{};
+	std::uint32_t metrics_interval = 1000;
+	bool metrics_opcodes = false;
+	bool mute = false;
+	std::uint32_t audio_latency = static_cast<std::uint32_t>(DEFAULT_AUDIO_LATENCY.count());
+
+	/*
+	*	usage: main [rom] [--jit | --aot] [--ips n] [--fast-forward | --turbo] [--trace file]
+	*	            [--load-state file] [--save-state file] [--rewind seconds]
+	*	            [--seed n] [--record movie] [--keymap keys] [--machine chip8 | schip | xochip]
+	*	            [--display sdl | null | terminal | ppm[:prefix]] [--scale n]
+	*	            [--filter sharp | scanlines | smooth] [--palette rrggbb,rrggbb,rrggbb,rrggbb]
+	*	            [--metrics file | unix:socket] [--metrics-interval ms] [--metrics-opcodes]
+	*	            [--mute] [--audio-latency ms]
+	*/
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--jit") == 0)
+			engine = ENGINE_JIT;
+		else if (std::strcmp(argv[i], "--aot") == 0)
+			engine = ENGINE_AOT;
+		else if (std::strcmp(argv[i], "--ips") == 0 && i + 1 < argc)
+			instructions_per_second = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else if (std::strcmp(argv[i], "--fast-forward") == 0)
+			mode = SPEED_FAST_FORWARD;
+		else if (std::strcmp(argv[i], "--turbo") == 0)
+			mode = SPEED_TURBO;
+		else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+			trace_file = argv[++i];
+		else if (std::strcmp(argv[i], "--load-state") == 0 && i + 1 < argc)
+			load_state = argv[++i];
+		else if (std::strcmp(argv[i], "--save-state") == 0 && i + 1 < argc)
+			save_state = argv[++i];
+		else if (std::strcmp(argv[i], "--rewind") == 0 && i + 1 < argc)
+			rewind_seconds = std::strtoul(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			seed = std::strtoull(argv[++i], nullptr, 10);
+			seeded = true;
+		}
+		else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+			record_file = argv[++i];
+		else if (std::strcmp(argv[i], "--keymap") == 0 && i + 1 < argc)
+			keymap = argv[++i];
+		else if (std::strcmp(argv[i], "--display") == 0 && i + 1 < argc)
+		{
+			std::string name = argv[++i];
+
+			if (name == "null")
+				backend = DISPLAY_NULL;
+			else if (name == "terminal")
+				backend = DISPLAY_TERMINAL;
+			else if (name.compare(0, 3, "ppm") == 0)
+			{
+				backend = DISPLAY_PPM;
+
+				if (name.size() > 4 && name[3] == ':')
+					dump_prefix = name.substr(4);
+			}
+			else
+				backend = DISPLAY_SDL;
+		}
+		else if (std::strcmp(argv[i], "--scale") == 0 && i + 1 < argc)
+			display_options.scale = static_cast<int>(std::strtoul(argv[++i], nullptr, 10));
+		else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+		{
+			if (!filter_from_name(argv[++i], display_options.filter))
+				std::printf("EMULATOR WARNING: unknown filter %s, keeping sharp\n", argv[i]);
+		}
+		else if (std::strcmp(argv[i], "--palette") == 0 && i + 1 < argc)
+		{
+			if (!palette_from_string(argv[++i], display_options.palette))
+				std::printf("EMULATOR WARNING: couldn't read palette %s, keeping the default\n", argv[i]);
+		}
+		else if (std::strcmp(argv[i], "--machine") == 0 && i + 1 < argc)
+		{
+			machine_given = machine_from_name(argv[++i], machine);
+
+			if (!machine_given)
+				std::printf("EMULATOR WARNING: unknown machine %s, going by the rom's extension\n", argv[i]);
+		}
+		else if (std::strcmp(argv[i], "--metrics") == 0 && i + 1 < argc)
+			metrics_sink = argv[++i];
+		else if (std::strcmp(argv[i], "--metrics-interval") == 0 && i + 1 < argc)
+			metrics_interval = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else if (std::strcmp(argv[i], "--metrics-opcodes") == 0)
+			metrics_opcodes = true;
+		else if (std::strcmp(argv[i], "--mute") == 0)
+			mute = true;
+		else if (std::strcmp(argv[i], "--audio-latency") == 0 && i + 1 < argc)
+			audio_latency = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else
+			filename = argv[i];
+	}
+
+	std::unique_ptr<c_display> display = create_display(backend, backend == DISPLAY_PPM ? dump_prefix : "Chip-8 Emulator by Graham", display_options);
+	c_chip8 chip8{ filename, display.get() };
+
+	/* only the interactive displays get sound, a headless run has nobody to hear it */
+	std::unique_ptr<c_apu> apu{};
+
+	if (!mute && (backend == DISPLAY_SDL || backend == DISPLAY_TERMINAL))
+	{
+		apu = std::make_unique<c_apu>(std::chrono::milliseconds(audio_latency));
+
+		if (apu->is_open())
+			chip8.apu = apu.get();
+	}
+
+	/* .sc8 and .xo8 roms pick their instruction set unless one was asked for */
+	if (!machine_given)
+		machine = machine_from_extension(std::filesystem::path(filename).extension().string());
+
+	chip8.set_machine(machine);
+	chip8.set_engine(engine);
+
+	if (!trace_file.empty())
+		chip8.set_trace_file(trace_file);
+
+	if (seeded)
+		chip8.rng.seed(seed);
+
+	if (!keymap.empty())
+		chip8.set_keymap(keymap);
+
+	if (!metrics_sink.empty())
+	{
+		chip8.metrics = std::make_unique<c_metrics>(metrics_sink, std::chrono::milliseconds(metrics_interval));
+
+		chip8.metrics->count_opcodes = metrics_opcodes;
+
+		if (!chip8.metrics->is_open())
+			chip8.metrics = nullptr;
+	}
+
+	if (!record_file.empty())
+	{
+		/* turbo runs however many instructions fit in a tick, which no replay could reproduce */
+		if (mode == SPEED_TURBO)
+		{
+			std::printf("EMULATOR WARNING: turbo can't be recorded, using fast forward\n");
+			mode = SPEED_FAST_FORWARD;
+		}
+
+		/* a movie starts at power on, a loaded state would be missing from it */
+		if (!load_state.empty())
+		{
+			std::printf("EMULATOR WARNING: ignoring --load-state while recording\n");
+			load_state.clear();
+		}
+
+		chip8.movie = std::make_unique<c_movie>();
+		chip8.movie->begin(chip8, seed, instructions_per_second, static_cast<std::uint8_t>(engine));
+	}
+
+	chip8.scheduler.set_mode(mode);
+	chip8.scheduler.set_instructions_per_second(instructions_per_second);
+
+	if (!load_state.empty())
+		savestate::load_file(chip8, load_state);
+
+	if (rewind_seconds != 0)
+		chip8.rewind = std::make_unique<c_rewind>(rewind_seconds * FRAMES_PER_SECOND);
 
 	chip8.emulate();
 
+	if (!save_state.empty())
+		savestate::save_file(chip8, save_state);
+
+	if (chip8.movie != nullptr)
+		chip8.movie->save(record_file);
+
 	return 0;
-}	
\ No newline at end of file
+}
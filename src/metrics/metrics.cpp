@@ -0,0 +1,346 @@
+#include "metrics.hpp"
+#include "../chip8/chip8.hpp"
+#include "../ppu/display.hpp"
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const char* CLASS_NAMES[CLASS_MAX] = { "flow", "skip", "alu", "memory", "timer", "draw", "input", "random", "invalid" };
+
+	void append_histogram(std::string& line, const char* name, const c_histogram& histogram)
+	{
+		char buffer[256];
+
+		std::snprintf(buffer, sizeof(buffer), ",\"%s\":{\"count\":%llu,\"min\":%llu,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu}", name,
+			static_cast<unsigned long long>(histogram.get_count()), static_cast<unsigned long long>(histogram.get_min()),
+			static_cast<unsigned long long>(histogram.percentile(0.5)), static_cast<unsigned long long>(histogram.percentile(0.9)),
+			static_cast<unsigned long long>(histogram.percentile(0.99)), static_cast<unsigned long long>(histogram.percentile(0.999)),
+			static_cast<unsigned long long>(histogram.get_max()));
+
+		line += buffer;
+	}
+}
+
+std::uint32_t c_histogram::index(std::uint64_t value)
+{
+	if (value < SUB_BUCKETS)
+		return static_cast<std::uint32_t>(value);
+
+	int top = std::bit_width(value) - 1;
+
+	if (top >= MAX_BITS)
+		return BUCKETS - 1;
+
+	std::uint32_t group = top - SUB_BITS + 1;
+	std::uint32_t sub = static_cast<std::uint32_t>(value >> (top - SUB_BITS)) - SUB_BUCKETS;
+	return group * SUB_BUCKETS + sub;
+}
+
+std::uint64_t c_histogram::upper_bound(std::uint32_t index)
+{
+	std::uint32_t group = index / SUB_BUCKETS;
+	std::uint32_t sub = index % SUB_BUCKETS;
+
+	if (group == 0)
+		return index;
+
+	std::uint64_t lower = static_cast<std::uint64_t>(SUB_BUCKETS + sub) << (group - 1);
+	return lower + (std::uint64_t{ 1 } << (group - 1)) - 1;
+}
+
+void c_histogram::record(std::uint64_t value)
+{
+	this->buckets[index(value)]++;
+
+	this->min = this->count == 0 ? value : std::min(this->min, value);
+	this->max = std::max(this->max, value);
+	this->count++;
+}
+
+void c_histogram::reset()
+{
+	std::fill(std::begin(this->buckets), std::end(this->buckets), 0);
+	this->count = 0;
+	this->min = 0;
+	this->max = 0;
+}
+
+std::uint64_t c_histogram::percentile(double fraction) const
+{
+	if (this->count == 0)
+		return 0;
+
+	std::uint64_t target = static_cast<std::uint64_t>(fraction * this->count);
+	std::uint64_t seen = 0;
+
+	if (target >= this->count)
+		target = this->count - 1;
+
+	for (std::uint32_t i = 0; i < BUCKETS; i++)
+	{
+		seen += this->buckets[i];
+
+		/* the bucket bound can overshoot what was actually recorded */
+		if (seen > target)
+			return std::min(upper_bound(i), this->max);
+	}
+
+	return this->max;
+}
+
+OPCODE_CLASS opcode_class(std::uint8_t handler)
+{
+	switch (handler)
+	{
+		case OP_RET:
+		case OP_JP:
+		case OP_CALL:
+		case OP_JPV0ADDR:
+		case OP_EXIT:
+			return CLASS_FLOW;
+
+		case OP_SEVXBYTE:
+		case OP_SNEVXBYTE:
+		case OP_SEVXVY:
+		case OP_SNEVXVY:
+		case OP_SKPVX:
+		case OP_SKNPVX:
+			return CLASS_SKIP;
+
+		case OP_LDVXBYTE:
+		case OP_ADDVXBYTE:
+		case OP_LDVXVY:
+		case OP_ORVXVY:
+		case OP_ANDVXVY:
+		case OP_XORVXVY:
+		case OP_ADDVXVY:
+		case OP_SUBVXVY:
+		case OP_SHRVX:
+		case OP_SUBNVXVY:
+		case OP_SHLVX:
+			return CLASS_ALU;
+
+		case OP_LDIADDR:
+		case OP_ADDIVX:
+		case OP_LDFVX:
+		case OP_LDBVX:
+		case OP_LDIARRAYFROMV0VX:
+		case OP_LDV0VXFROMIARRAY:
+		case OP_SAVEVXVY:
+		case OP_LOADVXVY:
+		case OP_LDILONG:
+		case OP_LDHFVX:
+		case OP_SAVEFLAGS:
+		case OP_LOADFLAGS:
+			return CLASS_MEMORY;
+
+		case OP_LDVXDT:
+		case OP_LDDTVX:
+		case OP_LDSTVX:
+		case OP_AUDIO:
+		case OP_PITCH:
+			return CLASS_TIMER;
+
+		case OP_CLS:
+		case OP_DRW:
+		case OP_SCD:
+		case OP_SCU:
+		case OP_SCR:
+		case OP_SCL:
+		case OP_LOW:
+		case OP_HIGH:
+		case OP_PLANE:
+			return CLASS_DRAW;
+
+		case OP_LDVXK:
+			return CLASS_INPUT;
+
+		case OP_RND:
+			return CLASS_RANDOM;
+
+		default:
+			return CLASS_INVALID;
+	}
+}
+
+c_metrics::c_metrics(const std::string& sink, std::chrono::milliseconds interval)
+	: interval(interval)
+{
+	if (sink.compare(0, 5, "unix:") == 0)
+	{
+#if defined(_WIN32)
+		std::printf("METRICS ERROR: unix sockets aren't supported on this platform, metrics disabled\n");
+#else
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+
+		std::string path = sink.substr(5);
+
+		if (path.size() >= sizeof(address.sun_path))
+		{
+			std::printf("METRICS ERROR: socket path %s is too long, metrics disabled\n", path.c_str());
+			return;
+		}
+
+		std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+		this->socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+		if (this->socket >= 0 && ::connect(this->socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+		{
+			::close(this->socket);
+			this->socket = -1;
+		}
+
+		if (this->socket < 0)
+			std::printf("METRICS ERROR: couldn't connect to %s, metrics disabled\n", path.c_str());
+#endif
+	}
+	else
+	{
+		this->file = std::fopen(sink.c_str(), "w");
+
+		if (this->file == nullptr)
+			std::printf("METRICS ERROR: couldn't open %s for writing, metrics disabled\n", sink.c_str());
+	}
+
+	this->started = clock::now();
+	this->last_dump = this->started;
+	this->next_dump = this->started + this->interval;
+}
+
+c_metrics::~c_metrics()
+{
+	if (this->file != nullptr)
+		std::fclose(this->file);
+
+#if !defined(_WIN32)
+	if (this->socket >= 0)
+		::close(this->socket);
+#endif
+}
+
+void c_metrics::dump(const c_chip8& chip8, clock::time_point now)
+{
+	double elapsed = std::chrono::duration<double>(now - this->started).count();
+	double seconds = std::chrono::duration<double>(now - this->last_dump).count();
+
+	std::uint64_t presented = chip8.display != nullptr ? chip8.display->get_frames_presented() : 0;
+	std::uint64_t skipped = chip8.display != nullptr ? chip8.display->get_frames_skipped() : 0;
+
+	/* instructions and ips are what actually ran, passes of idle loops retired without running go in idle_skipped */
+	std::uint64_t idle_skipped = std::min(chip8.idle_skipped - this->last_idle_skipped, this->instructions);
+	std::uint64_t ran = this->instructions - idle_skipped;
+
+	char buffer[512];
+
+	std::snprintf(buffer, sizeof(buffer), "{\"time\":%.3f,\"interval\":%.3f,\"instructions\":%llu,\"idle_skipped\":%llu,\"ips\":%.0f,\"ticks\":%llu,\"frames_presented\":%llu,\"frames_skipped\":%llu,\"frames_dropped\":%llu",
+		elapsed, seconds, static_cast<unsigned long long>(ran), static_cast<unsigned long long>(idle_skipped), seconds > 0.0 ? ran / seconds : 0.0,
+		static_cast<unsigned long long>(this->ticks), static_cast<unsigned long long>(presented - this->last_presented),
+		static_cast<unsigned long long>(skipped - this->last_skipped), static_cast<unsigned long long>(this->frames_dropped));
+
+	this->line = buffer;
+
+	if (this->count_opcodes)
+	{
+		std::uint64_t classes[CLASS_MAX]{};
+
+		for (int i = 0; i < OP_MAX; i++)
+		{
+			classes[opcode_class(static_cast<std::uint8_t>(i))] += this->handlers[i];
+		}
+
+		this->line += ",\"opcodes\":{";
+
+		for (int i = 0; i < CLASS_MAX; i++)
+		{
+			std::snprintf(buffer, sizeof(buffer), "%s\"%s\":%llu", i == 0 ? "" : ",", CLASS_NAMES[i], static_cast<unsigned long long>(classes[i]));
+			this->line += buffer;
+		}
+
+		this->line += "}";
+	}
+
+	append_histogram(this->line, "tick_ns", this->tick_time);
+	append_histogram(this->line, "present_ns", this->present_time);
+	this->line += "}\n";
+
+	this->write(this->line);
+
+	std::fill(std::begin(this->handlers), std::end(this->handlers), 0);
+	this->instructions = 0;
+	this->ticks = 0;
+	this->frames_dropped = 0;
+	this->tick_time.reset();
+	this->present_time.reset();
+	this->last_presented = presented;
+	this->last_skipped = skipped;
+	this->last_idle_skipped = chip8.idle_skipped;
+
+	this->last_dump = now;
+	this->next_dump = now + this->interval;
+}
+
+void c_metrics::write(const std::string& line)
+{
+	if (this->file != nullptr)
+	{
+		std::fwrite(line.data(), 1, line.size(), this->file);
+		std::fflush(this->file);
+		return;
+	}
+
+#if !defined(_WIN32)
+	if (this->socket < 0)
+		return;
+
+	/* the rest of a line a full socket cut short goes out first, the reader must only ever see whole lines */
+	if (!this->pending.empty())
+	{
+		this->send_pending();
+
+		/* a reader that stops draining mustn't stall emulation, whole lines are dropped instead */
+		if (!this->pending.empty())
+			return;
+	}
+
+	if (this->socket < 0)
+		return;
+
+	this->pending = line;
+
+	if (this->send_pending() == 0)
+		this->pending.clear();
+#endif
+}
+
+#if !defined(_WIN32)
+std::size_t c_metrics::send_pending()
+{
+	ssize_t sent = ::send(this->socket, this->pending.data(), this->pending.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+
+	if (sent < 0)
+	{
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+		{
+			std::printf("METRICS WARNING: the socket reader went away, metrics disabled\n");
+			::close(this->socket);
+			this->socket = -1;
+			this->pending.clear();
+		}
+
+		return 0;
+	}
+
+	this->pending.erase(0, static_cast<std::size_t>(sent));
+	return static_cast<std::size_t>(sent);
+}
+#endif
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "../chip8/decoder.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <chrono>
+#include <string>
+
+class c_chip8;
+
+/*
+*	log-linear latency histogram in the style of hdrhistogram. values below 32
+*	get a bucket each, above that every power of two is split into 32 equal
+*	buckets, so any recorded value is known to within about 3% at a fixed
+*	11 KB no matter the range.
+*/
+class c_histogram
+{
+public:
+	void record(std::uint64_t value);
+	void reset();
+
+	/* smallest bucket bound at or above the given fraction of samples, 0.5 for the median */
+	std::uint64_t percentile(double fraction) const;
+
+	std::uint64_t get_count() const
+	{
+		return this->count;
+	}
+
+	std::uint64_t get_min() const
+	{
+		return this->count != 0 ? this->min : 0;
+	}
+
+	std::uint64_t get_max() const
+	{
+		return this->max;
+	}
+private:
+	static constexpr int SUB_BITS = 5;
+	static constexpr std::uint32_t SUB_BUCKETS = 1 << SUB_BITS;
+
+	/* enough powers of two for a little over a day in nanoseconds, anything longer lands in the last bucket */
+	static constexpr int MAX_BITS = 47;
+	static constexpr std::uint32_t BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+	static std::uint32_t index(std::uint64_t value);
+	static std::uint64_t upper_bound(std::uint32_t index);
+
+	std::uint64_t buckets[BUCKETS]{};
+	std::uint64_t count{};
+	std::uint64_t min{};
+	std::uint64_t max{};
+};
+
+/* coarse groups the per-handler counts are reported in */
+enum OPCODE_CLASS
+{
+	CLASS_FLOW,
+	CLASS_SKIP,
+	CLASS_ALU,
+	CLASS_MEMORY,
+	CLASS_TIMER,
+	CLASS_DRAW,
+	CLASS_INPUT,
+	CLASS_RANDOM,
+	CLASS_INVALID,
+	CLASS_MAX
+};
+
+OPCODE_CLASS opcode_class(std::uint8_t handler);
+
+/*
+*	host side runtime counters for one machine. emulate counts instructions and
+*	ticks, times ticks and display frames, and on request the interpreter and
+*	the jit count retired instructions per handler. once per
+*	interval everything since the previous line is written out as one json
+*	object per line, to a file or, given unix:/path, to a listening unix socket.
+*/
+class c_metrics
+{
+public:
+	using clock = std::chrono::steady_clock;
+
+	c_metrics(const std::string& sink, std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+	~c_metrics();
+
+	c_metrics(const c_metrics&) = delete;
+	c_metrics& operator=(const c_metrics&) = delete;
+
+	bool is_open() const
+	{
+		return this->file != nullptr || this->socket >= 0;
+	}
+
+	bool due(clock::time_point now) const
+	{
+		return now >= this->next_dump;
+	}
+
+	/* writes the line for the interval ending now and starts the next one */
+	void dump(const c_chip8& chip8, clock::time_point now);
+
+	/*
+	*	retired instructions per handler, indexed by OP_. only kept with
+	*	count_opcodes set: a counter per instruction is close to free for
+	*	compiled blocks but costs the interpreter several percent.
+	*/
+	bool count_opcodes{};
+	std::uint64_t handlers[OP_MAX]{};
+
+	std::uint64_t instructions{};
+	std::uint64_t ticks{};
+
+	/* host frames the loop fell too far behind to run, realtime only */
+	std::uint64_t frames_dropped{};
+
+	/* nanoseconds to emulate one 60 hz tick and to hand one frame to the display, sampled once per host frame */
+	c_histogram tick_time{};
+	c_histogram present_time{};
+private:
+	void write(const std::string& line);
+
+	/* sends what it can of pending without blocking and returns how much that was */
+	std::size_t send_pending();
+
+	std::FILE* file{};
+	int socket = -1;
+
+	/* the tail of a line the socket only took part of */
+	std::string pending;
+
+	std::chrono::milliseconds interval{};
+	clock::time_point started{};
+	clock::time_point last_dump{};
+	clock::time_point next_dump{};
+
+	/* display totals at the last dump, the line reports the difference */
+	std::uint64_t last_presented{};
+	std::uint64_t last_skipped{};
+	std::uint64_t last_idle_skipped{};
+
+	std::string line;
+};
@@ -0,0 +1,184 @@
+#include "display.hpp"
+#include "ppu.hpp"
+#include <cstdlib>
+#include <cstring>
+
+bool palette_from_string(const std::string& text, std::uint32_t* palette)
+{
+	std::uint32_t colors[1 << FRAMEBUFFER_PLANES];
+	std::size_t position = 0;
+	std::size_t end = 0;
+	int count = 0;
+
+	std::memcpy(colors, palette, sizeof(colors));
+
+	while (end != std::string::npos)
+	{
+		/* a fifth color has nowhere to go */
+		if (count == (1 << FRAMEBUFFER_PLANES))
+			return false;
+
+		end = text.find(',', position);
+		std::string color = text.substr(position, end == std::string::npos ? std::string::npos : end - position);
+
+		if (!color.empty() && color[0] == '#')
+			color.erase(0, 1);
+
+		char* rest = nullptr;
+		unsigned long value = std::strtoul(color.c_str(), &rest, 16);
+
+		if (color.size() != 6 || *rest != '\0')
+			return false;
+
+		colors[count++] = 0xFF000000 | static_cast<std::uint32_t>(value);
+		position = end + 1;
+	}
+
+	std::memcpy(palette, colors, sizeof(colors));
+	return true;
+}
+
+c_ppm_display::c_ppm_display(const std::string& prefix, const std::uint32_t* palette)
+	: prefix(prefix)
+{
+	std::memcpy(this->palette, palette, sizeof(this->palette));
+}
+
+void c_ppm_display::present(const c_framebuffer& framebuffer)
+{
+	if (this->failed)
+		return;
+
+	int width = framebuffer.get_width();
+	int height = framebuffer.get_height();
+	char header[32];
+	int header_length = std::snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+
+	this->image.resize(static_cast<std::size_t>(width) * height * 3);
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			std::uint32_t color = this->palette[framebuffer.get_pixel(x, y)];
+			std::uint8_t* pixel = &this->image[(static_cast<std::size_t>(y) * width + x) * 3];
+
+			pixel[0] = static_cast<std::uint8_t>(color >> 16);
+			pixel[1] = static_cast<std::uint8_t>(color >> 8);
+			pixel[2] = static_cast<std::uint8_t>(color);
+		}
+	}
+
+	char number[32];
+	std::snprintf(number, sizeof(number), "%06llu.ppm", static_cast<unsigned long long>(this->frames_presented + this->frames_skipped));
+	std::string filename = this->prefix + number;
+
+	std::FILE* file = std::fopen(filename.c_str(), "wb");
+
+	if (file == nullptr)
+	{
+		/* one error is enough, a bad prefix would otherwise print every frame */
+		std::printf("DISPLAY ERROR: couldn't open %s for writing, no more frames will be dumped\n", filename.c_str());
+		this->failed = true;
+		return;
+	}
+
+	std::fwrite(header, 1, header_length, file);
+	std::fwrite(this->image.data(), 1, this->image.size(), file);
+	std::fclose(file);
+}
+
+c_terminal_display::c_terminal_display()
+{
+	/* clear the screen and hide the cursor */
+	std::fputs("\x1b[2J\x1b[?25l", stdout);
+	std::fflush(stdout);
+}
+
+c_terminal_display::~c_terminal_display()
+{
+	/* put the cursor back below the picture */
+	std::printf("\x1b[%d;1H\x1b[0m\x1b[?25h\n", this->lines + 1);
+	std::fflush(stdout);
+}
+
+void c_terminal_display::present(const c_framebuffer& framebuffer)
+{
+	/* upper half block, lower half block and full block in utf-8 */
+	static const char* glyphs[4] = { " ", "\xE2\x96\x80", "\xE2\x96\x84", "\xE2\x96\x88" };
+
+	int columns = framebuffer.get_width();
+	int lines = framebuffer.get_height() / 2;
+	bool redraw = columns != this->columns || lines != this->lines;
+
+	/* a mode switch changes every cell, start from a blank screen */
+	if (redraw)
+	{
+		this->columns = columns;
+		this->lines = lines;
+		this->cells.assign(static_cast<std::size_t>(columns) * lines, 0);
+		this->output = "\x1b[2J";
+	}
+	else
+	{
+		this->output.clear();
+	}
+
+	/* only cells that changed are written, jumping the cursor whenever the run of changes breaks */
+	bool cursor_in_place = false;
+
+	for (int line = 0; line < lines; line++)
+	{
+		for (int column = 0; column < columns; column++)
+		{
+			std::uint8_t cell = (framebuffer.get_pixel(column, line * 2) ? 1 : 0) | (framebuffer.get_pixel(column, line * 2 + 1) ? 2 : 0);
+			std::uint8_t& previous = this->cells[static_cast<std::size_t>(line) * columns + column];
+
+			if (cell == previous && !redraw)
+			{
+				cursor_in_place = false;
+				continue;
+			}
+
+			if (!cursor_in_place)
+			{
+				char position[24];
+				std::snprintf(position, sizeof(position), "\x1b[%d;%dH", line + 1, column + 1);
+				this->output += position;
+			}
+
+			this->output += glyphs[cell];
+			previous = cell;
+			cursor_in_place = true;
+		}
+
+		cursor_in_place = false;
+	}
+
+	if (!this->output.empty())
+	{
+		std::fwrite(this->output.data(), 1, this->output.size(), stdout);
+		std::fflush(stdout);
+	}
+}
+
+std::unique_ptr<c_display> create_display(DISPLAY_BACKEND backend, const std::string& argument, const display_options_t& options)
+{
+	switch (backend)
+	{
+		case DISPLAY_SDL:
+			return std::make_unique<c_ppu>(argument, options);
+
+		case DISPLAY_NULL:
+			return std::make_unique<c_null_display>();
+
+		case DISPLAY_PPM:
+			return std::make_unique<c_ppm_display>(argument, options.palette);
+
+		case DISPLAY_TERMINAL:
+			return std::make_unique<c_terminal_display>();
+
+		default:
+			return nullptr;
+	}
+}
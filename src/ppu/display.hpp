@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "framebuffer.hpp"
+#include "scaler.hpp"
+
+enum DISPLAY_BACKEND
+{
+	/* a window through SDL, the only backend that initializes SDL at all */
+	DISPLAY_SDL,
+	/* throws every frame away */
+	DISPLAY_NULL,
+	/* writes every changed frame to its own binary ppm file */
+	DISPLAY_PPM,
+	/* draws into an ansi terminal, two pixel rows per character cell */
+	DISPLAY_TERMINAL
+};
+
+/* argb per pixel color: unlit, plane 0, plane 1, both planes */
+constexpr std::uint32_t DISPLAY_PALETTE[1 << FRAMEBUFFER_PLANES] = { 0xFF000000, 0xFFFFFFFF, 0xFFAAAAAA, 0xFF555555 };
+
+/* how the image backends color frames, and how the sdl window scales them */
+struct display_options_t
+{
+	std::uint32_t palette[1 << FRAMEBUFFER_PLANES]{ DISPLAY_PALETTE[0], DISPLAY_PALETTE[1], DISPLAY_PALETTE[2], DISPLAY_PALETTE[3] };
+	SCALE_FILTER filter = SCALE_SHARP;
+
+	/* whole number scale of the window picture, 0 for the largest that fits */
+	int scale{};
+};
+
+/* rrggbb colors separated by commas in palette order, fewer than four keep the rest. false, changing nothing, if one doesn't parse */
+bool palette_from_string(const std::string& text, std::uint32_t* palette);
+
+/*
+*	consumes the emulator framebuffer once per 60 hz frame. frame() decides
+*	whether anything changed, backends only implement present().
+*/
+class c_display
+{
+public:
+	virtual ~c_display() = default;
+
+	/*
+	*	the framebuffer is only handed to present when DRW or CLS touched it
+	*	and the result differs from the frame presented last.
+	*/
+	virtual void frame(c_framebuffer& framebuffer)
+	{
+		if (!framebuffer.dirty)
+		{
+			this->frames_skipped++;
+			return;
+		}
+
+		framebuffer.dirty = false;
+
+		std::uint64_t hash = framebuffer.hash();
+
+		if (this->frames_presented != 0 && hash == this->presented_hash)
+		{
+			this->frames_skipped++;
+			return;
+		}
+
+		this->presented_hash = hash;
+		this->present(framebuffer);
+		this->frames_presented++;
+	}
+
+	std::uint64_t get_frames_presented() const
+	{
+		return this->frames_presented;
+	}
+
+	std::uint64_t get_frames_skipped() const
+	{
+		return this->frames_skipped;
+	}
+protected:
+	virtual void present(const c_framebuffer& framebuffer) = 0;
+
+	std::uint64_t presented_hash{};
+	std::uint64_t frames_presented{};
+	std::uint64_t frames_skipped{};
+};
+
+class c_null_display : public c_display
+{
+public:
+	/* not even the hash, a headless run pays nothing for having a display */
+	void frame(c_framebuffer& framebuffer) override
+	{
+		framebuffer.dirty = false;
+	}
+protected:
+	void present(const c_framebuffer&) override
+	{
+	}
+};
+
+class c_ppm_display : public c_display
+{
+public:
+	/* frames land in prefix000000.ppm, prefix000001.ppm, ... numbered by 60 hz frame so gaps keep their timing */
+	c_ppm_display(const std::string& prefix, const std::uint32_t* palette);
+protected:
+	void present(const c_framebuffer& framebuffer) override;
+private:
+	std::string prefix;
+	std::uint32_t palette[1 << FRAMEBUFFER_PLANES]{};
+	std::vector<std::uint8_t> image;
+	bool failed{};
+};
+
+class c_terminal_display : public c_display
+{
+public:
+	c_terminal_display();
+	~c_terminal_display() override;
+protected:
+	void present(const c_framebuffer& framebuffer) override;
+private:
+	/* what each character cell shows now, bit 0 the upper pixel and bit 1 the lower one */
+	std::vector<std::uint8_t> cells;
+	int columns{};
+	int lines{};
+	std::string output;
+};
+
+/* null on failure, argument is the file prefix for DISPLAY_PPM and the window title for DISPLAY_SDL */
+std::unique_ptr<c_display> create_display(DISPLAY_BACKEND backend, const std::string& argument, const display_options_t& options = {});
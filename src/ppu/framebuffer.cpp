@@ -0,0 +1,276 @@
+#include "framebuffer.hpp"
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FRAMEBUFFER_SSE2 1
+#endif
+
+namespace
+{
+	/* places bits, whose lowest bit is pixel x + width - 1, into a row of the given display width */
+	framebuffer_row_t make_mask(std::uint32_t bits, int width_bits, int x, int display_width)
+	{
+		framebuffer_row_t mask{};
+
+		/* distance from bit 0 of the 128-bit row to the sprite's rightmost pixel */
+		int shift = 128 - width_bits - x;
+
+		if (shift >= 64)
+		{
+			mask.word[0] = static_cast<std::uint64_t>(bits) << (shift - 64);
+		}
+		else if (shift > 0)
+		{
+			mask.word[0] = static_cast<std::uint64_t>(bits) >> (64 - shift);
+			mask.word[1] = static_cast<std::uint64_t>(bits) << shift;
+		}
+		else
+		{
+			/* pixels past the right edge are clipped */
+			mask.word[1] = static_cast<std::uint64_t>(bits) >> -shift;
+		}
+
+		if (display_width == LORES_WIDTH)
+			mask.word[1] = 0;
+
+		return mask;
+	}
+}
+
+void c_framebuffer::clear()
+{
+	for (int plane = 0; plane < FRAMEBUFFER_PLANES; plane++)
+	{
+		if (this->plane_mask & (1 << plane))
+			std::memset(this->rows[plane], 0, sizeof(this->rows[plane]));
+	}
+
+	this->dirty = true;
+	this->changes++;
+}
+
+void c_framebuffer::set_hires(bool hires)
+{
+	this->hires = hires;
+
+	std::memset(this->rows, 0, sizeof(this->rows));
+	this->dirty = true;
+	this->changes++;
+}
+
+bool c_framebuffer::draw(int plane, std::uint8_t x, std::uint8_t y, const std::uint16_t* sprite, std::uint8_t n, int width_bits)
+{
+	int width = this->get_width();
+	int height = this->get_height();
+
+	/* the start position wraps, the sprite itself is clipped at the edges */
+	int start_x = x % width;
+	int start_y = y % height;
+	int count = n;
+
+	if (start_y + count > height)
+		count = height - start_y;
+
+	this->dirty = true;
+	this->changes++;
+
+	alignas(32) framebuffer_row_t masks[16];
+
+	for (int i = 0; i < count; i++)
+	{
+		masks[i] = make_mask(sprite[i], width_bits, start_x, width);
+	}
+
+	framebuffer_row_t* row = &this->rows[plane][start_y];
+	int i = 0;
+
+#if defined(__AVX2__)
+	__m256i hits256 = _mm256_setzero_si256();
+
+	for (; i + 2 <= count; i += 2)
+	{
+		__m256i old_rows = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&row[i]));
+		__m256i sprite_rows = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&masks[i]));
+
+		hits256 = _mm256_or_si256(hits256, _mm256_and_si256(old_rows, sprite_rows));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(&row[i]), _mm256_xor_si256(old_rows, sprite_rows));
+	}
+
+	bool collision = !_mm256_testz_si256(hits256, hits256);
+#else
+	bool collision = false;
+#endif
+
+#if defined(FRAMEBUFFER_SSE2)
+	__m128i hits = _mm_setzero_si128();
+
+	for (; i < count; i++)
+	{
+		__m128i old_row = _mm_load_si128(reinterpret_cast<const __m128i*>(&row[i]));
+		__m128i sprite_row = _mm_load_si128(reinterpret_cast<const __m128i*>(&masks[i]));
+
+		hits = _mm_or_si128(hits, _mm_and_si128(old_row, sprite_row));
+		_mm_store_si128(reinterpret_cast<__m128i*>(&row[i]), _mm_xor_si128(old_row, sprite_row));
+	}
+
+	collision |= _mm_movemask_epi8(_mm_cmpeq_epi8(hits, _mm_setzero_si128())) != 0xFFFF;
+#else
+	std::uint64_t hits = 0;
+
+	for (; i < count; i++)
+	{
+		hits |= (row[i].word[0] & masks[i].word[0]) | (row[i].word[1] & masks[i].word[1]);
+		row[i].word[0] ^= masks[i].word[0];
+		row[i].word[1] ^= masks[i].word[1];
+	}
+
+	collision |= hits != 0;
+#endif
+
+	return collision;
+}
+
+void c_framebuffer::scroll_down(int n)
+{
+	int height = this->get_height();
+
+	if (n > height)
+		n = height;
+
+	for (int plane = 0; plane < FRAMEBUFFER_PLANES; plane++)
+	{
+		if (!(this->plane_mask & (1 << plane)))
+			continue;
+
+		/* rows are whole 128-bit lanes, a vertical scroll is one block move */
+		framebuffer_row_t* rows = this->rows[plane];
+		std::memmove(&rows[n], &rows[0], (height - n) * sizeof(framebuffer_row_t));
+		std::memset(&rows[0], 0, n * sizeof(framebuffer_row_t));
+	}
+
+	this->dirty = true;
+	this->changes++;
+}
+
+void c_framebuffer::scroll_up(int n)
+{
+	int height = this->get_height();
+
+	if (n > height)
+		n = height;
+
+	for (int plane = 0; plane < FRAMEBUFFER_PLANES; plane++)
+	{
+		if (!(this->plane_mask & (1 << plane)))
+			continue;
+
+		framebuffer_row_t* rows = this->rows[plane];
+		std::memmove(&rows[0], &rows[n], (height - n) * sizeof(framebuffer_row_t));
+		std::memset(&rows[height - n], 0, n * sizeof(framebuffer_row_t));
+	}
+
+	this->dirty = true;
+	this->changes++;
+}
+
+/*
+*	a horizontal scroll shifts every row as one 128-bit value. the bits that
+*	cross from one word into the other are shifted separately and moved over
+*	a whole lane, the same thing a shld/shrd pair does for two registers.
+*	AVX2 does two rows per instruction since its byte shifts stay per lane.
+*/
+void c_framebuffer::scroll_right()
+{
+	int height = this->get_height();
+
+	for (int plane = 0; plane < FRAMEBUFFER_PLANES; plane++)
+	{
+		if (!(this->plane_mask & (1 << plane)))
+			continue;
+
+		framebuffer_row_t* row = this->rows[plane];
+		int y = 0;
+
+#if defined(__AVX2__)
+		for (; y + 2 <= height; y += 2)
+		{
+			__m256i rows = _mm256_load_si256(reinterpret_cast<const __m256i*>(&row[y]));
+			__m256i carry = _mm256_slli_si256(_mm256_slli_epi64(rows, 60), 8);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(&row[y]), _mm256_or_si256(_mm256_srli_epi64(rows, 4), carry));
+		}
+#endif
+
+#if defined(FRAMEBUFFER_SSE2)
+		for (; y < height; y++)
+		{
+			__m128i value = _mm_load_si128(reinterpret_cast<const __m128i*>(&row[y]));
+			__m128i carry = _mm_slli_si128(_mm_slli_epi64(value, 60), 8);
+			_mm_store_si128(reinterpret_cast<__m128i*>(&row[y]), _mm_or_si128(_mm_srli_epi64(value, 4), carry));
+		}
+#else
+		for (; y < height; y++)
+		{
+			row[y].word[1] = (row[y].word[1] >> 4) | (row[y].word[0] << 60);
+			row[y].word[0] >>= 4;
+		}
+#endif
+
+		/* lores rows only have 64 pixels, whatever moved past them is off screen */
+		if (!this->hires)
+		{
+			for (y = 0; y < height; y++)
+			{
+				row[y].word[1] = 0;
+			}
+		}
+	}
+
+	this->dirty = true;
+	this->changes++;
+}
+
+void c_framebuffer::scroll_left()
+{
+	int height = this->get_height();
+
+	for (int plane = 0; plane < FRAMEBUFFER_PLANES; plane++)
+	{
+		if (!(this->plane_mask & (1 << plane)))
+			continue;
+
+		framebuffer_row_t* row = this->rows[plane];
+		int y = 0;
+
+#if defined(__AVX2__)
+		for (; y + 2 <= height; y += 2)
+		{
+			__m256i rows = _mm256_load_si256(reinterpret_cast<const __m256i*>(&row[y]));
+			__m256i carry = _mm256_srli_si256(_mm256_srli_epi64(rows, 60), 8);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(&row[y]), _mm256_or_si256(_mm256_slli_epi64(rows, 4), carry));
+		}
+#endif
+
+#if defined(FRAMEBUFFER_SSE2)
+		for (; y < height; y++)
+		{
+			__m128i value = _mm_load_si128(reinterpret_cast<const __m128i*>(&row[y]));
+			__m128i carry = _mm_srli_si128(_mm_srli_epi64(value, 60), 8);
+			_mm_store_si128(reinterpret_cast<__m128i*>(&row[y]), _mm_or_si128(_mm_slli_epi64(value, 4), carry));
+		}
+#else
+		for (; y < height; y++)
+		{
+			row[y].word[0] = (row[y].word[0] << 4) | (row[y].word[1] >> 60);
+			row[y].word[1] <<= 4;
+		}
+#endif
+	}
+
+	this->dirty = true;
+	this->changes++;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+
+constexpr int LORES_WIDTH = 64;
+constexpr int LORES_HEIGHT = 32;
+constexpr int HIRES_WIDTH = 128;
+constexpr int HIRES_HEIGHT = 64;
+
+/* xo-chip draws to two bitplanes, a pixel's color is its bit in each plane */
+constexpr int FRAMEBUFFER_PLANES = 2;
+
+/*
+*	one display row packed one bit per pixel. word[0] holds pixels 0-63 and
+*	word[1] pixels 64-127, most significant bit first, so a row is a single
+*	128-bit lane. lores mode only ever uses word[0].
+*/
+struct alignas(16) framebuffer_row_t
+{
+	std::uint64_t word[2];
+};
+
+class c_framebuffer
+{
+public:
+	/* clears the selected planes */
+	void clear();
+
+	/* switches between 64x32 and 128x64, which clears every plane */
+	void set_hires(bool hires);
+
+	/*
+	*	xors a sprite of n rows in at x, y on one plane and returns whether any
+	*	lit pixel was turned off. sprite rows are width bits wide, 8 or 16, with
+	*	the leftmost pixel in the highest used bit.
+	*/
+	bool draw(int plane, std::uint8_t x, std::uint8_t y, const std::uint16_t* sprite, std::uint8_t n, int width);
+
+	/* the selected planes move n rows down or up, or 4 pixels right or left, pixels pushed off the edge are lost */
+	void scroll_down(int n);
+	void scroll_up(int n);
+	void scroll_right();
+	void scroll_left();
+
+	/*
+	*	FNV-1a over the visible rows, used to skip presenting identical frames.
+	*	only lit rows of the second plane go in, so a frame that never used it
+	*	hashes the same as it did before there were planes.
+	*/
+	std::uint64_t hash() const
+	{
+		std::uint64_t hash = this->hires ? 0xCBF29CE484222325ull : 0x84222325CBF29CE4ull;
+
+		for (int y = 0; y < this->get_height(); y++)
+		{
+			hash = (hash ^ this->rows[0][y].word[0]) * 0x100000001B3ull;
+			hash = (hash ^ this->rows[0][y].word[1]) * 0x100000001B3ull;
+		}
+
+		for (int plane = 1; plane < FRAMEBUFFER_PLANES; plane++)
+		{
+			for (int y = 0; y < this->get_height(); y++)
+			{
+				if ((this->rows[plane][y].word[0] | this->rows[plane][y].word[1]) == 0)
+					continue;
+
+				hash = (hash ^ static_cast<std::uint64_t>(plane << 8 | y)) * 0x100000001B3ull;
+				hash = (hash ^ this->rows[plane][y].word[0]) * 0x100000001B3ull;
+				hash = (hash ^ this->rows[plane][y].word[1]) * 0x100000001B3ull;
+			}
+		}
+
+		return hash;
+	}
+
+	/* 0 for an unlit pixel, otherwise one bit per plane it is lit on */
+	std::uint8_t get_pixel(int x, int y) const
+	{
+		std::uint8_t color = 0;
+
+		for (int plane = 0; plane < FRAMEBUFFER_PLANES; plane++)
+		{
+			color |= ((this->rows[plane][y].word[x >> 6] >> (63 - (x & 63))) & 1) << plane;
+		}
+
+		return color;
+	}
+
+	int get_width() const
+	{
+		return this->hires ? HIRES_WIDTH : LORES_WIDTH;
+	}
+
+	int get_height() const
+	{
+		return this->hires ? HIRES_HEIGHT : LORES_HEIGHT;
+	}
+
+	bool hires{};
+
+	/* planes DRW, CLS and the scrolls act on, bit n for plane n. FN01 sets it */
+	std::uint8_t plane_mask = 1;
+
+	/* set by everything that changes pixels, cleared by whoever presents the frame */
+	bool dirty{};
+
+	/* counts the same changes and is never cleared, two equal counts mean no pixel was touched in between */
+	std::uint32_t changes{};
+	alignas(32) framebuffer_row_t rows[FRAMEBUFFER_PLANES][HIRES_HEIGHT]{};
+};
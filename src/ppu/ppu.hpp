@@ -4,37 +4,50 @@
 #include <string>
 #include <cstdint>
 #include <memory>
+#include "framebuffer.hpp"
+#include "display.hpp"
 
-constexpr int WINDOW_WIDTH = 600;
-constexpr int WINDOW_HEIGHT = 1200;
+/* the window opens at the display's 2:1 and can be resized, the picture is letterboxed to whatever size it ends up */
+constexpr int WINDOW_WIDTH = 1280;
+constexpr int WINDOW_HEIGHT = 640;
 
-class c_ppu
+/*
+*	the sdl display backend. sdl is only initialized once one of these is
+*	constructed, so a process that picks another backend never pays for it.
+*/
+class c_ppu : public c_display
 {
 public:
-	c_ppu(const std::string& name)
+	c_ppu(const std::string& name, const display_options_t& options)
+		: scaler(options.palette, options.filter, options.scale)
 	{
-		if (SDL_Init(SDL_INIT_EVERYTHING) < 0)
+		/* video brings the event subsystem up with it, which is all the input loop needs */
+		if (SDL_Init(SDL_INIT_VIDEO) < 0)
 		{
 			std::printf("FATAL ERROR SDL FAILED TO INITIALIZE\n");
 		}
 
-
-		SDL_Init(SDL_INIT_VIDEO);
-		SDL_CreateWindowAndRenderer(WINDOW_WIDTH, WINDOW_WIDTH, 0, &this->window, &this->renderer); 
+		SDL_CreateWindowAndRenderer(WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_RESIZABLE, &this->window, &this->renderer);
 		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
 		SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-		SDL_RenderSetScale(this->renderer, 10, 10);
 
 		if (this->window == nullptr)
 		{
 			std::printf("FATAL ERROR WINDOW FAILED TO BE CREATED\n");
 		}
+		else
+		{
+			SDL_SetWindowTitle(this->window, name.c_str());
+		}
 
 		this->draw_surface = SDL_GetWindowSurface(this->get_window_ptr());
 	}
 
-	~c_ppu()
+	~c_ppu() override
 	{
+		if (this->texture != nullptr)
+			SDL_DestroyTexture(this->texture);
+
 		if (this->window != nullptr)
 			SDL_DestroyWindow(this->window);
 
@@ -57,18 +70,66 @@ public:
 	{
 		return this->renderer;
 	}
+
+	/* a resized window is drawn again even if the frame didn't change, the old picture is gone or in the wrong place */
+	void frame(c_framebuffer& framebuffer) override
+	{
+		int width = 0;
+		int height = 0;
+
+		SDL_GetRendererOutputSize(this->renderer, &width, &height);
+
+		if (width == 0 || height == 0 || (width == this->scaler.get_width() && height == this->scaler.get_height()))
+		{
+			c_display::frame(framebuffer);
+			return;
+		}
+
+		framebuffer.dirty = false;
+		this->presented_hash = framebuffer.hash();
+		this->present(framebuffer);
+		this->frames_presented++;
+	}
+protected:
+	void present(const c_framebuffer& framebuffer) override
+	{
+		int width = 0;
+		int height = 0;
+
+		SDL_GetRendererOutputSize(this->renderer, &width, &height);
+
+		/* minimized, there is nothing to draw into */
+		if (width == 0 || height == 0)
+			return;
+
+		/* the picture is scaled in software into a texture the size of the window, which is copied 1:1 */
+		if (this->texture == nullptr || width != this->scaler.get_width() || height != this->scaler.get_height())
+		{
+			if (this->texture != nullptr)
+				SDL_DestroyTexture(this->texture);
+
+			this->scaler.resize(width, height);
+			this->texture = SDL_CreateTexture(this->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+		}
+
+		int count = 0;
+		int first = this->scaler.scale(framebuffer, count);
+
+		/* only the rows that changed go up to the texture */
+		if (count != 0)
+		{
+			SDL_Rect rows{ 0, first, width, count };
+			SDL_UpdateTexture(this->texture, &rows, this->scaler.get_pixels() + static_cast<std::size_t>(first) * width, width * sizeof(std::uint32_t));
+		}
+
+		SDL_RenderCopy(this->renderer, this->texture, nullptr, nullptr);
+		SDL_RenderPresent(this->renderer);
+	}
 private:
 	SDL_Window* window;
 	SDL_Renderer* renderer;
 	SDL_Surface* draw_surface;
-};
-
-static std::unique_ptr<c_ppu> ppu_ptr = std::make_unique<c_ppu>("Chip-8 Emulator by Graham");
 
-namespace utility
-{
-	void set_pixel(std::uint32_t x, std::uint32_t y, std::uint8_t bit_n)
-	{
-		std::uint8_t* pixel = (std::uint8_t*)ppu_ptr->get_draw_surface()->pixels + y * ppu_ptr->get_draw_surface()->pitch + x * 4;
-	}
-}
\ No newline at end of file
+	SDL_Texture* texture{};
+	c_scaler scaler;
+};
\ No newline at end of file
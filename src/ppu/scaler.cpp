@@ -0,0 +1,302 @@
+#include "scaler.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SCALER_SSE2 1
+#endif
+
+/* the tables index a nibble of each plane with one byte */
+static_assert(FRAMEBUFFER_PLANES == 2, "the scaler tables assume two planes");
+
+namespace
+{
+	/* a scanline is the same color at half brightness */
+	std::uint32_t darken(std::uint32_t color)
+	{
+		return (color & 0xFF000000) | (color >> 1 & 0x007F7F7F);
+	}
+
+	/* weight/256 of b and the rest of a, two channels per multiply */
+	std::uint32_t mix(std::uint32_t a, std::uint32_t b, std::uint32_t weight)
+	{
+		std::uint32_t rb = ((a & 0x00FF00FF) * (256 - weight) + (b & 0x00FF00FF) * weight) >> 8 & 0x00FF00FF;
+		std::uint32_t ag = ((a >> 8 & 0x00FF00FF) * (256 - weight) + (b >> 8 & 0x00FF00FF) * weight) & 0xFF00FF00;
+
+		return rb | ag;
+	}
+
+	/* length pixels of one color, rounded up to whole vectors */
+	void fill(std::uint32_t* out, std::uint32_t color, int length)
+	{
+#if defined(__AVX2__)
+		__m256i value = _mm256_set1_epi32(static_cast<int>(color));
+
+		for (int x = 0; x < length; x += 8)
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), value);
+#elif defined(SCALER_SSE2)
+		__m128i value = _mm_set1_epi32(static_cast<int>(color));
+
+		for (int x = 0; x < length; x += 4)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), value);
+#else
+		for (int x = 0; x < length; x++)
+			out[x] = color;
+#endif
+	}
+}
+
+c_scaler::c_scaler(const std::uint32_t* palette, SCALE_FILTER filter, int scale)
+	: filter(filter), fixed_scale(scale)
+{
+	for (int index = 0; index < 256; index++)
+	{
+		/* leftmost pixel in the highest bit of each nibble */
+		for (int i = 0; i < 4; i++)
+		{
+			int color = (index >> (3 - i) & 1) | (index >> (7 - i) & 1) << 1;
+
+			this->lut[0][index][i] = palette[color];
+			this->lut[1][index][i] = darken(palette[color]);
+		}
+	}
+}
+
+void c_scaler::resize(int width, int height)
+{
+	if (width == this->width && height == this->height)
+		return;
+
+	this->width = std::max(width, 0);
+	this->height = std::max(height, 0);
+	this->pixels.assign(static_cast<std::size_t>(this->width) * this->height, 0);
+	this->stale = true;
+}
+
+void c_scaler::layout(int source_width, int source_height)
+{
+	this->source_width = source_width;
+	this->source_height = source_height;
+
+	int factor = 1;
+
+	if (this->filter == SCALE_SMOOTH)
+	{
+		/* the largest picture of the same aspect, but never smaller than the framebuffer */
+		if (static_cast<long long>(this->width) * source_height >= static_cast<long long>(this->height) * source_width)
+		{
+			this->scaled_height = this->height;
+			this->scaled_width = this->height * source_width / source_height;
+		}
+		else
+		{
+			this->scaled_width = this->width;
+			this->scaled_height = this->width * source_height / source_width;
+		}
+
+		this->scaled_width = std::max(this->scaled_width, source_width);
+		this->scaled_height = std::max(this->scaled_height, source_height);
+	}
+	else
+	{
+		int fit = std::max(1, std::min(this->width / source_width, this->height / source_height));
+
+		factor = this->fixed_scale > 0 ? std::min(this->fixed_scale, fit) : fit;
+		this->scaled_width = source_width * factor;
+		this->scaled_height = source_height * factor;
+	}
+
+	/* a window smaller than the framebuffer shows its top left corner */
+	this->left = std::max(0, (this->width - this->scaled_width) / 2);
+	this->top = std::max(0, (this->height - this->scaled_height) / 2);
+
+	/*
+	*	output pixel x covers source_width/scaled_width of a source pixel from
+	*	x * source_width/scaled_width on. everything is kept in units of
+	*	1/scaled_width so a whole scale comes out as exact blocks with no mixing.
+	*/
+	this->spans.assign(source_width, span_t{});
+
+	int current = -1;
+
+	for (int x = 0; x < this->scaled_width; x++)
+	{
+		int from = x * source_width;
+		int i = from / this->scaled_width;
+		int boundary = (i + 1) * this->scaled_width;
+		int weight = from + source_width > boundary ? (from + source_width - boundary) * 256 / source_width : 0;
+		span_t& span = this->spans[i];
+
+		if (i != current)
+		{
+			span.start = static_cast<std::uint16_t>(x);
+			current = i;
+		}
+
+		if (weight != 0)
+			span.weight = static_cast<std::uint16_t>(weight);
+		else
+			span.length++;
+	}
+
+	this->lines.assign(this->scaled_height, line_t{});
+
+	/* a quarter of every block is scanline, at least one row once blocks are two rows tall */
+	int dark = this->filter == SCALE_SCANLINES && factor > 1 ? std::max(1, factor / 4) : 0;
+
+	for (int y = 0; y < this->scaled_height; y++)
+	{
+		int from = y * source_height;
+		int i = from / this->scaled_height;
+		int boundary = (i + 1) * this->scaled_height;
+		line_t& line = this->lines[y];
+
+		line.source = static_cast<std::uint16_t>(i);
+		line.weight = static_cast<std::uint16_t>(from + source_height > boundary ? (from + source_height - boundary) * 256 / source_height : 0);
+		line.dark = y % factor >= factor - dark;
+	}
+
+	this->scratch.assign(static_cast<std::size_t>(this->scaled_width) + SCALER_PADDING, 0);
+}
+
+void c_scaler::expand(const c_framebuffer& framebuffer, int y)
+{
+	const framebuffer_row_t& plane0 = framebuffer.rows[0][y];
+	const framebuffer_row_t& plane1 = framebuffer.rows[1][y];
+	bool scanlines = this->filter == SCALE_SCANLINES;
+
+	for (int x = 0; x < this->source_width; x += 4)
+	{
+		int shift = 60 - (x & 63);
+		int index = static_cast<int>(plane0.word[x >> 6] >> shift & 0xF) | static_cast<int>(plane1.word[x >> 6] >> shift & 0xF) << 4;
+
+		std::memcpy(&this->expanded[0][y][x], this->lut[0][index], sizeof(this->lut[0][index]));
+
+		if (scanlines)
+			std::memcpy(&this->expanded[1][y][x], this->lut[1][index], sizeof(this->lut[1][index]));
+	}
+}
+
+void c_scaler::stretch(const std::uint32_t* source)
+{
+	std::uint32_t* out = this->scratch.data();
+
+	/* each fill may run past its span, the spans after it are written later and cover that up */
+	for (int i = 0; i < this->source_width; i++)
+	{
+		const span_t& span = this->spans[i];
+
+		fill(out + span.start, source[i], span.length);
+
+		if (span.weight != 0)
+			out[span.start + span.length] = mix(source[i], source[i + 1], span.weight);
+	}
+}
+
+int c_scaler::scale(const c_framebuffer& framebuffer, int& count)
+{
+	count = 0;
+
+	if (this->width == 0 || this->height == 0)
+		return 0;
+
+	int source_width = framebuffer.get_width();
+	int source_height = framebuffer.get_height();
+
+	bool refilled = this->stale || source_width != this->source_width || source_height != this->source_height;
+
+	/* a new layout moves the bars too, everything is drawn again */
+	if (refilled)
+	{
+		this->layout(source_width, source_height);
+		std::fill(this->pixels.begin(), this->pixels.end(), this->lut[0][0][0]);
+		this->stale = true;
+	}
+
+	bool changed[HIRES_HEIGHT]{};
+
+	for (int y = 0; y < source_height; y++)
+	{
+		bool same = true;
+
+		for (int plane = 0; plane < FRAMEBUFFER_PLANES; plane++)
+		{
+			const framebuffer_row_t& row = framebuffer.rows[plane][y];
+			framebuffer_row_t& previous = this->previous[plane][y];
+
+			same &= row.word[0] == previous.word[0] && row.word[1] == previous.word[1];
+			previous = row;
+		}
+
+		if (same && !this->stale)
+			continue;
+
+		changed[y] = true;
+		this->expand(framebuffer, y);
+	}
+
+	this->stale = false;
+
+	int columns = std::min(this->scaled_width, this->width);
+	int rows = std::min(this->scaled_height, this->height);
+	int first = -1;
+	int last = -1;
+
+	for (int y = 0; y < rows; y++)
+	{
+		const line_t& line = this->lines[y];
+
+		if (!changed[line.source] && !(line.weight != 0 && changed[line.source + 1]))
+			continue;
+
+		std::uint32_t* out = &this->pixels[static_cast<std::size_t>(this->top + y) * this->width + this->left];
+		const line_t* above = y > 0 ? &this->lines[y - 1] : nullptr;
+
+		/* most rows repeat the one above, which was just redrawn from the same source */
+		if (above != nullptr && above->source == line.source && above->weight == line.weight && above->dark == line.dark)
+		{
+			std::memcpy(out, out - this->width, columns * sizeof(std::uint32_t));
+		}
+		else
+		{
+			const std::uint32_t* source = this->expanded[line.dark][line.source];
+
+			if (line.weight != 0)
+			{
+				const std::uint32_t* below = this->expanded[0][line.source + 1];
+
+				for (int x = 0; x < source_width; x++)
+				{
+					this->mixed[x] = mix(source[x], below[x], line.weight);
+				}
+
+				source = this->mixed;
+			}
+
+			this->stretch(source);
+			std::memcpy(out, this->scratch.data(), columns * sizeof(std::uint32_t));
+		}
+
+		if (first < 0)
+			first = y;
+
+		last = y;
+	}
+
+	if (refilled)
+	{
+		count = this->height;
+		return 0;
+	}
+
+	if (first < 0)
+		return 0;
+
+	count = last - first + 1;
+	return this->top + first;
+}
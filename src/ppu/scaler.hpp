@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "framebuffer.hpp"
+
+enum SCALE_FILTER
+{
+	/* every pixel a solid block, the scale a whole number */
+	SCALE_SHARP,
+	/* sharp with the bottom rows of every block at half brightness */
+	SCALE_SCANLINES,
+	/* fills the window at any scale, output pixels straddling two pixels mix them by how much of each they cover */
+	SCALE_SMOOTH
+};
+
+inline bool filter_from_name(const std::string& name, SCALE_FILTER& filter)
+{
+	if (name == "sharp")
+		filter = SCALE_SHARP;
+	else if (name == "scanlines")
+		filter = SCALE_SCANLINES;
+	else if (name == "smooth")
+		filter = SCALE_SMOOTH;
+	else
+		return false;
+
+	return true;
+}
+
+/* the row kernels store whole vectors, so they may write this many pixels past the end of a row */
+constexpr int SCALER_PADDING = 8;
+
+/*
+*	turns the packed framebuffer into argb pixels at window size. the picture
+*	keeps its aspect and sits centered, the bars around it are the unlit
+*	color. output rows whose framebuffer rows didn't change since the last
+*	call are left alone, so the pixels have to survive between calls.
+*/
+class c_scaler
+{
+public:
+	/* palette has a color per pixel value like DISPLAY_PALETTE. scale 0 picks the largest that fits, smooth ignores it */
+	c_scaler(const std::uint32_t* palette, SCALE_FILTER filter, int scale);
+
+	void resize(int width, int height);
+
+	/* returns the first output row written and sets count to how many follow it, 0 when the picture didn't change */
+	int scale(const c_framebuffer& framebuffer, int& count);
+
+	const std::uint32_t* get_pixels() const
+	{
+		return this->pixels.data();
+	}
+
+	int get_width() const
+	{
+		return this->width;
+	}
+
+	int get_height() const
+	{
+		return this->height;
+	}
+private:
+	/*
+	*	source pixel i fills length output pixels from start. with a weight,
+	*	the pixel after those mixes in weight/256 of pixel i + 1.
+	*/
+	struct span_t
+	{
+		std::uint16_t start;
+		std::uint16_t length;
+		std::uint16_t weight;
+	};
+
+	/* which source row an output row shows, mixed with the next one by weight/256, and whether it's a scanline */
+	struct line_t
+	{
+		std::uint16_t source;
+		std::uint16_t weight;
+		std::uint8_t dark;
+	};
+
+	void layout(int source_width, int source_height);
+
+	/* unpacks framebuffer row y into expanded, through the dark table too when there are scanlines */
+	void expand(const c_framebuffer& framebuffer, int y);
+
+	/* one output row of the picture into scratch */
+	void stretch(const std::uint32_t* source);
+
+	/* 4 pixels for every pair of nibbles, plane 0 in the low one. the second table is the scanline colors */
+	alignas(16) std::uint32_t lut[2][256][4]{};
+
+	SCALE_FILTER filter;
+	int fixed_scale;
+
+	int width{};
+	int height{};
+	std::vector<std::uint32_t> pixels;
+
+	int source_width{};
+	int source_height{};
+	int left{};
+	int top{};
+	int scaled_width{};
+	int scaled_height{};
+	std::vector<span_t> spans;
+	std::vector<line_t> lines;
+	std::vector<std::uint32_t> scratch;
+
+	/* every framebuffer row at one pixel per pixel, through both tables, and the mix of two of them */
+	alignas(16) std::uint32_t expanded[2][HIRES_HEIGHT][HIRES_WIDTH]{};
+	std::uint32_t mixed[HIRES_WIDTH]{};
+
+	/* the framebuffer as of the last call, and whether the output has to be redrawn whole anyway */
+	framebuffer_row_t previous[FRAMEBUFFER_PLANES][HIRES_HEIGHT]{};
+	bool stale = true;
+};
@@ -0,0 +1,253 @@
+#include "../chip8/chip8.hpp"
+#include "../chip8/pack.hpp"
+#include "../util/thread_pool.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+*	headless batch runner for regression testing rom collections.
+*
+*	usage: batch [options] rom|directory|@listfile|pack.c8pk ...
+*	    --frames n        60 hz frames to run each rom for (default 600)
+*	    --instructions n  stop after n instructions instead
+*	    --ips n           instruction clock, timers stay exact at any speed (default 700)
+*	    --timeout s       wall clock watchdog per rom in seconds (default 10)
+*	    --threads n       worker threads, 0 for one per core (default 0)
+*	    --jit             run on the jit instead of the interpreter
+*	    --aot             run the blocks recompile generated, for the roms that have them linked in
+*	    --seed n          rng seed every rom starts from, so hashes repeat across runs (default 0)
+*	    --machine name    chip8, schip or xochip for every rom, instead of going by extension or pack profile
+*
+*	every rom of a pack built with mkpack runs straight from the mapped file,
+*	which skips the open and read per rom that dominates with tiny roms.
+*
+*	prints one tab separated line per rom: path, final framebuffer hash,
+*	instructions retired, instructions per second and how the run ended. the
+*	rate only counts instructions that ran, not passes of idle loops skipped ahead.
+*/
+
+namespace
+{
+	struct batch_config_t
+	{
+		std::uint64_t frames = 600;
+		std::uint64_t instructions = 0;
+		std::uint32_t instructions_per_second = DEFAULT_INSTRUCTIONS_PER_SECOND;
+		double timeout = 10.0;
+		std::size_t threads = 0;
+		ENGINE engine = ENGINE_INTERPRETER;
+		std::uint64_t seed = 0;
+		bool force_machine = false;
+		MACHINE machine = MACHINE_CHIP8;
+	};
+
+	struct batch_result_t
+	{
+		std::uint64_t hash;
+		std::uint64_t instructions;
+		double seconds;
+		const char* status;
+
+		/* of instructions, the passes of idle loops retired without running */
+		std::uint64_t idle_skipped;
+	};
+
+	/* a rom to run, either a file or one inside a mapped pack */
+	struct batch_rom_t
+	{
+		std::string name;
+		const std::uint8_t* data;
+		std::size_t size;
+		MACHINE machine;
+	};
+
+	/* the watchdog is only looked at every this many frames to keep clock reads off the hot path */
+	constexpr std::uint64_t WATCHDOG_FRAMES = 64;
+
+	void collect(const std::string& argument, std::vector<batch_rom_t>& roms, std::vector<std::unique_ptr<c_rom_pack>>& packs)
+	{
+		if (!argument.empty() && argument[0] == '@')
+		{
+			std::ifstream list(argument.substr(1));
+			std::string line;
+
+			while (std::getline(list, line))
+			{
+				if (!line.empty())
+					roms.push_back({ line, nullptr, 0, machine_from_extension(std::filesystem::path(line).extension().string()) });
+			}
+
+			return;
+		}
+
+		std::error_code error;
+
+		if (std::filesystem::is_directory(argument, error))
+		{
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(argument, error))
+			{
+				std::string extension = entry.path().extension().string();
+
+				if (entry.is_regular_file() && (extension == ".ch8" || extension == ".sc8" || extension == ".xo8"))
+					roms.push_back({ entry.path().string(), nullptr, 0, machine_from_extension(extension) });
+			}
+
+			return;
+		}
+
+		if (std::filesystem::path(argument).extension() == ".c8pk")
+		{
+			std::unique_ptr<c_rom_pack> pack = std::make_unique<c_rom_pack>();
+
+			if (!pack->open(argument))
+				return;
+
+			for (std::size_t i = 0; i < pack->get_count(); i++)
+			{
+				const pack_entry_t& entry = pack->get_entry(i);
+				MACHINE machine = entry.profile <= MACHINE_XOCHIP ? static_cast<MACHINE>(entry.profile) : MACHINE_CHIP8;
+
+				roms.push_back({ pack->get_name(i), pack->get_rom(i), entry.size, machine });
+			}
+
+			packs.push_back(std::move(pack));
+			return;
+		}
+
+		roms.push_back({ argument, nullptr, 0, machine_from_extension(std::filesystem::path(argument).extension().string()) });
+	}
+
+	batch_result_t run_rom(const batch_rom_t& rom, const batch_config_t& config)
+	{
+		using clock = std::chrono::steady_clock;
+
+		batch_result_t result{ 0, 0, 0.0, "done", 0 };
+
+		c_chip8 chip8 = rom.data != nullptr ? c_chip8{ rom.data, rom.size } : c_chip8{ rom.name };
+		chip8.set_machine(config.force_machine ? config.machine : rom.machine);
+		chip8.set_engine(config.engine);
+		chip8.rng.seed(config.seed);
+		chip8.scheduler.set_mode(SPEED_FAST_FORWARD);
+		chip8.scheduler.set_instructions_per_second(config.instructions_per_second);
+
+		clock::time_point start = clock::now();
+
+		for (std::uint64_t frame = 0; ; frame++)
+		{
+			if (config.instructions == 0 && frame >= config.frames)
+				break;
+
+			if (config.instructions != 0 && result.instructions >= config.instructions)
+				break;
+
+			result.instructions += chip8.scheduler.tick();
+
+			if (chip8.halted)
+			{
+				result.status = "halted";
+				break;
+			}
+
+			/* nobody presses keys in a batch run, FX0A would wait forever */
+			if (chip8.registers.key_wait)
+			{
+				result.status = "key wait";
+				break;
+			}
+
+			if (frame % WATCHDOG_FRAMES == 0 && std::chrono::duration<double>(clock::now() - start).count() > config.timeout)
+			{
+				result.status = "timeout";
+				break;
+			}
+		}
+
+		result.seconds = std::chrono::duration<double>(clock::now() - start).count();
+		result.hash = chip8.framebuffer.hash();
+		result.idle_skipped = chip8.idle_skipped;
+		return result;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	batch_config_t config{};
+	std::vector<batch_rom_t> roms;
+
+	/* kept open until the end, the roms point into their mappings */
+	std::vector<std::unique_ptr<c_rom_pack>> packs;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			config.frames = std::strtoull(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--instructions") == 0 && i + 1 < argc)
+			config.instructions = std::strtoull(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--ips") == 0 && i + 1 < argc)
+			config.instructions_per_second = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else if (std::strcmp(argv[i], "--timeout") == 0 && i + 1 < argc)
+			config.timeout = std::strtod(argv[++i], nullptr);
+		else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			config.threads = std::strtoul(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--jit") == 0)
+			config.engine = ENGINE_JIT;
+		else if (std::strcmp(argv[i], "--aot") == 0)
+			config.engine = ENGINE_AOT;
+		else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			config.seed = std::strtoull(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--machine") == 0 && i + 1 < argc)
+		{
+			config.force_machine = machine_from_name(argv[++i], config.machine);
+
+			if (!config.force_machine)
+				std::printf("BATCH WARNING: unknown machine %s, going by extension\n", argv[i]);
+		}
+		else
+			collect(argv[i], roms, packs);
+	}
+
+	if (roms.empty())
+	{
+		std::printf("usage: batch [--frames n | --instructions n] [--ips n] [--timeout s] [--threads n] [--jit | --aot] [--seed n] [--machine name] rom|directory|@listfile|pack.c8pk ...\n");
+		return 1;
+	}
+
+	std::vector<batch_result_t> results(roms.size());
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	{
+		c_thread_pool pool{ config.threads };
+
+		for (std::size_t i = 0; i < roms.size(); i++)
+		{
+			pool.submit([&, i] { results[i] = run_rom(roms[i], config); });
+		}
+
+		pool.wait();
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::uint64_t total = 0;
+	std::uint64_t ran = 0;
+
+	for (std::size_t i = 0; i < roms.size(); i++)
+	{
+		const batch_result_t& result = results[i];
+		double ips = result.seconds > 0.0 ? (result.instructions - result.idle_skipped) / result.seconds : 0.0;
+
+		std::printf("%s\t%016llx\t%llu\t%.0f\t%s\n", roms[i].name.c_str(), static_cast<unsigned long long>(result.hash), static_cast<unsigned long long>(result.instructions), ips, result.status);
+		total += result.instructions;
+		ran += result.instructions - result.idle_skipped;
+	}
+
+	std::printf("# %zu roms, %llu instructions, %llu of them skipped in idle loops, in %.3f s, %.0f aggregate ips\n", roms.size(), static_cast<unsigned long long>(total),
+		static_cast<unsigned long long>(total - ran), seconds, seconds > 0.0 ? ran / seconds : 0.0);
+	return 0;
+}
@@ -0,0 +1,543 @@
+#include "../chip8/chip8.hpp"
+#include "../chip8/instructions.hpp"
+#include "../chip8/lockstep.hpp"
+#include "../chip8/fork.hpp"
+#include "../chip8/vector_env.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+/*
+*	benchmark suite. times every handler in instructions.hpp on its own and
+*	the bundled roms end to end on each engine, then writes the results as json.
+*
+*	usage: bench [--samples n] [--rom-dir path] [--output file] [--lanes n] [--verify]
+*
+*	the lockstep engine runs --lanes copies of each rom at once (default 256),
+*	its ns per instruction is per instruction of any lane.
+*
+*	the env engine steps --lanes environments a frame at a time on every core,
+*	its ns per instruction is wall time over the instructions of all of them.
+*
+*	each rom is also forked from a state part way in, the fork results are ns
+*	per fork counting the few instructions every child runs before it is recycled.
+*
+*	--verify times nothing. it runs --lanes lockstep lanes of every bundled rom
+*	on each machine next to one c_chip8 per lane, with a seed and keypad of its
+*	own, compares them after every tick and exits with 1 on the first difference.
+*
+*	handler results are ns per call, rom results are ns per guest instruction
+*	that actually ran, passes of idle loops skipped ahead don't count. each with the min, median and p99 over all samples.
+*/
+
+namespace
+{
+	using clock = std::chrono::steady_clock;
+
+	constexpr std::uint32_t HANDLER_ITERATIONS = 10000;
+	constexpr std::uint64_t ROM_INSTRUCTIONS_PER_SAMPLE = 1000000;
+	constexpr std::uint32_t ROM_IPS = 100000000;
+
+	/* lockstep steps between timer ticks, every lane retires one instruction per step */
+	constexpr std::uint64_t LOCKSTEP_STEPS_PER_TICK = 1000;
+
+	/* --verify ticks per rom, short enough between ticks that keypad changes land all over the program */
+	constexpr std::uint64_t VERIFY_TICKS = 600;
+	constexpr std::uint64_t VERIFY_STEPS_PER_TICK = 100;
+
+	/* the env engine's clock, a thousand instructions per environment per frame */
+	constexpr std::uint32_t ENV_IPS = 60000;
+
+	/* how far into a rom the forks are taken from, and how far each child runs */
+	constexpr std::uint64_t FORK_WARMUP_INSTRUCTIONS = 100000;
+	constexpr std::uint64_t FORK_CHILD_INSTRUCTIONS = 16;
+
+	const char* bundled_roms[] = { "pong.ch8", "Cave.ch8", "Airplane.ch8", "MINIMALGAME.ch8", "test_opcode.ch8" };
+
+	struct stats_t
+	{
+		double min;
+		double median;
+		double p99;
+	};
+
+	struct result_t
+	{
+		std::string name;
+		std::string engine;
+		stats_t stats;
+	};
+
+	stats_t summarize(std::vector<double>& samples)
+	{
+		std::sort(samples.begin(), samples.end());
+
+		std::size_t p99 = (samples.size() * 99) / 100;
+
+		if (p99 >= samples.size())
+			p99 = samples.size() - 1;
+
+		return { samples.front(), samples[samples.size() / 2], samples[p99] };
+	}
+
+	/* keeps the optimizer from folding the handler's register writes across iterations */
+	inline void clobber()
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" ::: "memory");
+#else
+		_ReadWriteBarrier();
+#endif
+	}
+
+	/* body gets the iteration index so it can vary its operands */
+	template<typename F>
+	stats_t measure(std::uint32_t samples, F&& body)
+	{
+		std::vector<double> times;
+
+		for (std::uint32_t s = 0; s < samples; s++)
+		{
+			clock::time_point start = clock::now();
+
+			for (std::uint32_t i = 0; i < HANDLER_ITERATIONS; i++)
+			{
+				body(i);
+				clobber();
+			}
+
+			times.push_back(std::chrono::duration<double, std::nano>(clock::now() - start).count() / HANDLER_ITERATIONS);
+		}
+
+		return summarize(times);
+	}
+
+	void bench_handlers(c_chip8& chip8, std::uint32_t samples, std::vector<result_t>& results)
+	{
+		c_register& regs = chip8.registers;
+		std::uint8_t* data = chip8.data;
+		std::uint8_t& vx = regs.v[1];
+		std::uint8_t& vy = regs.v[2];
+		std::uint16_t& pc = regs.pc;
+		std::uint16_t& i_reg = regs.i;
+
+		auto add = [&](const char* name, stats_t stats)
+		{
+			results.push_back({ name, "handler", stats });
+		};
+
+		add("ld_byte", measure(samples, [&](std::uint32_t i) { instructions::ld_byte(vx, static_cast<std::uint8_t>(i)); }));
+		add("add_byte", measure(samples, [&](std::uint32_t i) { instructions::add_byte(vx, static_cast<std::uint8_t>(i)); }));
+		add("ld_registers", measure(samples, [&](std::uint32_t i) { vy = static_cast<std::uint8_t>(i); instructions::ld_registers(vx, vy); }));
+		add("or_registers", measure(samples, [&](std::uint32_t i) { vy = static_cast<std::uint8_t>(i); instructions::or_registers(vx, vy); }));
+		add("and_registers", measure(samples, [&](std::uint32_t i) { vy = static_cast<std::uint8_t>(i); instructions::and_registers(vx, vy); }));
+		add("xor_registers", measure(samples, [&](std::uint32_t i) { vy = static_cast<std::uint8_t>(i); instructions::xor_registers(vx, vy); }));
+		add("add_registers", measure(samples, [&](std::uint32_t i) { vy = static_cast<std::uint8_t>(i); instructions::add_registers(chip8, vx, vy); }));
+		add("sub_registers", measure(samples, [&](std::uint32_t i) { vy = static_cast<std::uint8_t>(i); instructions::sub_registers(chip8, vx, vy); }));
+		add("subn_registers", measure(samples, [&](std::uint32_t i) { vy = static_cast<std::uint8_t>(i); instructions::subn_registers(chip8, vx, vy); }));
+		add("shr", measure(samples, [&](std::uint32_t i) { vx = static_cast<std::uint8_t>(i); instructions::shr(chip8, vx); }));
+		add("shl", measure(samples, [&](std::uint32_t i) { vx = static_cast<std::uint8_t>(i); instructions::shl(chip8, vx); }));
+
+		add("se", measure(samples, [&](std::uint32_t i) { pc = 0; instructions::se(chip8, vx, static_cast<std::uint8_t>(i)); }));
+		add("sne", measure(samples, [&](std::uint32_t i) { pc = 0; instructions::sne(chip8, vx, static_cast<std::uint8_t>(i)); }));
+		add("se_registers", measure(samples, [&](std::uint32_t i) { pc = 0; vy = static_cast<std::uint8_t>(i); instructions::se_registers(chip8, vx, vy); }));
+		add("sne_register", measure(samples, [&](std::uint32_t i) { pc = 0; vy = static_cast<std::uint8_t>(i); instructions::sne_register(chip8, vx, vy); }));
+
+		add("jmp", measure(samples, [&](std::uint32_t i) { instructions::jmp(chip8, static_cast<std::uint16_t>(i & 0xFFE)); }));
+		add("call_ret", measure(samples, [&](std::uint32_t i) { instructions::call(chip8, static_cast<std::uint16_t>(i & 0xFFE)); instructions::ret(chip8); }));
+		add("ld_iaddr", measure(samples, [&](std::uint32_t i) { instructions::ld_iaddr(chip8, static_cast<std::uint16_t>(i & 0xFFF)); }));
+		add("add_ifromregister", measure(samples, [&](std::uint32_t) { i_reg = 0; instructions::add_ifromregister(regs.i, vx); }));
+		add("rnd_registerbyte", measure(samples, [&](std::uint32_t i) { instructions::rnd_registerbyte(chip8, vx, static_cast<std::uint8_t>(i)); }));
+		add("ld_fvx", measure(samples, [&](std::uint32_t i) { vx = i & 0xF; instructions::ld_fvx(chip8, vx); }));
+		add("cls", measure(samples, [&](std::uint32_t) { instructions::cls(chip8); }));
+
+		/* sprites come out of the font so every height reads real data */
+		for (std::uint8_t n : { 1, 5, 10, 15 })
+		{
+			std::string name = "draw_n" + std::to_string(n);
+
+			add(name.c_str(), measure(samples, [&](std::uint32_t i)
+			{
+				i_reg = FONTSET_START;
+				vx = static_cast<std::uint8_t>(i * 7);
+				vy = static_cast<std::uint8_t>(i * 3);
+				instructions::draw(chip8, vx, vy, n, data);
+			}));
+		}
+
+		/* memory writes land at the top of memory, past the rom, so the benchmark doesn't keep invalidating live code */
+		std::uint16_t scratch = static_cast<std::uint16_t>(MEMORY_SIZE - 16);
+
+		add("ld_bvx", measure(samples, [&](std::uint32_t i) { i_reg = scratch; vx = static_cast<std::uint8_t>(i); instructions::ld_bvx(chip8, vx, data); }));
+		add("ld_iarrayfromregister", measure(samples, [&](std::uint32_t) { i_reg = scratch; instructions::ld_iarrayfromregister(chip8, 0xF, data); }));
+		add("ld_registerarrayi", measure(samples, [&](std::uint32_t) { i_reg = scratch; instructions::ld_registerarrayi(chip8, 0xF, data); }));
+	}
+
+	bool bench_rom(const std::string& path, const char* name, ENGINE engine, std::uint32_t samples, std::vector<result_t>& results)
+	{
+		c_chip8 chip8{ path };
+
+		if (chip8.get_length() == 0)
+			return false;
+
+		chip8.set_engine(engine);
+		chip8.scheduler.set_mode(SPEED_FAST_FORWARD);
+		chip8.scheduler.set_instructions_per_second(ROM_IPS);
+
+		std::vector<double> times;
+
+		for (std::uint32_t s = 0; s < samples && !chip8.halted; s++)
+		{
+			std::uint64_t executed = 0;
+			std::uint64_t retired = 1;
+			clock::time_point start = clock::now();
+
+			/* idle loops retire whole passes without running them, only what actually ran is timed */
+			while (executed < ROM_INSTRUCTIONS_PER_SAMPLE && retired != 0 && !chip8.halted)
+			{
+				std::uint64_t skipped = chip8.idle_skipped;
+
+				retired = chip8.scheduler.tick();
+				executed += retired - (chip8.idle_skipped - skipped);
+			}
+
+			if (executed != 0)
+				times.push_back(std::chrono::duration<double, std::nano>(clock::now() - start).count() / executed);
+		}
+
+		if (times.empty())
+			return false;
+
+		results.push_back({ name, engine == ENGINE_JIT ? "jit" : "interpreter", summarize(times) });
+		return true;
+	}
+
+	bool bench_lockstep(const std::string& path, const char* name, std::size_t lanes, std::uint32_t samples, std::vector<result_t>& results)
+	{
+		std::ifstream file(path, std::ios::binary);
+		std::vector<std::uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		if (rom.empty() || lanes == 0)
+			return false;
+
+		c_lockstep lockstep{ rom.data(), rom.size(), lanes };
+		std::vector<double> times;
+
+		for (std::uint32_t s = 0; s < samples; s++)
+		{
+			std::uint64_t executed = 0;
+			std::uint64_t retired = 1;
+			clock::time_point start = clock::now();
+
+			/* once every lane has halted nothing retires any more */
+			while (executed < ROM_INSTRUCTIONS_PER_SAMPLE && retired != 0)
+			{
+				retired = lockstep.run(LOCKSTEP_STEPS_PER_TICK);
+				lockstep.tick_timers();
+				executed += retired;
+			}
+
+			if (executed == 0)
+				break;
+
+			times.push_back(std::chrono::duration<double, std::nano>(clock::now() - start).count() / executed);
+		}
+
+		if (times.empty())
+			return false;
+
+		results.push_back({ name, "lockstep", summarize(times) });
+		return true;
+	}
+
+	/* everything an instruction can change that is compared field by field, the register file has padding */
+	bool same_machine(const c_chip8& a, const c_chip8& b)
+	{
+		const c_register& x = a.registers;
+		const c_register& y = b.registers;
+
+		return std::memcmp(x.v, y.v, sizeof(x.v)) == 0 && x.i == y.i && x.pc == y.pc && x.delay == y.delay && x.sound == y.sound
+			&& x.sp == y.sp && x.fault == y.fault && x.key_wait == y.key_wait && x.key_register == y.key_register
+			&& std::memcmp(x.stack, y.stack, sizeof(x.stack)) == 0
+			&& std::memcmp(a.data, b.data, MEMORY_SIZE) == 0
+			&& a.framebuffer.hash() == b.framebuffer.hash()
+			&& a.halted == b.halted;
+	}
+
+	/* false when the rom didn't load or a lane diverged from its c_chip8 */
+	bool verify_lockstep(const std::string& path, const char* name, std::size_t lanes, MACHINE machine)
+	{
+		std::ifstream file(path, std::ios::binary);
+		std::vector<std::uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		if (rom.empty() || lanes == 0)
+			return false;
+
+		c_lockstep lockstep{ rom.data(), rom.size(), lanes, machine };
+		std::vector<std::unique_ptr<c_chip8>> reference;
+
+		for (std::size_t lane = 0; lane < lanes; lane++)
+		{
+			reference.push_back(std::make_unique<c_chip8>(rom.data(), rom.size()));
+			reference[lane]->set_machine(machine);
+			reference[lane]->rng.seed(lane + 1);
+
+			lockstep.get_lane(lane).rng.seed(lane + 1);
+			lockstep.put_lane(lane);
+		}
+
+		for (std::uint64_t tick = 0; tick < VERIFY_TICKS; tick++)
+		{
+			std::uint64_t expected = 0;
+
+			for (std::size_t lane = 0; lane < lanes; lane++)
+			{
+				/* every lane taps a different key on a different beat, so lanes spread over the program */
+				std::uint16_t keys = (tick / 7 + lane) % 5 == 0 ? static_cast<std::uint16_t>(1 << ((lane + tick) % 16)) : 0;
+
+				reference[lane]->set_keypad(keys);
+				lockstep.set_keypad(lane, keys);
+				expected += reference[lane]->execute(VERIFY_STEPS_PER_TICK);
+				reference[lane]->scheduler.tick_timers();
+			}
+
+			std::uint64_t retired = lockstep.run(VERIFY_STEPS_PER_TICK);
+			lockstep.tick_timers();
+
+			if (retired != expected)
+			{
+				std::fprintf(stderr, "BENCH ERROR: lockstep retired %llu instructions of %s at tick %llu, c_chip8 %llu\n", static_cast<unsigned long long>(retired), name, static_cast<unsigned long long>(tick), static_cast<unsigned long long>(expected));
+				return false;
+			}
+
+			for (std::size_t lane = 0; lane < lanes; lane++)
+			{
+				if (!same_machine(lockstep.get_lane(lane), *reference[lane]))
+				{
+					std::fprintf(stderr, "BENCH ERROR: lockstep lane %zu of %s diverged at tick %llu\n", lane, name, static_cast<unsigned long long>(tick));
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	bool bench_env(const std::string& path, const char* name, std::size_t count, std::uint32_t samples, std::vector<result_t>& results)
+	{
+		std::ifstream file(path, std::ios::binary);
+		std::vector<std::uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		if (rom.empty() || count == 0)
+			return false;
+
+		env_config_t config{};
+		config.instructions_per_second = ENV_IPS;
+
+		std::vector<env_observation_t> observations(count);
+		std::vector<std::uint16_t> actions(count);
+		std::vector<std::uint8_t> done(count);
+		c_vector_env env{ rom.data(), rom.size(), count, observations.data(), config };
+		std::vector<double> times;
+
+		/* what the idle check skipped across every environment, left out of the timing like in bench_rom */
+		auto idle_skipped = [&]()
+		{
+			std::uint64_t total = 0;
+
+			for (std::size_t i = 0; i < count; i++)
+			{
+				total += env.get_machine(i).idle_skipped;
+			}
+
+			return total;
+		};
+
+		for (std::uint32_t s = 0; s < samples; s++)
+		{
+			std::uint64_t executed = 0;
+			std::uint64_t retired = 1;
+			clock::time_point start = clock::now();
+
+			while (executed < ROM_INSTRUCTIONS_PER_SAMPLE && retired != 0)
+			{
+				for (std::size_t i = 0; i < count; i++)
+				{
+					actions[i] = static_cast<std::uint16_t>(1u << ((i + s) & 15));
+				}
+
+				std::uint64_t skipped = idle_skipped();
+
+				retired = env.step(actions.data(), 1, done.data());
+				executed += retired - (idle_skipped() - skipped);
+
+				for (std::size_t i = 0; i < count; i++)
+				{
+					if (done[i] != ENV_RUNNING)
+						env.reset(i);
+				}
+			}
+
+			if (executed != 0)
+				times.push_back(std::chrono::duration<double, std::nano>(clock::now() - start).count() / executed);
+		}
+
+		if (times.empty())
+			return false;
+
+		results.push_back({ name, "env", summarize(times) });
+		return true;
+	}
+
+	bool bench_fork(const std::string& path, const char* name, std::uint32_t samples, std::vector<result_t>& results)
+	{
+		std::ifstream file(path, std::ios::binary);
+		std::vector<std::uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		if (rom.empty())
+			return false;
+
+		c_fork_pool pool{ rom.data(), rom.size() };
+		std::unique_ptr<c_chip8> root = pool.create();
+
+		root->execute(FORK_WARMUP_INSTRUCTIONS);
+		pool.reserve(1);
+
+		results.push_back({ name, "fork", measure(samples, [&](std::uint32_t i)
+		{
+			std::unique_ptr<c_chip8> child = pool.fork(*root);
+
+			child->set_keypad(static_cast<std::uint16_t>(1u << (i & 15)));
+			child->execute(FORK_CHILD_INSTRUCTIONS);
+			pool.recycle(std::move(child));
+		}) });
+
+		return true;
+	}
+
+	void write_json(std::FILE* out, const std::vector<result_t>& handlers, const std::vector<result_t>& roms)
+	{
+		auto write_list = [out](const char* key, const char* unit, const std::vector<result_t>& list, bool last)
+		{
+			std::fprintf(out, "  \"%s\": [\n", key);
+
+			for (std::size_t i = 0; i < list.size(); i++)
+			{
+				const result_t& result = list[i];
+
+				std::fprintf(out, "    { \"name\": \"%s\", \"engine\": \"%s\", \"unit\": \"%s\", \"min\": %.3f, \"median\": %.3f, \"p99\": %.3f, \"median_ips\": %.0f }%s\n",
+					result.name.c_str(), result.engine.c_str(), unit, result.stats.min, result.stats.median, result.stats.p99,
+					result.stats.median > 0.0 ? 1e9 / result.stats.median : 0.0, i + 1 < list.size() ? "," : "");
+			}
+
+			std::fprintf(out, "  ]%s\n", last ? "" : ",");
+		};
+
+		std::fprintf(out, "{\n  \"version\": 1,\n");
+		write_list("handlers", "ns/call", handlers, false);
+		write_list("roms", "ns/instruction", roms, true);
+		std::fprintf(out, "}\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::uint32_t samples = 101;
+	std::string rom_dir = ".";
+	std::string output{};
+	std::size_t lanes = 256;
+	bool verify = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--samples") == 0 && i + 1 < argc)
+			samples = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else if (std::strcmp(argv[i], "--rom-dir") == 0 && i + 1 < argc)
+			rom_dir = argv[++i];
+		else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+			output = argv[++i];
+		else if (std::strcmp(argv[i], "--lanes") == 0 && i + 1 < argc)
+			lanes = std::strtoul(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--verify") == 0)
+			verify = true;
+	}
+
+	if (verify)
+	{
+		for (const char* rom : bundled_roms)
+		{
+			for (MACHINE machine : { MACHINE_CHIP8, MACHINE_SCHIP, MACHINE_XOCHIP })
+			{
+				if (!verify_lockstep(rom_dir + "/" + rom, rom, lanes, machine))
+				{
+					std::printf("BENCH ERROR: lockstep verification failed on %s\n", rom);
+					return 1;
+				}
+			}
+		}
+
+		std::printf("lockstep matches c_chip8 on every bundled rom\n");
+		return 0;
+	}
+
+	if (samples == 0)
+		samples = 1;
+
+	std::vector<result_t> handlers;
+	std::vector<result_t> roms;
+
+	/* the handlers need a machine to run against, any rom with room for the font will do */
+	c_chip8 host{ rom_dir + "/" + bundled_roms[0] };
+
+	if (host.get_length() == 0)
+	{
+		std::printf("BENCH ERROR: couldn't load %s/%s\n", rom_dir.c_str(), bundled_roms[0]);
+		return 1;
+	}
+
+	bench_handlers(host, samples, handlers);
+
+	for (const char* rom : bundled_roms)
+	{
+		for (ENGINE engine : { ENGINE_INTERPRETER, ENGINE_JIT })
+		{
+			if (!bench_rom(rom_dir + "/" + rom, rom, engine, samples, roms))
+				std::fprintf(stderr, "BENCH WARNING: skipped %s\n", rom);
+		}
+
+		if (!bench_lockstep(rom_dir + "/" + rom, rom, lanes, samples, roms))
+			std::fprintf(stderr, "BENCH WARNING: skipped %s on the lockstep engine\n", rom);
+
+		if (!bench_env(rom_dir + "/" + rom, rom, lanes, samples, roms))
+			std::fprintf(stderr, "BENCH WARNING: skipped %s on the env engine\n", rom);
+
+		if (!bench_fork(rom_dir + "/" + rom, rom, samples, handlers))
+			std::fprintf(stderr, "BENCH WARNING: skipped forking %s\n", rom);
+	}
+
+	std::FILE* out = output.empty() ? stdout : std::fopen(output.c_str(), "w");
+
+	if (out == nullptr)
+	{
+		std::printf("BENCH ERROR: couldn't open %s for writing\n", output.c_str());
+		return 1;
+	}
+
+	write_json(out, handlers, roms);
+
+	if (out != stdout)
+		std::fclose(out);
+
+	return 0;
+}
@@ -0,0 +1,139 @@
+#include "../chip8/pack.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+/*
+*	builds a rom pack for batch runs out of loose rom files.
+*
+*	usage: mkpack output.c8pk rom|directory|@listfile ...
+*	       mkpack --list pack.c8pk
+*
+*	directories are searched recursively for .ch8, .sc8 and .xo8 files, the
+*	extension picks the quirk profile stored with each rom. --list prints the
+*	index of an existing pack: sha-1, size, profile and source path.
+*/
+
+namespace
+{
+	/* the names --machine takes, indexed by MACHINE */
+	const char* PROFILE_NAMES[] = { "chip8", "schip", "xochip" };
+
+	bool is_rom(const std::filesystem::path& path)
+	{
+		std::string extension = path.extension().string();
+		return extension == ".ch8" || extension == ".sc8" || extension == ".xo8";
+	}
+
+	void collect(const std::string& argument, std::vector<std::string>& files)
+	{
+		if (!argument.empty() && argument[0] == '@')
+		{
+			std::ifstream list(argument.substr(1));
+			std::string line;
+
+			while (std::getline(list, line))
+			{
+				if (!line.empty())
+					files.push_back(line);
+			}
+
+			return;
+		}
+
+		std::error_code error;
+
+		if (std::filesystem::is_directory(argument, error))
+		{
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(argument, error))
+			{
+				if (entry.is_regular_file() && is_rom(entry.path()))
+					files.push_back(entry.path().string());
+			}
+
+			return;
+		}
+
+		files.push_back(argument);
+	}
+
+	int list(const std::string& filename)
+	{
+		c_rom_pack pack{};
+
+		if (!pack.open(filename))
+			return 1;
+
+		for (std::size_t i = 0; i < pack.get_count(); i++)
+		{
+			const pack_entry_t& entry = pack.get_entry(i);
+			const char* profile = entry.profile < std::size(PROFILE_NAMES) ? PROFILE_NAMES[entry.profile] : "?";
+
+			std::printf("%s\t%u\t%s\t%s\n", sha1_to_hex(entry.sha1).c_str(), entry.size, profile, pack.get_name(i));
+		}
+
+		return 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc == 3 && std::strcmp(argv[1], "--list") == 0)
+		return list(argv[2]);
+
+	if (argc < 3)
+	{
+		std::printf("usage: mkpack output.c8pk rom|directory|@listfile ...\n       mkpack --list pack.c8pk\n");
+		return 1;
+	}
+
+	std::vector<std::string> files;
+
+	for (int i = 2; i < argc; i++)
+	{
+		collect(argv[i], files);
+	}
+
+	std::vector<pack_rom_t> roms;
+	roms.reserve(files.size());
+
+	for (const std::string& file : files)
+	{
+		std::ifstream stream(file, std::ios::binary);
+
+		if (!stream.is_open())
+		{
+			std::printf("PACK WARNING: couldn't open %s, skipping it\n", file.c_str());
+			continue;
+		}
+
+		pack_rom_t rom{ file, machine_from_extension(std::filesystem::path(file).extension().string()), {} };
+		rom.bytes.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+
+		if (rom.bytes.empty())
+		{
+			std::printf("PACK WARNING: %s is empty, skipping it\n", file.c_str());
+			continue;
+		}
+
+		roms.push_back(std::move(rom));
+	}
+
+	if (roms.empty())
+	{
+		std::printf("PACK ERROR: no roms to pack\n");
+		return 1;
+	}
+
+	std::size_t written = rompack::write(argv[1], roms);
+
+	if (written == 0)
+		return 1;
+
+	std::printf("# %zu roms packed into %s, %zu duplicates dropped\n", written, argv[1], roms.size() - written);
+	return 0;
+}
@@ -0,0 +1,418 @@
+#include "../chip8/chip8.hpp"
+#include "../chip8/decoder.hpp"
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+/*
+*	ahead of time recompiler. follows a rom's code from 0x200 through every
+*	JP, CALL and skip, and writes out a c++ translation unit with one function
+*	per block that runs the block's instructions through instructions.hpp with
+*	their operands baked in. compiling that file into the emulator and running
+*	with --aot skips fetch and decode for all the code it reached.
+*
+*	usage: recompile rom [--machine chip8 | schip | xochip] [--output file.cpp]
+*
+*	the output goes next to src/aot/aot.cpp unless --output says otherwise,
+*	it includes aot.hpp and ../chip8/instructions.hpp relative to itself.
+*	add it to the main line of compile.bat and its object to the link line,
+*	it registers itself and is picked for the rom whose bytes it was made from.
+*	BNNN and RET targets aren't known until run time, the dispatcher looks
+*	those up and interprets anything no block starts at.
+*/
+
+namespace
+{
+	/* caps how far a block can run past a tick's instruction budget, the same as a jit block */
+	constexpr std::uint32_t AOT_MAX_BLOCK_INSTRUCTIONS = 64;
+
+	/* how an instruction leaves, for following the rom's control flow */
+	enum FLOW
+	{
+		/* straight on to the next instruction */
+		FLOW_NEXT,
+		/* ends the block, the next instruction starts another one */
+		FLOW_BREAK,
+		FLOW_JUMP,
+		FLOW_CALL,
+		FLOW_SKIP,
+		/* RET and BNNN, the target is only known at run time */
+		FLOW_DYNAMIC,
+		FLOW_STOP
+	};
+
+	FLOW flow(std::uint8_t handler)
+	{
+		switch (handler)
+		{
+			case OP_JP:
+				return FLOW_JUMP;
+
+			case OP_CALL:
+				return FLOW_CALL;
+
+			case OP_SEVXBYTE:
+			case OP_SNEVXBYTE:
+			case OP_SEVXVY:
+			case OP_SNEVXVY:
+			case OP_SKPVX:
+			case OP_SKNPVX:
+				return FLOW_SKIP;
+
+			case OP_RET:
+			case OP_JPV0ADDR:
+				return FLOW_DYNAMIC;
+
+			case OP_EXIT:
+				return FLOW_STOP;
+
+			/* stores may rewrite the code right after them, and FX0A stops the cpu */
+			case OP_LDVXK:
+			case OP_LDBVX:
+			case OP_LDIARRAYFROMV0VX:
+			case OP_SAVEVXVY:
+				return FLOW_BREAK;
+
+			default:
+				return FLOW_NEXT;
+		}
+	}
+
+	struct block_t
+	{
+		std::uint16_t address;
+		std::uint16_t length;
+		std::string body;
+	};
+
+	class c_recompiler
+	{
+	public:
+		c_recompiler(const std::vector<std::uint8_t>& rom, MACHINE machine)
+			: rom(rom), machine(machine), leader(MEMORY_SIZE, false)
+		{
+		}
+
+		void run()
+		{
+			this->add_leader(PROGRAM_START);
+
+			while (!this->pending.empty())
+			{
+				std::uint16_t address = this->pending.front();
+				this->pending.pop_front();
+				this->compile(address);
+			}
+		}
+
+		bool write(const std::string& filename, const std::string& name) const;
+
+		std::size_t get_blocks() const
+		{
+			return this->blocks.size();
+		}
+
+		std::size_t get_instructions() const
+		{
+			return this->instructions;
+		}
+	private:
+		/* both bytes of the word have to come from the rom for it to be known code */
+		bool in_rom(std::uint32_t address) const
+		{
+			return address >= PROGRAM_START && address + 1 < PROGRAM_START + this->rom.size();
+		}
+
+		std::uint16_t word(std::uint32_t address) const
+		{
+			return static_cast<std::uint16_t>(this->rom[address - PROGRAM_START] << 8) | this->rom[address + 1 - PROGRAM_START];
+		}
+
+		void add_leader(std::uint32_t address)
+		{
+			if (!this->in_rom(address) || this->leader[address])
+				return;
+
+			this->leader[address] = true;
+			this->pending.push_back(static_cast<std::uint16_t>(address));
+		}
+
+		/* a taken skip steps over F000 NNNN whole on xo-chip */
+		std::uint32_t skip_target(std::uint32_t next) const
+		{
+			if (this->machine == MACHINE_XOCHIP && this->in_rom(next) && this->word(next) == 0xF000)
+				return next + 4;
+
+			return next + 2;
+		}
+
+		void compile(std::uint16_t start);
+		std::string statement(const decoded_instruction_t& entry, std::uint32_t address, std::uint32_t retired) const;
+
+		const std::vector<std::uint8_t>& rom;
+		MACHINE machine;
+
+		std::vector<bool> leader;
+		std::deque<std::uint16_t> pending;
+		std::vector<block_t> blocks;
+		std::size_t instructions{};
+	};
+
+	template<typename... T>
+	std::string format(const char* format, T... values)
+	{
+		char buffer[192];
+		std::snprintf(buffer, sizeof(buffer), format, values...);
+		return buffer;
+	}
+
+	/* the c++ for one instruction, the same handler call the interpreter makes with the operands filled in */
+	std::string c_recompiler::statement(const decoded_instruction_t& entry, std::uint32_t address, std::uint32_t retired) const
+	{
+		std::uint32_t x = entry.x;
+		std::uint32_t y = entry.y;
+		std::uint32_t next = address + 2;
+
+		switch (entry.handler)
+		{
+			case OP_CLS: return "instructions::cls(chip8);";
+			case OP_RET: return format("regs.pc = 0x%03X; if (!instructions::ret(chip8)) return aot::fault(chip8, 0x%03X, %u); return %u;", next, address, retired, retired);
+			case OP_JP: return format("regs.pc = 0x%03X; return %u;", entry.imm, retired);
+			case OP_CALL: return format("regs.pc = 0x%03X; if (!instructions::call(chip8, 0x%03X)) return aot::fault(chip8, 0x%03X, %u); return %u;", next, entry.imm, address, retired, retired);
+			case OP_SEVXBYTE: return format("regs.pc = 0x%03X; instructions::se(chip8, regs.v[%u], 0x%02X); return %u;", next, x, entry.imm, retired);
+			case OP_SNEVXBYTE: return format("regs.pc = 0x%03X; instructions::sne(chip8, regs.v[%u], 0x%02X); return %u;", next, x, entry.imm, retired);
+			case OP_SEVXVY: return format("regs.pc = 0x%03X; instructions::se_registers(chip8, regs.v[%u], regs.v[%u]); return %u;", next, x, y, retired);
+			case OP_SNEVXVY: return format("regs.pc = 0x%03X; instructions::sne_register(chip8, regs.v[%u], regs.v[%u]); return %u;", next, x, y, retired);
+			case OP_LDVXBYTE: return format("instructions::ld_byte(regs.v[%u], 0x%02X);", x, entry.imm);
+			case OP_ADDVXBYTE: return format("instructions::add_byte(regs.v[%u], 0x%02X);", x, entry.imm);
+			case OP_LDVXVY: return format("instructions::ld_registers(regs.v[%u], regs.v[%u]);", x, y);
+			case OP_ORVXVY: return format("instructions::or_registers(regs.v[%u], regs.v[%u]);", x, y);
+			case OP_ANDVXVY: return format("instructions::and_registers(regs.v[%u], regs.v[%u]);", x, y);
+			case OP_XORVXVY: return format("instructions::xor_registers(regs.v[%u], regs.v[%u]);", x, y);
+			case OP_ADDVXVY: return format("instructions::add_registers(chip8, regs.v[%u], regs.v[%u]);", x, y);
+			case OP_SUBVXVY: return format("instructions::sub_registers(chip8, regs.v[%u], regs.v[%u]);", x, y);
+			case OP_SHRVX: return format("instructions::shr(chip8, regs.v[%u]);", x);
+			case OP_SUBNVXVY: return format("instructions::subn_registers(chip8, regs.v[%u], regs.v[%u]);", x, y);
+			case OP_SHLVX: return format("instructions::shl(chip8, regs.v[%u]);", x);
+			case OP_LDIADDR: return format("instructions::ld_iaddr(chip8, 0x%03X);", entry.imm);
+			case OP_JPV0ADDR: return format("instructions::jmp_registerv0addr(chip8, 0x%03X); return %u;", entry.imm, retired);
+			case OP_RND: return format("instructions::rnd_registerbyte(chip8, regs.v[%u], 0x%02X);", x, entry.imm);
+			case OP_DRW: return format("instructions::draw(chip8, regs.v[%u], regs.v[%u], %u, chip8.data);", x, y, entry.n);
+			case OP_SKPVX: return format("regs.pc = 0x%03X; instructions::skip_if_pressed(chip8, regs.v[%u]); return %u;", next, x, retired);
+			case OP_SKNPVX: return format("regs.pc = 0x%03X; instructions::skip_if_not_pressed(chip8, regs.v[%u]); return %u;", next, x, retired);
+			case OP_LDVXDT: return format("instructions::ld_registerdt(chip8, regs.v[%u]);", x);
+			case OP_LDVXK: return format("regs.pc = 0x%03X; instructions::ld_key_into_register(chip8, %u); return %u;", next, x, retired);
+			case OP_LDDTVX: return format("instructions::ld_registerintodt(chip8, regs.v[%u]);", x);
+			case OP_LDSTVX: return format("instructions::ld_registerintost(chip8, regs.v[%u]);", x);
+			case OP_ADDIVX: return format("instructions::add_ifromregister(regs.i, regs.v[%u]);", x);
+			case OP_LDFVX: return format("instructions::ld_fvx(chip8, regs.v[%u]);", x);
+			case OP_LDBVX: return format("regs.pc = 0x%03X; instructions::ld_bvx(chip8, regs.v[%u], chip8.data); return %u;", next, x, retired);
+			case OP_LDIARRAYFROMV0VX: return format("regs.pc = 0x%03X; instructions::ld_iarrayfromregister(chip8, %u, chip8.data); return %u;", next, x, retired);
+			case OP_LDV0VXFROMIARRAY: return format("instructions::ld_registerarrayi(chip8, %u, chip8.data);", x);
+			case OP_SCD: return format("chip8.framebuffer.scroll_down(%u);", entry.n);
+			case OP_SCU: return format("chip8.framebuffer.scroll_up(%u);", entry.n);
+			case OP_SCR: return "chip8.framebuffer.scroll_right();";
+			case OP_SCL: return "chip8.framebuffer.scroll_left();";
+			case OP_EXIT: return format("regs.pc = 0x%03X; chip8.halted = true; return %u;", address, retired);
+			case OP_LOW: return "chip8.framebuffer.set_hires(false);";
+			case OP_HIGH: return "chip8.framebuffer.set_hires(true);";
+			case OP_SAVEVXVY: return format("regs.pc = 0x%03X; instructions::save_range(chip8, %u, %u, chip8.data); return %u;", next, x, y, retired);
+			case OP_LOADVXVY: return format("instructions::load_range(chip8, %u, %u, chip8.data);", x, y);
+			case OP_LDILONG: return format("regs.pc = 0x%03X; instructions::ld_ilong(chip8, chip8.data);", next);
+			case OP_PLANE: return format("instructions::select_planes(chip8, %u);", x);
+			case OP_AUDIO: return "instructions::ld_audio(chip8, chip8.data);";
+			case OP_LDHFVX: return format("instructions::ld_hfvx(chip8, regs.v[%u]);", x);
+			case OP_PITCH: return format("instructions::ld_pitch(chip8, regs.v[%u]);", x);
+			case OP_SAVEFLAGS: return format("instructions::save_flags(chip8, %u);", x);
+			case OP_LOADFLAGS: return format("instructions::load_flags(chip8, %u);", x);
+			default: return "/* does nothing */";
+		}
+	}
+
+	void c_recompiler::compile(std::uint16_t start)
+	{
+		block_t block{ start, 0, {} };
+		std::uint32_t address = start;
+		std::uint32_t retired = 0;
+		bool open = true;
+
+		/* the block can run on into code another block starts in, the two just share it */
+		while (open && this->in_rom(address) && retired < AOT_MAX_BLOCK_INSTRUCTIONS)
+		{
+			decoded_instruction_t entry = decoder::decode(this->word(address), this->machine);
+			std::uint32_t length = entry.handler == OP_LDILONG ? 4 : 2;
+
+			/* F000 with its address running off the end of the rom isn't known code */
+			if (!this->in_rom(address + length - 2))
+				break;
+
+			retired++;
+			block.body += format("\t\t/* %03X: %04X */ ", address, entry.opcode) + this->statement(entry, address, retired) + "\n";
+
+			switch (flow(entry.handler))
+			{
+				case FLOW_NEXT:
+					break;
+
+				case FLOW_BREAK:
+					this->add_leader(address + 2);
+					open = false;
+					break;
+
+				case FLOW_JUMP:
+					this->add_leader(entry.imm);
+					open = false;
+					break;
+
+				case FLOW_CALL:
+					this->add_leader(entry.imm);
+					this->add_leader(address + 2);
+					open = false;
+					break;
+
+				case FLOW_SKIP:
+					this->add_leader(address + 2);
+					this->add_leader(this->skip_target(address + 2));
+					open = false;
+					break;
+
+				case FLOW_DYNAMIC:
+				case FLOW_STOP:
+					open = false;
+					break;
+			}
+
+			address += length;
+		}
+
+		if (retired == 0)
+			return;
+
+		/* ran out of rom or hit the cap, whatever comes next is found through the dispatcher */
+		if (open)
+		{
+			block.body += format("\t\tregs.pc = 0x%03X;\n\t\treturn %u;\n", address, retired);
+			this->add_leader(address);
+		}
+
+		block.length = static_cast<std::uint16_t>(address - start);
+		this->instructions += retired;
+		this->blocks.push_back(std::move(block));
+	}
+
+	bool c_recompiler::write(const std::string& filename, const std::string& name) const
+	{
+		std::FILE* out = std::fopen(filename.c_str(), "w");
+
+		if (out == nullptr)
+		{
+			std::printf("RECOMPILE ERROR: couldn't open %s for writing\n", filename.c_str());
+			return false;
+		}
+
+		const char* machines[] = { "MACHINE_CHIP8", "MACHINE_SCHIP", "MACHINE_XOCHIP" };
+
+		/* the name ends up in a string literal */
+		std::string label = name;
+
+		for (char& c : label)
+		{
+			if (c == '"' || c == '\\' || c < ' ')
+				c = '_';
+		}
+
+		std::fprintf(out, "/* generated by recompile from %s, %zu blocks. regenerate it rather than editing it */\n\n", label.c_str(), this->blocks.size());
+		std::fprintf(out, "#include \"aot.hpp\"\n#include \"../chip8/instructions.hpp\"\n\nnamespace\n{\n");
+
+		for (const block_t& block : this->blocks)
+		{
+			std::fprintf(out, "\tstd::uint32_t block_%03X(c_chip8& chip8)\n\t{\n\t\t[[maybe_unused]] c_register& regs = chip8.registers;\n\n%s\t}\n\n", block.address, block.body.c_str());
+		}
+
+		std::fprintf(out, "\tconst std::uint8_t rom[] =\n\t{");
+
+		for (std::size_t i = 0; i < this->rom.size(); i++)
+		{
+			std::fprintf(out, "%s0x%02X,", i % 16 == 0 ? "\n\t\t" : " ", this->rom[i]);
+		}
+
+		std::fprintf(out, "\n\t};\n\n\tconst aot_entry_t entries[] =\n\t{\n");
+
+		for (const block_t& block : this->blocks)
+		{
+			std::fprintf(out, "\t\t{ 0x%03X, %u, block_%03X },\n", block.address, block.length, block.address);
+		}
+
+		std::fprintf(out, "\t};\n\n");
+		std::fprintf(out, "\tconst aot_program_t program{ \"%s\", %s, rom, sizeof(rom), entries, sizeof(entries) / sizeof(entries[0]) };\n", label.c_str(), machines[this->machine]);
+		std::fprintf(out, "\tconst aot::registrar_t registrar{ program };\n}\n");
+
+		bool written = std::ferror(out) == 0;
+		std::fclose(out);
+		return written;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string filename{};
+	std::string output{};
+	MACHINE machine = MACHINE_CHIP8;
+	bool machine_given = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--machine") == 0 && i + 1 < argc)
+		{
+			machine_given = machine_from_name(argv[++i], machine);
+
+			if (!machine_given)
+				std::printf("RECOMPILE WARNING: unknown machine %s, going by the rom's extension\n", argv[i]);
+		}
+		else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+			output = argv[++i];
+		else
+			filename = argv[i];
+	}
+
+	if (filename.empty())
+	{
+		std::printf("usage: recompile rom [--machine chip8 | schip | xochip] [--output file.cpp]\n");
+		return 1;
+	}
+
+	std::ifstream file(filename, std::ios::binary);
+	std::vector<std::uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	if (rom.empty())
+	{
+		std::printf("RECOMPILE ERROR: couldn't read %s\n", filename.c_str());
+		return 1;
+	}
+
+	/* what c_chip8 would load, anything past the top of memory is dropped */
+	if (rom.size() > MEMORY_SIZE - PROGRAM_START)
+		rom.resize(MEMORY_SIZE - PROGRAM_START);
+
+	std::filesystem::path path(filename);
+
+	if (!machine_given)
+		machine = machine_from_extension(path.extension().string());
+
+	if (output.empty())
+		output = "src/aot/" + path.stem().string() + ".cpp";
+
+	c_recompiler recompiler{ rom, machine };
+	recompiler.run();
+
+	if (!recompiler.write(output, path.filename().string()))
+		return 1;
+
+	std::printf("%s: %zu blocks, %zu instructions written to %s\n", filename.c_str(), recompiler.get_blocks(), recompiler.get_instructions(), output.c_str());
+	return 0;
+}
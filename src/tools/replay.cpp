@@ -0,0 +1,89 @@
+#include "../chip8/chip8.hpp"
+#include "../chip8/movie.hpp"
+#include "../chip8/savestate.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+/*
+*	plays an input movie back headless at full speed.
+*
+*	usage: replay rom movie [--seek frame] [--checkpoint frames] [--save-state file]
+*	    --seek frame         stop just before the given tick instead of playing to the end
+*	    --checkpoint frames  ticks between the save states kept for seeking (default 600)
+*	    --save-state file    write the machine out where playback stopped
+*
+*	prints the tick playback stopped at, instructions retired, wall time,
+*	instructions per second and the framebuffer hash, which is the same on
+*	every run of the same movie.
+*/
+
+int main(int argc, char** argv)
+{
+	std::string rom{};
+	std::string movie_file{};
+	std::string save_state{};
+	long long seek = -1;
+	std::uint32_t checkpoint_interval = MOVIE_CHECKPOINT_INTERVAL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--seek") == 0 && i + 1 < argc)
+			seek = std::strtoll(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc)
+			checkpoint_interval = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else if (std::strcmp(argv[i], "--save-state") == 0 && i + 1 < argc)
+			save_state = argv[++i];
+		else if (rom.empty())
+			rom = argv[i];
+		else
+			movie_file = argv[i];
+	}
+
+	if (rom.empty() || movie_file.empty())
+	{
+		std::printf("usage: replay rom movie [--seek frame] [--checkpoint frames] [--save-state file]\n");
+		return 1;
+	}
+
+	c_movie movie{};
+
+	if (!movie.load(movie_file))
+		return 1;
+
+	c_chip8 chip8{ rom };
+
+	if (chip8.get_length() == 0)
+		return 1;
+
+	c_replay replay{ chip8, movie, checkpoint_interval };
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	if (seek >= 0)
+	{
+		if (!replay.seek(static_cast<std::size_t>(seek)))
+			std::printf("REPLAY WARNING: stopped at frame %zu before reaching %lld\n", replay.get_frame(), seek);
+	}
+	else
+	{
+		while (replay.step())
+		{
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	/* passes of idle loops skipped ahead cost nothing, ips only counts what ran */
+	std::uint64_t ran = replay.get_instructions() - std::min(chip8.idle_skipped, replay.get_instructions());
+	double ips = seconds > 0.0 ? ran / seconds : 0.0;
+
+	std::printf("frame %zu/%zu\tinstructions %llu\t%.3fs\t%.0f ips\thash %016llx\n", replay.get_frame(), movie.get_frames(),
+		static_cast<unsigned long long>(replay.get_instructions()), seconds, ips, static_cast<unsigned long long>(chip8.framebuffer.hash()));
+
+	if (!save_state.empty() && !savestate::save_file(chip8, save_state))
+		return 1;
+
+	return 0;
+}
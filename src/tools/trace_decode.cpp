@@ -0,0 +1,91 @@
+#include "../trace/trace.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*
+*	prints a binary trace written by c_tracer.
+*
+*	usage: trace_decode file [--pc lo hi] [--opcode value mask] [--reg n]
+*	    --pc      only records with lo <= PC <= hi
+*	    --opcode  only records where (opcode & mask) == value, e.g. --opcode D000 F000
+*	    --reg     only records that wrote Vn
+*/
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::printf("usage: trace_decode file [--pc lo hi] [--opcode value mask] [--reg n]\n");
+		return 1;
+	}
+
+	std::uint32_t pc_low = 0;
+	std::uint32_t pc_high = 0xFFFF;
+	std::uint32_t opcode_value = 0;
+	std::uint32_t opcode_mask = 0;
+	std::uint32_t reg = TRACE_NO_REGISTER;
+
+	for (int i = 2; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--pc") == 0 && i + 2 < argc)
+		{
+			pc_low = std::strtoul(argv[++i], nullptr, 0);
+			pc_high = std::strtoul(argv[++i], nullptr, 0);
+		}
+		else if (std::strcmp(argv[i], "--opcode") == 0 && i + 2 < argc)
+		{
+			opcode_value = std::strtoul(argv[++i], nullptr, 16);
+			opcode_mask = std::strtoul(argv[++i], nullptr, 16);
+		}
+		else if (std::strcmp(argv[i], "--reg") == 0 && i + 1 < argc)
+		{
+			reg = std::strtoul(argv[++i], nullptr, 16);
+		}
+	}
+
+	std::FILE* file = std::fopen(argv[1], "rb");
+
+	if (file == nullptr)
+	{
+		std::printf("TRACE ERROR: couldn't open %s\n", argv[1]);
+		return 1;
+	}
+
+	trace_header_t header{};
+
+	if (std::fread(&header, sizeof(header), 1, file) != 1 || header.magic != TRACE_MAGIC || header.record_size != sizeof(trace_record_t))
+	{
+		std::printf("TRACE ERROR: %s isn't a version %u trace\n", argv[1], TRACE_VERSION);
+		std::fclose(file);
+		return 1;
+	}
+
+	trace_record_t records[4096];
+	std::size_t count = 0;
+	std::uint64_t index = 0;
+
+	while ((count = std::fread(records, sizeof(trace_record_t), 4096, file)) != 0)
+	{
+		for (std::size_t i = 0; i < count; i++, index++)
+		{
+			const trace_record_t& record = records[i];
+
+			if (record.pc < pc_low || record.pc > pc_high)
+				continue;
+
+			if ((record.opcode & opcode_mask) != opcode_value)
+				continue;
+
+			if (reg != TRACE_NO_REGISTER && record.reg != reg)
+				continue;
+
+			if (record.reg != TRACE_NO_REGISTER)
+				std::printf("%10llu  PC=%03X  %04X  I=%03X  V%X=%02X\n", static_cast<unsigned long long>(index), record.pc, record.opcode, record.i, record.reg, record.value);
+			else
+				std::printf("%10llu  PC=%03X  %04X  I=%03X\n", static_cast<unsigned long long>(index), record.pc, record.opcode, record.i);
+		}
+	}
+
+	std::fclose(file);
+	return 0;
+}
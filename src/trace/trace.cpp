@@ -0,0 +1,57 @@
+#include "trace.hpp"
+#include <chrono>
+
+c_tracer::c_tracer(const std::string& filename)
+	: ring(std::make_unique<c_trace_ring>())
+{
+	this->file = std::fopen(filename.c_str(), "wb");
+
+	if (this->file == nullptr)
+	{
+		std::printf("TRACE ERROR: couldn't open %s for writing, tracing disabled\n", filename.c_str());
+		return;
+	}
+
+	trace_header_t header{ TRACE_MAGIC, TRACE_VERSION, sizeof(trace_record_t) };
+	std::fwrite(&header, sizeof(header), 1, this->file);
+
+	this->writer = std::thread(&c_tracer::drain, this);
+}
+
+c_tracer::~c_tracer()
+{
+	if (this->file == nullptr)
+		return;
+
+	this->stopping.store(true, std::memory_order_release);
+	this->writer.join();
+
+	std::fclose(this->file);
+
+	if (this->dropped != 0)
+		std::printf("TRACE WARNING: %llu records dropped, the writer couldn't keep up\n", static_cast<unsigned long long>(this->dropped));
+}
+
+void c_tracer::drain()
+{
+	constexpr std::uint32_t CHUNK_RECORDS = 4096;
+	static thread_local trace_record_t chunk[CHUNK_RECORDS];
+
+	while (true)
+	{
+		/* read the flag before draining so nothing pushed ahead of the stop is lost */
+		bool stop = this->stopping.load(std::memory_order_acquire);
+		std::size_t count = this->ring->pop(chunk, CHUNK_RECORDS);
+
+		if (count != 0)
+		{
+			std::fwrite(chunk, sizeof(trace_record_t), count, this->file);
+			continue;
+		}
+
+		if (stop)
+			break;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
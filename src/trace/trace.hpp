@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <atomic>
+#include <thread>
+#include <string>
+#include <memory>
+#include "../util/spsc_ring.hpp"
+
+constexpr std::uint32_t TRACE_MAGIC = 0x52543843; // "C8TR"
+constexpr std::uint16_t TRACE_VERSION = 1;
+
+/* power of two so the ring indices wrap with a mask */
+constexpr std::uint32_t TRACE_RING_RECORDS = 1 << 16;
+
+/* reg value for instructions that don't write a V register */
+constexpr std::uint8_t TRACE_NO_REGISTER = 0xFF;
+
+/* one retired instruction, written to the trace file as is */
+struct trace_record_t
+{
+	std::uint16_t pc;
+	std::uint16_t opcode;
+	std::uint16_t i;
+	std::uint8_t reg;
+	std::uint8_t value;
+};
+
+static_assert(sizeof(trace_record_t) == 8, "trace records are written to disk raw");
+
+struct trace_header_t
+{
+	std::uint32_t magic;
+	std::uint16_t version;
+	std::uint16_t record_size;
+};
+
+/* the emulation thread pushes and never blocks, a record that doesn't fit is counted as dropped instead */
+using c_trace_ring = c_spsc_ring<trace_record_t, TRACE_RING_RECORDS>;
+
+/*
+*	owns the ring and a background thread that drains it to a trace file.
+*	read the file back with the trace_decode tool.
+*/
+class c_tracer
+{
+public:
+	c_tracer(const std::string& filename);
+	~c_tracer();
+
+	bool is_open() const
+	{
+		return this->file != nullptr;
+	}
+
+	void record(const trace_record_t& record)
+	{
+		if (!this->ring->push(record))
+			this->dropped++;
+	}
+
+	std::uint64_t get_dropped() const
+	{
+		return this->dropped;
+	}
+private:
+	void drain();
+
+	std::unique_ptr<c_trace_ring> ring;
+	std::FILE* file{};
+	std::thread writer;
+	std::atomic<bool> stopping{};
+
+	/* only touched by the emulation thread */
+	std::uint64_t dropped{};
+};
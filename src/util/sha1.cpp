@@ -0,0 +1,147 @@
+#include "sha1.hpp"
+#include <cstring>
+
+namespace
+{
+	std::uint32_t rotl(std::uint32_t value, int bits)
+	{
+		return (value << bits) | (value >> (32 - bits));
+	}
+
+	void compress(std::uint32_t state[5], const std::uint8_t block[64])
+	{
+		std::uint32_t w[80];
+
+		for (int i = 0; i < 16; i++)
+		{
+			w[i] = (static_cast<std::uint32_t>(block[i * 4]) << 24) | (static_cast<std::uint32_t>(block[i * 4 + 1]) << 16) | (static_cast<std::uint32_t>(block[i * 4 + 2]) << 8) | block[i * 4 + 3];
+		}
+
+		for (int i = 16; i < 80; i++)
+		{
+			w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+		}
+
+		std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+		for (int i = 0; i < 80; i++)
+		{
+			std::uint32_t f, k;
+
+			if (i < 20)
+			{
+				f = (b & c) | (~b & d);
+				k = 0x5A827999;
+			}
+			else if (i < 40)
+			{
+				f = b ^ c ^ d;
+				k = 0x6ED9EBA1;
+			}
+			else if (i < 60)
+			{
+				f = (b & c) | (b & d) | (c & d);
+				k = 0x8F1BBCDC;
+			}
+			else
+			{
+				f = b ^ c ^ d;
+				k = 0xCA62C1D6;
+			}
+
+			std::uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+			e = d;
+			d = c;
+			c = rotl(b, 30);
+			b = a;
+			a = temp;
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+	}
+}
+
+void sha1(const std::uint8_t* data, std::size_t length, std::uint8_t digest[SHA1_SIZE])
+{
+	std::uint32_t state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+	std::size_t offset = 0;
+
+	for (; offset + 64 <= length; offset += 64)
+	{
+		compress(state, data + offset);
+	}
+
+	/* the tail, a one bit, zero padding and the bit length big endian, in one or two blocks */
+	std::uint8_t tail[128]{};
+	std::size_t remaining = length - offset;
+	std::size_t blocks = remaining < 56 ? 1 : 2;
+
+	std::memcpy(tail, data + offset, remaining);
+	tail[remaining] = 0x80;
+
+	std::uint64_t bits = static_cast<std::uint64_t>(length) * 8;
+
+	for (int i = 0; i < 8; i++)
+	{
+		tail[blocks * 64 - 1 - i] = static_cast<std::uint8_t>(bits >> (i * 8));
+	}
+
+	for (std::size_t i = 0; i < blocks; i++)
+	{
+		compress(state, tail + i * 64);
+	}
+
+	for (int i = 0; i < 5; i++)
+	{
+		digest[i * 4] = static_cast<std::uint8_t>(state[i] >> 24);
+		digest[i * 4 + 1] = static_cast<std::uint8_t>(state[i] >> 16);
+		digest[i * 4 + 2] = static_cast<std::uint8_t>(state[i] >> 8);
+		digest[i * 4 + 3] = static_cast<std::uint8_t>(state[i]);
+	}
+}
+
+std::string sha1_to_hex(const std::uint8_t digest[SHA1_SIZE])
+{
+	static const char digits[] = "0123456789abcdef";
+	std::string text(SHA1_SIZE * 2, '0');
+
+	for (std::size_t i = 0; i < SHA1_SIZE; i++)
+	{
+		text[i * 2] = digits[digest[i] >> 4];
+		text[i * 2 + 1] = digits[digest[i] & 0xF];
+	}
+
+	return text;
+}
+
+bool sha1_from_hex(const std::string& text, std::uint8_t digest[SHA1_SIZE])
+{
+	if (text.size() != SHA1_SIZE * 2)
+		return false;
+
+	for (std::size_t i = 0; i < SHA1_SIZE * 2; i++)
+	{
+		char c = text[i];
+		int nibble;
+
+		if (c >= '0' && c <= '9')
+			nibble = c - '0';
+		else if (c >= 'a' && c <= 'f')
+			nibble = c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			nibble = c - 'A' + 10;
+		else
+			return false;
+
+		if (i % 2 == 0)
+			digest[i / 2] = static_cast<std::uint8_t>(nibble << 4);
+		else
+			digest[i / 2] |= static_cast<std::uint8_t>(nibble);
+	}
+
+	return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+constexpr std::size_t SHA1_SIZE = 20;
+
+/*
+*	plain fips 180-1 sha-1. only used to identify roms, where collisions
+*	between dumps aren't a concern and every rom database already keys on it.
+*/
+void sha1(const std::uint8_t* data, std::size_t length, std::uint8_t digest[SHA1_SIZE]);
+
+/* 40 lowercase hex digits */
+std::string sha1_to_hex(const std::uint8_t digest[SHA1_SIZE]);
+
+/* false unless text is exactly 40 hex digits */
+bool sha1_from_hex(const std::string& text, std::uint8_t digest[SHA1_SIZE]);
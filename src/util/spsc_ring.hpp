@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+
+/*
+*	bounded single producer single consumer queue. neither side ever waits or
+*	allocates, a full ring refuses the push and an empty one the pop, which is
+*	what a realtime thread like an audio callback needs from its input.
+*/
+template<typename T, std::size_t CAPACITY>
+class c_spsc_ring
+{
+	static_assert((CAPACITY & (CAPACITY - 1)) == 0, "the capacity has to be a power of two");
+public:
+	/* producer side */
+	bool push(const T& item)
+	{
+		std::size_t head = this->head.load(std::memory_order_relaxed);
+
+		if (head - this->tail.load(std::memory_order_acquire) == CAPACITY)
+			return false;
+
+		this->items[head & (CAPACITY - 1)] = item;
+		this->head.store(head + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	/* consumer side */
+	bool pop(T& item)
+	{
+		std::size_t tail = this->tail.load(std::memory_order_relaxed);
+
+		if (tail == this->head.load(std::memory_order_acquire))
+			return false;
+
+		item = this->items[tail & (CAPACITY - 1)];
+		this->tail.store(tail + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	/* consumer side, copies up to max items out and returns how many */
+	std::size_t pop(T* out, std::size_t max)
+	{
+		std::size_t tail = this->tail.load(std::memory_order_relaxed);
+		std::size_t available = this->head.load(std::memory_order_acquire) - tail;
+		std::size_t count = available < max ? available : max;
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			out[i] = this->items[(tail + i) & (CAPACITY - 1)];
+		}
+
+		this->tail.store(tail + count, std::memory_order_release);
+		return count;
+	}
+
+	/* exact from the consumer, a lower bound from the producer */
+	std::size_t size() const
+	{
+		return this->head.load(std::memory_order_acquire) - this->tail.load(std::memory_order_acquire);
+	}
+private:
+	/* each index on its own cache line so the two threads don't keep stealing it from each other */
+	alignas(64) std::atomic<std::size_t> head{};
+	alignas(64) std::atomic<std::size_t> tail{};
+	alignas(64) T items[CAPACITY]{};
+};
@@ -0,0 +1,129 @@
+#include "thread_pool.hpp"
+
+c_thread_pool::c_thread_pool(std::size_t threads)
+{
+	if (threads == 0)
+		threads = std::thread::hardware_concurrency();
+
+	if (threads == 0)
+		threads = 1;
+
+	for (std::size_t i = 0; i < threads; i++)
+	{
+		this->queues.push_back(std::make_unique<queue_t>());
+	}
+
+	for (std::size_t i = 0; i < threads; i++)
+	{
+		this->workers.emplace_back(&c_thread_pool::worker, this, i);
+	}
+}
+
+c_thread_pool::~c_thread_pool()
+{
+	{
+		std::lock_guard<std::mutex> guard(this->idle_lock);
+		this->stopping = true;
+	}
+
+	this->idle.notify_all();
+
+	for (std::thread& thread : this->workers)
+	{
+		thread.join();
+	}
+}
+
+void c_thread_pool::submit(task_t task)
+{
+	/* spread submissions round robin, stealing evens out whatever imbalance is left */
+	std::size_t index = this->next_queue.fetch_add(1, std::memory_order_relaxed) % this->queues.size();
+
+	this->pending.fetch_add(1, std::memory_order_relaxed);
+
+	{
+		std::lock_guard<std::mutex> guard(this->queues[index]->lock);
+		this->queues[index]->tasks.push_back(std::move(task));
+	}
+
+	{
+		/* taking the lock orders the push before a worker's check-then-sleep */
+		std::lock_guard<std::mutex> guard(this->idle_lock);
+	}
+
+	this->idle.notify_one();
+}
+
+void c_thread_pool::wait()
+{
+	std::unique_lock<std::mutex> guard(this->idle_lock);
+	this->finished.wait(guard, [this] { return this->pending.load(std::memory_order_acquire) == 0; });
+}
+
+bool c_thread_pool::pop(std::size_t index, task_t& task)
+{
+	{
+		queue_t& own = *this->queues[index];
+		std::lock_guard<std::mutex> guard(own.lock);
+
+		if (!own.tasks.empty())
+		{
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			return true;
+		}
+	}
+
+	for (std::size_t i = 1; i < this->queues.size(); i++)
+	{
+		queue_t& victim = *this->queues[(index + i) % this->queues.size()];
+		std::lock_guard<std::mutex> guard(victim.lock);
+
+		if (!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void c_thread_pool::worker(std::size_t index)
+{
+	while (true)
+	{
+		task_t task;
+
+		if (this->pop(index, task))
+		{
+			task();
+
+			if (this->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				std::lock_guard<std::mutex> guard(this->idle_lock);
+				this->finished.notify_all();
+			}
+
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard(this->idle_lock);
+
+		if (this->stopping)
+			return;
+
+		/* re-check under the lock, a submit in between would otherwise be missed */
+		std::size_t queued = 0;
+
+		for (std::unique_ptr<queue_t>& queue : this->queues)
+		{
+			std::lock_guard<std::mutex> queue_guard(queue->lock);
+			queued += queue->tasks.size();
+		}
+
+		if (queued == 0)
+			this->idle.wait(guard);
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+/*
+*	work-stealing thread pool. every worker owns a deque, it pops its own work
+*	from the back and steals from the front of the others when it runs dry, so
+*	a few long roms don't leave the rest of the cores idle.
+*/
+class c_thread_pool
+{
+public:
+	using task_t = std::function<void()>;
+
+	/* 0 threads means one per hardware thread */
+	c_thread_pool(std::size_t threads = 0);
+	~c_thread_pool();
+
+	void submit(task_t task);
+
+	/* blocks until every submitted task has finished */
+	void wait();
+
+	std::size_t get_threads() const
+	{
+		return this->workers.size();
+	}
+private:
+	struct queue_t
+	{
+		std::mutex lock;
+		std::deque<task_t> tasks;
+	};
+
+	void worker(std::size_t index);
+	bool pop(std::size_t index, task_t& task);
+
+	std::vector<std::unique_ptr<queue_t>> queues;
+	std::vector<std::thread> workers;
+
+	std::mutex idle_lock;
+	std::condition_variable idle;
+	std::condition_variable finished;
+
+	std::atomic<std::size_t> pending{};
+	std::atomic<std::size_t> next_queue{};
+	bool stopping{};
+};